@@ -21,15 +21,9 @@ layout(std140,set = 1, binding = 0) readonly buffer ObjectBuffer{
 	ObjectData objects[];
 } objectBuffer;
 
-//push constants block
-layout( push_constant ) uniform constants
-{
- int id;
-} PushConstants;
-
 void main()
 {
-    mat4 modelMatrix = objectBuffer.objects[PushConstants.id].model;
+    mat4 modelMatrix = objectBuffer.objects[gl_InstanceIndex].model;
 	mat4 transformMatrix = (cameraData.viewproj * modelMatrix);
 	gl_Position = transformMatrix * vec4(vPosition, 1.0f);
 	outColor = vColor;
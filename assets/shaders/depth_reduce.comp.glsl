@@ -0,0 +1,26 @@
+#version 460
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// the level below, or the depth attachment for level 0
+layout(set = 0, binding = 0) uniform sampler2D source;
+
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D destination;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(texel, imageSize(destination)))) {
+		return;
+	}
+	// odd sizes round up, the last texel of a row or column then covers a
+	// single source texel
+	ivec2 last = textureSize(source, 0) - 1;
+	ivec2 base = texel * 2;
+	float depth = max(
+		max(texelFetch(source, min(base, last), 0).x,
+			texelFetch(source, min(base + ivec2(1, 0), last), 0).x),
+		max(texelFetch(source, min(base + ivec2(0, 1), last), 0).x,
+			texelFetch(source, min(base + ivec2(1, 1), last), 0).x));
+	// the farthest depth, anything behind it in the region is occluded
+	imageStore(destination, texel, vec4(depth));
+}
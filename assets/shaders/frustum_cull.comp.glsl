@@ -0,0 +1,179 @@
+#version 460
+layout (local_size_x = 64) in;
+
+// CullPhase in scene.h
+const uint PHASE_FRUSTUM = 0;
+const uint PHASE_EARLY = 1;
+const uint PHASE_LATE = 2;
+
+// VkDrawIndexedIndirectCommand
+struct DrawCommand {
+	uint indexCount;
+	uint instanceCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint firstInstance;
+};
+
+struct CullData {
+	// bounding sphere in the primitive's local space, radius in w
+	vec4 sphere;
+	// material batch the draw belongs to and where that batch's
+	// commands start
+	uint batch;
+	uint firstCommand;
+	uint pad0;
+	uint pad1;
+};
+
+struct ObjectData{
+	mat4 model;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer DrawCommands{
+	DrawCommand commands[];
+} drawCommands;
+
+layout(std430, set = 0, binding = 1) readonly buffer CullBuffer{
+	CullData draws[];
+} cullBuffer;
+
+layout(std430, set = 0, binding = 2) writeonly buffer VisibleCommands{
+	DrawCommand commands[];
+} visibleCommands;
+
+// one per batch, zeroed before the dispatch. The late phase writes its
+// commands and counts after the early phase's ones.
+layout(std430, set = 0, binding = 3) buffer DrawCounts{
+	uint counts[];
+} drawCounts;
+
+// 1 for the draws that passed the last late phase, the next early phase
+// draws those
+layout(std430, set = 0, binding = 4) buffer DrawVisibility{
+	uint visible[];
+} drawVisibility;
+
+//all object matrices
+layout(std140, set = 1, binding = 0) readonly buffer ObjectBuffer{
+	ObjectData objects[];
+} objectBuffer;
+
+// farthest depth of every region of what the early phase drew
+layout(set = 2, binding = 0) uniform sampler2D depthPyramid;
+
+// CullConstants in scene.h
+layout(push_constant) uniform constants
+{
+	mat4 view;
+	// normals of the side planes of the symmetric frustum in view space,
+	// x and z of the left and right ones then y and z of the others
+	vec4 frustum;
+	// P00, P11, P22 and P32 of the projection matrix
+	vec4 projection;
+	// of the depth attachment the pyramid was built from
+	vec2 depthSize;
+	float zNear;
+	float zFar;
+	uint commandCount;
+	uint batchCount;
+	uint phase;
+} PushConstants;
+
+// 2D Polyhedral Bounds of a Clipped, Perspective-Projected 3D Sphere,
+// Mara and McGuire 2013. The center is in view space looking down +z and
+// in front of the near plane, the bounds come out in uv.
+vec4 project_sphere(vec3 c, float r)
+{
+	vec3 cr = c * r;
+	float czr2 = c.z * c.z - r * r;
+	float vx = sqrt(c.x * c.x + czr2);
+	float minx = (vx * c.x - cr.z) / (vx * c.z + cr.x);
+	float maxx = (vx * c.x + cr.z) / (vx * c.z - cr.x);
+	float vy = sqrt(c.y * c.y + czr2);
+	float miny = (vy * c.y - cr.z) / (vy * c.z + cr.y);
+	float maxy = (vy * c.y + cr.z) / (vy * c.z - cr.y);
+	vec2 x = vec2(minx, maxx) * PushConstants.projection.x;
+	// P11 is negative when the projection flips y
+	vec2 y = vec2(miny, maxy) * PushConstants.projection.y;
+	vec4 ndc = vec4(min(x.x, x.y), min(y.x, y.y), max(x.x, x.y), max(y.x, y.y));
+	return ndc * 0.5f + 0.5f;
+}
+
+bool occluded(vec3 center, float radius)
+{
+	// spheres crossing the near plane can cover anything
+	if (center.z < radius + PushConstants.zNear) {
+		return false;
+	}
+	vec4 bounds = project_sphere(center, radius);
+	ivec2 last = ivec2(PushConstants.depthSize) - 1;
+	// attachment pixels under the sphere, then level 0 texels covering them
+	ivec2 lo = clamp(ivec2(bounds.xy * PushConstants.depthSize), ivec2(0),
+					 last) >> 1;
+	ivec2 hi = clamp(ivec2(bounds.zw * PushConstants.depthSize), ivec2(0),
+					 last) >> 1;
+	// first level where the bounds touch 2x2 texels at most
+	int level = 0;
+	int levels = textureQueryLevels(depthPyramid);
+	while (level + 1 < levels && any(greaterThan(hi - lo, ivec2(1)))) {
+		lo >>= 1;
+		hi >>= 1;
+		++level;
+	}
+	float depth = max(
+		max(texelFetch(depthPyramid, lo, level).x,
+			texelFetch(depthPyramid, ivec2(hi.x, lo.y), level).x),
+		max(texelFetch(depthPyramid, ivec2(lo.x, hi.y), level).x,
+			texelFetch(depthPyramid, hi, level).x));
+	// depth of the sphere's nearest point
+	float nearest = PushConstants.projection.w / (center.z - radius) -
+		PushConstants.projection.z;
+	return nearest > depth;
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= PushConstants.commandCount) {
+		return;
+	}
+	uint phase = PushConstants.phase;
+	bool drawn = phase != PHASE_FRUSTUM && drawVisibility.visible[index] != 0;
+	// the early phase only redraws what was visible last frame
+	if (phase == PHASE_EARLY && !drawn) {
+		return;
+	}
+	DrawCommand command = drawCommands.commands[index];
+	CullData cull = cullBuffer.draws[index];
+	mat4 model = objectBuffer.objects[command.firstInstance].model;
+	vec3 center =
+		(PushConstants.view * model * vec4(cull.sphere.xyz, 1.0f)).xyz;
+	center.z = -center.z;
+	// the largest axis scale keeps the sphere conservative
+	float scale = max(max(dot(model[0].xyz, model[0].xyz),
+						  dot(model[1].xyz, model[1].xyz)),
+					  dot(model[2].xyz, model[2].xyz));
+	float radius = cull.sphere.w * sqrt(scale);
+	vec4 frustum = PushConstants.frustum;
+	bool visible =
+		center.z * frustum.y - abs(center.x) * frustum.x > -radius &&
+		center.z * frustum.w - abs(center.y) * frustum.z > -radius &&
+		center.z + radius > PushConstants.zNear &&
+		center.z - radius < PushConstants.zFar;
+	if (phase == PHASE_LATE) {
+		visible = visible && !occluded(center, radius);
+		drawVisibility.visible[index] = visible ? 1 : 0;
+		// the early phase drew it already
+		if (drawn) {
+			return;
+		}
+	}
+	if (!visible) {
+		return;
+	}
+	uint commandBase = phase == PHASE_LATE ? PushConstants.commandCount : 0;
+	uint countBase = phase == PHASE_LATE ? PushConstants.batchCount : 0;
+	uint slot = atomicAdd(drawCounts.counts[countBase + cull.batch], 1);
+	visibleCommands.commands[commandBase + cull.firstCommand + slot] = command;
+}
@@ -0,0 +1,109 @@
+#include <benchmark/benchmark.h>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <random>
+#include "core/thread_pool.h"
+#include "gameplay/frustum.h"
+#include "render/vulkan/draw_culler.h"
+
+using namespace render::vulkan;
+
+// a 70 degree camera at the origin looking down -z, about a sixth of the
+// scene cube lands inside it
+static gameplay::Frustum culling_frustum() {
+	return gameplay::Frustum{
+		glm::perspective(glm::radians(70.f), 16.f / 9.f, 0.1f, 200.f)};
+}
+
+// count draws of one primitive per object spread over a cube around the
+// camera, in 8 material batches
+struct CullingScene {
+	ArrayList<glm::mat4> world;
+	DrawCuller culler;
+
+	CullingScene(u32 count) : world(count) {
+		std::mt19937 rng{29};
+		std::uniform_real_distribution<f32> position{-100.f, 100.f};
+		std::uniform_real_distribution<f32> radius{0.5f, 4.f};
+		ArrayList<DrawCommand> commands(count);
+		ArrayList<glm::vec4> bounds(count);
+		ArrayList<DrawBatch> batches{};
+		const u32 batch_size = (count + 7) / 8;
+		for (u32 i = 0; i < count; ++i) {
+			world[i] = glm::translate(
+				glm::mat4{1.f}, {position(rng), position(rng), position(rng)});
+			commands[i] = {36, 1, 0, 0, i};
+			bounds[i] = {0.f, 0.f, 0.f, radius(rng)};
+			if (i % batch_size == 0) {
+				batches.push_back({static_cast<s32>(batches.size()), i, 0});
+			}
+			++batches.back().command_count;
+		}
+		culler.assign(commands, bounds, batches);
+	}
+};
+
+// one Frustum::intersects call per sphere, the baseline for the lanes
+static void BM_Frustum_intersects(benchmark::State& state) {
+	const u32 count = state.range(0);
+	const gameplay::Frustum frustum = culling_frustum();
+	std::mt19937 rng{31};
+	std::uniform_real_distribution<f32> position{-100.f, 100.f};
+	ArrayList<f32> x(count), y(count), z(count), radius(count, 2.f);
+	for (u32 i = 0; i < count; ++i) {
+		x[i] = position(rng);
+		y[i] = position(rng);
+		z[i] = position(rng);
+	}
+	ArrayList<u8> visible(count);
+	for (auto _ : state) {
+		for (u32 i = 0; i < count; ++i) {
+			visible[i] = frustum.intersects({x[i], y[i], z[i]}, radius[i]);
+		}
+		benchmark::DoNotOptimize(visible.data());
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_Frustum_intersects)->RangeMultiplier(10)->Range(1000, 100000);
+
+static void BM_Frustum_intersects_batch(benchmark::State& state) {
+	const u32 count = state.range(0);
+	const gameplay::Frustum frustum = culling_frustum();
+	std::mt19937 rng{31};
+	std::uniform_real_distribution<f32> position{-100.f, 100.f};
+	ArrayList<f32> x(count), y(count), z(count), radius(count, 2.f);
+	for (u32 i = 0; i < count; ++i) {
+		x[i] = position(rng);
+		y[i] = position(rng);
+		z[i] = position(rng);
+	}
+	ArrayList<u8> visible(count);
+	for (auto _ : state) {
+		frustum.intersects(x.data(), y.data(), z.data(), radius.data(), count,
+						   visible.data());
+		benchmark::DoNotOptimize(visible.data());
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_Frustum_intersects_batch)
+	->RangeMultiplier(10)
+	->Range(1000, 100000);
+
+// the whole CPU culling stage, sphere transforms and compaction included,
+// on the calling thread alone and with the default workers
+static void BM_DrawCuller_cull(benchmark::State& state) {
+	CullingScene scene{static_cast<u32>(state.range(0))};
+	const gameplay::Frustum frustum = culling_frustum();
+	core::ThreadPool pool{state.range(1) == 0
+							  ? 0
+							  : core::ThreadPool::default_worker_count()};
+	for (auto _ : state) {
+		scene.culler.cull(frustum, scene.world, pool);
+		benchmark::DoNotOptimize(scene.culler.visible_commands().data());
+	}
+	state.counters["visible"] = scene.culler.visible_commands().size();
+	state.SetItemsProcessed(state.iterations() * scene.culler.size());
+}
+BENCHMARK(BM_DrawCuller_cull)
+	->ArgsProduct({{1000, 10000, 100000}, {0, 1}})
+	->Unit(benchmark::kMicrosecond);
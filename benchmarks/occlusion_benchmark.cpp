@@ -0,0 +1,30 @@
+#include <benchmark/benchmark.h>
+#include <glm/ext/quaternion_trigonometric.hpp>
+#include <glm/trigonometric.hpp>
+#include "core/sapfire_engine.h"
+
+// Sponza seen from one end of the nave, the columns and arches hide most of
+// the side aisles. Needs a window and a Vulkan device.
+static void BM_Renderer_draw_sponza(benchmark::State& state) {
+	core::Engine engine{};
+	engine.load_scene("assets/scenes/Sponza/glTF/Sponza.gltf");
+	engine.update_world_transforms(1.f);
+	render::vulkan::VulkanRenderer& renderer = engine.renderer();
+	renderer.occlusion_culling(state.range(0) != 0);
+	gameplay::Camera& camera = renderer.camera();
+	camera.transform.position({-10.f, 2.f, 0.f});
+	// looking down +x
+	camera.transform.rotation(
+		glm::angleAxis(glm::radians(-90.f), glm::vec3{0.f, 1.f, 0.f}));
+	for (auto _ : state) {
+		renderer.draw(engine.transforms(), engine.thread_pool());
+	}
+	state.counters["fps"] = benchmark::Counter(
+		state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Renderer_draw_sponza)
+	->ArgName("occlusion")
+	->Arg(0)
+	->Arg(1)
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
@@ -0,0 +1,280 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <memory>
+#include <random>
+#include "core/sapfire_engine.h"
+#include "gameplay/movement_component.h"
+#include "gameplay/transform.h"
+#include "physics/physics_engine.h"
+
+using namespace physics;
+
+// steps simulated before the scene is rebuilt, left alone the bodies settle
+// and fall asleep and the timed work shrinks over the run
+constexpr u32 STEPS_PER_SCENE = 30;
+// steps run before timing a single stage so it sees a populated frame
+constexpr u32 WARMUP_STEPS = 5;
+constexpr f32 STEP = 1.f / 60.f;
+
+// count bodies, half spheres and half boxes, dropped into a cube dense
+// enough that most of them touch a neighbour, over a ground plane
+struct PhysicsScene {
+	std::unique_ptr<core::Engine> engine;
+	std::unique_ptr<physics::Engine> physics;
+
+	PhysicsScene(u32 count, BroadphaseType broadphase,
+				 u32 workers = core::ThreadPool::default_worker_count()) {
+		std::mt19937 rng{13};
+		const f32 side = std::cbrt(static_cast<f32>(count)) * 1.2f;
+		std::uniform_real_distribution<f32> position{0.f, side};
+		ArrayList<core::Entity> entities(count);
+		gameplay::TransformStore transforms(count);
+		for (u32 i = 0; i < count; ++i) {
+			const s32 index = static_cast<s32>(i);
+			entities[i] = {index, -1, index};
+			transforms[i].position(
+				{position(rng), position(rng), position(rng)});
+		}
+		engine =
+			std::make_unique<core::Engine>(entities, transforms, workers);
+		physics = std::make_unique<physics::Engine>(engine.get(), broadphase);
+		ArrayList<PhysicsObjectSettings> objects(count + 1);
+		for (u32 i = 0; i < count; ++i) {
+			objects[i].transform_index = static_cast<s32>(i);
+			objects[i].movement_comp = gameplay::MovementComponent{};
+			objects[i].rb = RigidBody{};
+			if (i % 2 == 0) {
+				objects[i].type = ColliderType::Sphere;
+				objects[i].settings.radius = 0.5f;
+			} else {
+				objects[i].type = ColliderType::AABB;
+				objects[i].settings.size = {1, 1, 1};
+			}
+		}
+		objects[count].transform_index = -1;
+		objects[count].type = ColliderType::Plane;
+		objects[count].settings.normal = {0, 1, 0};
+		ArrayList<PhysicsHandle> handles{};
+		physics->add_physics_objects(objects, handles);
+	}
+
+	void step(u32 count) {
+		for (u32 i = 0; i < count; ++i) {
+			physics->simulate(STEP);
+		}
+	}
+};
+
+static void report(benchmark::State& state, u32 bodies, u32 contacts) {
+	state.counters["bodies"] = bodies;
+	// time per body per call
+	state.counters["t/body"] = benchmark::Counter(
+		bodies,
+		benchmark::Counter::kIsIterationInvariantRate |
+			benchmark::Counter::kInvert);
+	state.counters["contacts/s"] = benchmark::Counter(
+		contacts, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static BroadphaseType broadphase_arg(const benchmark::State& state) {
+	return static_cast<BroadphaseType>(state.range(1));
+}
+
+static void BM_Physics_simulate(benchmark::State& state) {
+	const u32 count = state.range(0);
+	std::unique_ptr<PhysicsScene> scene{};
+	u32 steps = STEPS_PER_SCENE;
+	u64 contacts = 0;
+	for (auto _ : state) {
+		if (steps == STEPS_PER_SCENE) {
+			state.PauseTiming();
+			scene =
+				std::make_unique<PhysicsScene>(count, broadphase_arg(state));
+			steps = 0;
+			state.ResumeTiming();
+		}
+		scene->physics->simulate(STEP);
+		contacts += scene->physics->collisions().size();
+		++steps;
+	}
+	report(state, count, contacts / std::max<u64>(state.iterations(), 1));
+}
+BENCHMARK(BM_Physics_simulate)
+	->ArgsProduct({{1000, 10000, 100000}, {0, 1, 2}})
+	->Unit(benchmark::kMillisecond);
+
+// the stages below run on a frozen frame, every call redoes the same work
+static void BM_Physics_broadphase(benchmark::State& state) {
+	const u32 count = state.range(0);
+	PhysicsScene scene{count, broadphase_arg(state)};
+	scene.step(WARMUP_STEPS);
+	for (auto _ : state) {
+		scene.physics->broadphase(STEP);
+		benchmark::DoNotOptimize(scene.physics->broadphase_pairs().data());
+	}
+	state.counters["pairs"] = scene.physics->broadphase_pairs().size();
+	report(state, count, scene.physics->collisions().size());
+}
+BENCHMARK(BM_Physics_broadphase)
+	->ArgsProduct({{1000, 10000, 100000}, {0, 1, 2}})
+	->Unit(benchmark::kMillisecond);
+
+static void BM_Physics_narrowphase(benchmark::State& state) {
+	const u32 count = state.range(0);
+	PhysicsScene scene{count, BroadphaseType::SweepAndPrune};
+	scene.step(WARMUP_STEPS);
+	scene.physics->broadphase(STEP);
+	for (auto _ : state) {
+		scene.physics->narrowphase();
+		benchmark::DoNotOptimize(scene.physics->collisions().data());
+	}
+	report(state, count, scene.physics->collisions().size());
+}
+BENCHMARK(BM_Physics_narrowphase)
+	->RangeMultiplier(10)
+	->Range(1000, 100000)
+	->Unit(benchmark::kMillisecond);
+
+static void BM_Physics_resolve_contacts(benchmark::State& state) {
+	const u32 count = state.range(0);
+	PhysicsScene scene{count, BroadphaseType::SweepAndPrune};
+	scene.step(WARMUP_STEPS);
+	scene.physics->broadphase(STEP);
+	scene.physics->narrowphase();
+	for (auto _ : state) {
+		scene.physics->resolve_contacts();
+	}
+	report(state, count, scene.physics->collisions().size());
+}
+BENCHMARK(BM_Physics_resolve_contacts)
+	->RangeMultiplier(10)
+	->Range(1000, 100000)
+	->Unit(benchmark::kMillisecond);
+
+static void BM_Physics_snapshot(benchmark::State& state) {
+	const u32 count = state.range(0);
+	PhysicsScene scene{count, BroadphaseType::SweepAndPrune};
+	scene.step(WARMUP_STEPS);
+	ArrayList<u8> snapshot{};
+	for (auto _ : state) {
+		scene.physics->snapshot(snapshot);
+		benchmark::DoNotOptimize(snapshot.data());
+	}
+	state.counters["bytes"] = snapshot.size();
+	state.SetBytesProcessed(state.iterations() * snapshot.size());
+}
+BENCHMARK(BM_Physics_snapshot)
+	->RangeMultiplier(10)
+	->Range(1000, 100000)
+	->Unit(benchmark::kMicrosecond);
+
+static void BM_Physics_restore(benchmark::State& state) {
+	const u32 count = state.range(0);
+	PhysicsScene scene{count, BroadphaseType::SweepAndPrune};
+	scene.step(WARMUP_STEPS);
+	ArrayList<u8> snapshot{};
+	scene.physics->snapshot(snapshot);
+	scene.step(1);
+	for (auto _ : state) {
+		scene.physics->restore(snapshot);
+	}
+	state.SetBytesProcessed(state.iterations() * snapshot.size());
+}
+BENCHMARK(BM_Physics_restore)
+	->RangeMultiplier(10)
+	->Range(1000, 100000)
+	->Unit(benchmark::kMicrosecond);
+
+// restore 8 steps back and simulate up to the present again, the second
+// argument is the number of pool workers
+static void BM_Physics_rollback(benchmark::State& state) {
+	const u32 count = state.range(0);
+	PhysicsScene scene{count, BroadphaseType::SweepAndPrune,
+					   static_cast<u32>(state.range(1))};
+	scene.step(WARMUP_STEPS);
+	ArrayList<u8> snapshot{};
+	scene.physics->snapshot(snapshot);
+	for (auto _ : state) {
+		scene.physics->restore(snapshot);
+		scene.step(8);
+	}
+	report(state, count, scene.physics->collisions().size());
+}
+BENCHMARK(BM_Physics_rollback)
+	->ArgsProduct({{1000, 10000}, {0, 3}})
+	->Unit(benchmark::kMillisecond);
+
+constexpr u32 QUERY_RAYS = 4096;
+
+// rays from above the scene towards random points inside it, neighbours
+// aim close to each other like the rays of a sensor sweep would
+static ArrayList<Ray> query_rays(u32 count) {
+	const f32 side = std::cbrt(static_cast<f32>(count)) * 1.2f;
+	std::mt19937 rng{17};
+	std::uniform_real_distribution<f32> position{0.f, side};
+	std::uniform_real_distribution<f32> jitter{-0.5f, 0.5f};
+	ArrayList<Ray> rays(QUERY_RAYS);
+	glm::vec3 target{};
+	for (u32 i = 0; i < rays.size(); ++i) {
+		if (i % 4 == 0) {
+			target = {position(rng), position(rng), position(rng)};
+		}
+		rays[i].origin = {side * 0.5f, side * 2.f, side * 0.5f};
+		const glm::vec3 aim = target + glm::vec3{jitter(rng), 0, jitter(rng)};
+		rays[i].direction = glm::normalize(aim - rays[i].origin);
+	}
+	return rays;
+}
+
+// one raycast call per ray, the baseline for the batched queries
+static void BM_Physics_raycast(benchmark::State& state) {
+	const u32 count = state.range(0);
+	PhysicsScene scene{count, BroadphaseType::DynamicTree};
+	scene.step(WARMUP_STEPS);
+	const ArrayList<Ray> rays = query_rays(count);
+	RaycastHit hit{};
+	for (auto _ : state) {
+		for (const Ray& ray : rays) {
+			benchmark::DoNotOptimize(scene.physics->raycast(ray, hit));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * rays.size());
+}
+BENCHMARK(BM_Physics_raycast)
+	->RangeMultiplier(10)
+	->Range(1000, 100000)
+	->Unit(benchmark::kMicrosecond);
+
+static void BM_Physics_raycast_batch(benchmark::State& state) {
+	const u32 count = state.range(0);
+	PhysicsScene scene{count, BroadphaseType::DynamicTree};
+	scene.step(WARMUP_STEPS);
+	const ArrayList<Ray> rays = query_rays(count);
+	ArrayList<RaycastHit> hits(rays.size());
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(scene.physics->raycast_batch(rays, hits));
+	}
+	state.SetItemsProcessed(state.iterations() * rays.size());
+}
+BENCHMARK(BM_Physics_raycast_batch)
+	->RangeMultiplier(10)
+	->Range(1000, 100000)
+	->Unit(benchmark::kMicrosecond);
+
+static void BM_Physics_spherecast_batch(benchmark::State& state) {
+	const u32 count = state.range(0);
+	PhysicsScene scene{count, BroadphaseType::DynamicTree};
+	scene.step(WARMUP_STEPS);
+	const ArrayList<Ray> rays = query_rays(count);
+	ArrayList<RaycastHit> hits(rays.size());
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(
+			scene.physics->spherecast_batch(rays, 0.25f, hits));
+	}
+	state.SetItemsProcessed(state.iterations() * rays.size());
+}
+BENCHMARK(BM_Physics_spherecast_batch)
+	->RangeMultiplier(10)
+	->Range(1000, 100000)
+	->Unit(benchmark::kMicrosecond);
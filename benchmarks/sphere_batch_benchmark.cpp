@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include "gameplay/transform.h"
+#include "physics/sphere_batch.h"
+#include "physics/sphere_collider.h"
+
+using namespace physics;
+
+struct SphereScene {
+	gameplay::TransformStore transforms;
+	ArrayList<SphereCollider> spheres;
+	SphereBatch batch;
+
+	SphereScene(u32 count) : transforms(count) {
+		std::mt19937 rng{7};
+		std::uniform_real_distribution<f32> position{-100.f, 100.f};
+		spheres.reserve(count);
+		batch.reserve(count);
+		for (u32 i = 0; i < count; ++i) {
+			transforms[i].position(
+				{position(rng), position(rng), position(rng)});
+			spheres.emplace_back(transforms, i, 1.f);
+			batch.push(transforms[i].position(), 1.f);
+		}
+	}
+};
+
+// one sphere against every other through SphereCollider::check_collision
+static void BM_SphereCollider_one_vs_n(benchmark::State& state) {
+	SphereScene scene{static_cast<u32>(state.range(0))};
+	ArrayList<IntersectData> results(scene.spheres.size());
+	for (auto _ : state) {
+		for (u32 i = 0; i < scene.spheres.size(); ++i) {
+			results[i] = scene.spheres[0].check_collision(scene.spheres[i]);
+		}
+		benchmark::DoNotOptimize(results.data());
+	}
+	state.SetItemsProcessed(state.iterations() * scene.spheres.size());
+}
+BENCHMARK(BM_SphereCollider_one_vs_n)->Range(1 << 10, 1 << 16);
+
+static void BM_SphereBatch_one_vs_n(benchmark::State& state) {
+	SphereScene scene{static_cast<u32>(state.range(0))};
+	ArrayList<IntersectData> results(scene.batch.size());
+	for (auto _ : state) {
+		scene.batch.check_collision_range(0, 0, scene.batch.size(),
+										  results.data());
+		benchmark::DoNotOptimize(results.data());
+	}
+	state.SetItemsProcessed(state.iterations() * scene.batch.size());
+}
+BENCHMARK(BM_SphereBatch_one_vs_n)->Range(1 << 10, 1 << 16);
+
+// pair lists as the narrowphase sees them, in random order
+static void BM_SphereCollider_pairs(benchmark::State& state) {
+	SphereScene scene{static_cast<u32>(state.range(0))};
+	std::mt19937 rng{11};
+	std::uniform_int_distribution<u32> index{0, scene.batch.size() - 1};
+	ArrayList<u32> first(scene.batch.size());
+	ArrayList<u32> second(scene.batch.size());
+	for (u32 i = 0; i < first.size(); ++i) {
+		first[i] = index(rng);
+		second[i] = index(rng);
+	}
+	ArrayList<IntersectData> results(first.size());
+	for (auto _ : state) {
+		for (u32 i = 0; i < first.size(); ++i) {
+			results[i] = scene.spheres[first[i]].check_collision(
+				scene.spheres[second[i]]);
+		}
+		benchmark::DoNotOptimize(results.data());
+	}
+	state.SetItemsProcessed(state.iterations() * first.size());
+}
+BENCHMARK(BM_SphereCollider_pairs)->Range(1 << 10, 1 << 16);
+
+static void BM_SphereBatch_pairs(benchmark::State& state) {
+	SphereScene scene{static_cast<u32>(state.range(0))};
+	std::mt19937 rng{11};
+	std::uniform_int_distribution<u32> index{0, scene.batch.size() - 1};
+	ArrayList<u32> first(scene.batch.size());
+	ArrayList<u32> second(scene.batch.size());
+	for (u32 i = 0; i < first.size(); ++i) {
+		first[i] = index(rng);
+		second[i] = index(rng);
+	}
+	ArrayList<IntersectData> results(first.size());
+	for (auto _ : state) {
+		scene.batch.check_collision(first.data(), second.data(), first.size(),
+									results.data());
+		benchmark::DoNotOptimize(results.data());
+	}
+	state.SetItemsProcessed(state.iterations() * first.size());
+}
+BENCHMARK(BM_SphereBatch_pairs)->Range(1 << 10, 1 << 16);
@@ -0,0 +1,56 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include "core/thread_pool.h"
+#include "gameplay/transform_store.h"
+
+using namespace gameplay;
+
+// count transforms in trees of 1 root with 3 children of 3 children each,
+// the shape of a scene of small props
+static TransformStore transform_scene(u32 count) {
+	std::mt19937 rng{23};
+	std::uniform_real_distribution<f32> value{-10.f, 10.f};
+	TransformStore transforms(count);
+	for (u32 i = 0; i < count; ++i) {
+		transforms[i].position({value(rng), value(rng), value(rng)});
+		transforms[i].rotation(glm::vec3{value(rng), value(rng), value(rng)});
+		const u32 tree = i - i % 13;
+		const u32 node = i % 13;
+		if (node > 0) {
+			const u32 parent = node < 4 ? tree : tree + 1 + (node - 4) / 3;
+			transforms[i].parent_index(parent);
+		}
+	}
+	return transforms;
+}
+
+// every transform moved, as after a physics step where nothing sleeps
+static void BM_TransformStore_update(benchmark::State& state) {
+	TransformStore store = transform_scene(state.range(0));
+	core::ThreadPool pool{0};
+	for (auto _ : state) {
+		for (u32 i = 0; i < store.size(); ++i) {
+			store.position(i, store.position(i));
+		}
+		store.update(pool);
+		benchmark::DoNotOptimize(store.world().data());
+	}
+	state.SetItemsProcessed(state.iterations() * store.size());
+}
+BENCHMARK(BM_TransformStore_update)->Range(1 << 10, 1 << 16);
+
+// one root in 16 moved, the rest of the scene at rest
+static void BM_TransformStore_update_sparse(benchmark::State& state) {
+	TransformStore store = transform_scene(state.range(0));
+	core::ThreadPool pool{0};
+	store.update(pool);
+	for (auto _ : state) {
+		for (u32 i = 0; i < store.size(); i += 13 * 16) {
+			store.position(i, store.position(i));
+		}
+		store.update(pool);
+		benchmark::DoNotOptimize(store.world().data());
+	}
+	state.SetItemsProcessed(state.iterations() * store.size());
+}
+BENCHMARK(BM_TransformStore_update_sparse)->Range(1 << 10, 1 << 16);
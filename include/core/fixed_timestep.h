@@ -0,0 +1,29 @@
+#pragma once
+
+#include "core/types.h"
+
+namespace core {
+	// Accumulates wall clock frame time and hands it out in fixed steps, so
+	// the simulation result does not depend on the frame rate.
+	class FixedTimestep {
+	public:
+		inline FixedTimestep(f32 step = 1.f / 60.f, u32 max_substeps = 8) :
+			mStep(step), mMaxSubsteps(max_substeps) {}
+
+		// adds frame_time and returns how many steps to simulate this frame
+		u32 advance(f32 frame_time);
+
+		// fraction of a step left in the accumulator, in [0, 1), used to
+		// blend between the last two simulated states
+		inline f32 alpha() const { return mAccumulator / mStep; }
+		inline f32 step() const { return mStep; }
+		inline u32 max_substeps() const { return mMaxSubsteps; }
+		inline void step(f32 step) { mStep = step; }
+		inline void max_substeps(u32 count) { mMaxSubsteps = count; }
+
+	private:
+		f32 mStep;
+		u32 mMaxSubsteps;
+		f32 mAccumulator{0.f};
+	};
+} // namespace core
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "core/types.h"
+
+namespace core {
+	// Stable least significant digit radix sort of 64-bit keys, a byte per
+	// pass, values move along with their keys. Passes where every key has
+	// the same byte are skipped, so keys using only a few of their bytes
+	// only pay for those.
+	void radix_sort(ArrayList<u64>& keys, ArrayList<u32>& values);
+	// the keys alone
+	void radix_sort(ArrayList<u64>& keys);
+} // namespace core
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <filesystem>
+#include "core/fixed_timestep.h"
+#include "core/thread_pool.h"
 #include "core/types.h"
-#include "gameplay/transform.h"
+#include "gameplay/transform_store.h"
 #include "physics/physics_engine.h"
 #include "render/vulkan/renderer.h"
 
@@ -17,26 +19,45 @@ namespace core {
 	public:
 		Engine();
 		inline Engine(const ArrayList<Entity>& entities,
-					  const ArrayList<gameplay::Transform>& transforms) :
+					  const gameplay::TransformStore& transforms,
+					  u32 worker_count = ThreadPool::default_worker_count()) :
 			mEntities(entities),
-			mTransforms(transforms) {}
+			mTransforms(transforms), mThreadPool(worker_count) {}
 
 		void load_scene(std::filesystem::path scene_path);
 
 		void run();
 
-		inline ArrayList<gameplay::Transform>& transforms() {
+		inline gameplay::TransformStore& transforms() { return mTransforms; }
+		inline const gameplay::TransformStore& transforms() const {
 			return mTransforms;
 		}
 
 		inline u32 entity_count() const { return mEntities.size(); }
+
+		inline ThreadPool& thread_pool() { return mThreadPool; }
+
+		inline FixedTimestep& timestep() { return mTimestep; }
+
+		// only valid after load_scene
+		inline render::vulkan::VulkanRenderer& renderer() {
+			return *mRenderer;
+		}
+
+		// remembers the physics state before a step for interpolation
+		void store_previous_state();
+		// world matrices of the transforms blended by alpha between the
+		// state before the last step and the current one, parents first
+		void update_world_transforms(f32 alpha);
     private:
         void load_node(const tinygltf::Node* inNode,
 							  const tinygltf::Model* in, s32 parent_index = -1);
 
 	private:
 		ArrayList<Entity> mEntities{};
-		ArrayList<gameplay::Transform> mTransforms{};
+		gameplay::TransformStore mTransforms{};
+		ThreadPool mThreadPool{};
+		FixedTimestep mTimestep{};
 		std::unique_ptr<render::vulkan::VulkanRenderer> mRenderer;
 		std::unique_ptr<physics::Engine> mPhysics;
 	};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include "core/types.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CORE_SIMD
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CORE_SIMD
+#endif
+
+// Float lanes for the batched kernels, eight wide with AVX2 and four with
+// SSE. Kernels are guarded by CORE_SIMD and keep a scalar loop for the tail
+// and for targets without either.
+namespace core::simd {
+#if defined(__AVX2__)
+	using Lane = __m256;
+	constexpr u32 LANES = 8;
+	inline Lane load(const f32* p) { return _mm256_loadu_ps(p); }
+	inline Lane load_aligned(const f32* p) { return _mm256_load_ps(p); }
+	inline Lane broadcast(f32 v) { return _mm256_set1_ps(v); }
+	inline Lane gather(const f32* base, const u32* indices) {
+		const __m256i offsets =
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices));
+		return _mm256_i32gather_ps(base, offsets, sizeof(f32));
+	}
+	inline Lane add(Lane a, Lane b) { return _mm256_add_ps(a, b); }
+	inline Lane sub(Lane a, Lane b) { return _mm256_sub_ps(a, b); }
+	inline Lane mul(Lane a, Lane b) { return _mm256_mul_ps(a, b); }
+	inline Lane div(Lane a, Lane b) { return _mm256_div_ps(a, b); }
+	inline Lane root(Lane a) { return _mm256_sqrt_ps(a); }
+	inline Lane less(Lane a, Lane b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline Lane either(Lane a, Lane b) { return _mm256_or_ps(a, b); }
+	// a where mask is set, b elsewhere
+	inline Lane select(Lane mask, Lane a, Lane b) {
+		return _mm256_blendv_ps(b, a, mask);
+	}
+	inline Lane zero() { return _mm256_setzero_ps(); }
+	inline s32 mask(Lane a) { return _mm256_movemask_ps(a); }
+	inline void store(f32* p, Lane a) { _mm256_storeu_ps(p, a); }
+	inline void store_aligned(f32* p, Lane a) { _mm256_store_ps(p, a); }
+#elif defined(CORE_SIMD)
+	using Lane = __m128;
+	constexpr u32 LANES = 4;
+	inline Lane load(const f32* p) { return _mm_loadu_ps(p); }
+	inline Lane load_aligned(const f32* p) { return _mm_load_ps(p); }
+	inline Lane broadcast(f32 v) { return _mm_set1_ps(v); }
+	inline Lane gather(const f32* base, const u32* indices) {
+		return _mm_setr_ps(base[indices[0]], base[indices[1]],
+						   base[indices[2]], base[indices[3]]);
+	}
+	inline Lane add(Lane a, Lane b) { return _mm_add_ps(a, b); }
+	inline Lane sub(Lane a, Lane b) { return _mm_sub_ps(a, b); }
+	inline Lane mul(Lane a, Lane b) { return _mm_mul_ps(a, b); }
+	inline Lane div(Lane a, Lane b) { return _mm_div_ps(a, b); }
+	inline Lane root(Lane a) { return _mm_sqrt_ps(a); }
+	inline Lane less(Lane a, Lane b) { return _mm_cmplt_ps(a, b); }
+	inline Lane either(Lane a, Lane b) { return _mm_or_ps(a, b); }
+	inline Lane select(Lane mask, Lane a, Lane b) {
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+	inline Lane zero() { return _mm_setzero_ps(); }
+	inline s32 mask(Lane a) { return _mm_movemask_ps(a); }
+	inline void store(f32* p, Lane a) { _mm_storeu_ps(p, a); }
+	inline void store_aligned(f32* p, Lane a) { _mm_store_ps(p, a); }
+#endif
+} // namespace core::simd
+
+namespace core {
+	// Allocator for arrays read with aligned lane loads. 32 bytes covers an
+	// AVX2 lane, 64 keeps every element within its own cache lines.
+	template <typename T, std::size_t Alignment = 32>
+	struct AlignedAllocator {
+		using value_type = T;
+
+		template <typename U>
+		struct rebind {
+			using other = AlignedAllocator<U, Alignment>;
+		};
+
+		AlignedAllocator() = default;
+		template <typename U>
+		AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+		inline T* allocate(std::size_t count) {
+			return static_cast<T*>(::operator new(
+				count * sizeof(T), std::align_val_t{Alignment}));
+		}
+		inline void deallocate(T* p, std::size_t) {
+			::operator delete(p, std::align_val_t{Alignment});
+		}
+
+		template <typename U>
+		inline bool operator==(const AlignedAllocator<U, Alignment>&) const {
+			return true;
+		}
+	};
+
+	template <typename T, std::size_t Alignment = 32>
+	using AlignedList = std::vector<T, AlignedAllocator<T, Alignment>>;
+} // namespace core
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "core/types.h"
+
+namespace core {
+	// Fixed set of worker threads for data parallel loops. The calling thread
+	// works on the loop too and parallel_for returns once every chunk is done.
+	class ThreadPool {
+	public:
+		// 0 workers runs everything on the calling thread
+		explicit ThreadPool(u32 worker_count = default_worker_count());
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) = delete;
+		ThreadPool& operator=(ThreadPool&&) = delete;
+		~ThreadPool();
+
+		// one less than the hardware threads, the caller is the last one
+		static u32 default_worker_count();
+		inline u32 worker_count() const { return mWorkers.size(); }
+
+		inline static u32 chunk_count(u32 count, u32 chunk_size) {
+			return (count + chunk_size - 1) / chunk_size;
+		}
+
+		// Splits [0, count) into chunks of chunk_size and calls
+		// fn(chunk_index, begin, end) once per chunk from any thread. Chunks
+		// only depend on chunk_size, so writing results per chunk and
+		// merging them in chunk order is deterministic for any worker count.
+		// Not reentrant, fn must not call parallel_for itself.
+		template <typename F>
+		void parallel_for(u32 count, u32 chunk_size, F&& fn) {
+			auto task = [&](u32 chunk) {
+				const u32 begin = chunk * chunk_size;
+				fn(chunk, begin, std::min(begin + chunk_size, count));
+			};
+			run(chunk_count(count, chunk_size), &task,
+				[](void* context, u32 chunk) {
+					(*static_cast<decltype(task)*>(context))(chunk);
+				});
+		}
+
+	private:
+		using ChunkFunction = void (*)(void* context, u32 chunk);
+
+		struct Job {
+			void* context{nullptr};
+			ChunkFunction function{nullptr};
+			u32 chunk_count{0};
+		};
+
+		void run(u32 chunk_count, void* context, ChunkFunction function);
+		// claims chunks of job until none are left
+		void execute(const Job& job);
+		void work();
+
+	private:
+		ArrayList<std::jthread> mWorkers{};
+		std::mutex mMutex{};
+		std::condition_variable mWake{};
+		std::condition_variable mDone{};
+		// current job, written under mMutex before mGeneration changes.
+		// Workers copy it under the lock and only join while chunks are
+		// left, which keeps run() waiting for them before the next job.
+		Job mJob{};
+		u64 mGeneration{0};
+		std::atomic<u32> mNextChunk{0};
+		std::atomic<u32> mPending{0};
+		// workers inside execute(), the job is only over once they leave
+		u32 mActive{0};
+		bool bStopping{false};
+	};
+} // namespace core
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <glm/ext/matrix_transform.hpp>
 #include "core/types.h"
 #include "gameplay/input_component.h"
 #include "gameplay/movement_component.h"
@@ -13,6 +14,7 @@ namespace gameplay {
 
 		void build_projection();
 
+		// standalone, the camera isn't one of the scene's transforms
 		Transform transform{};
 		InputComponent input{};
 		MovementComponent movement{{0,0,0}, {0,0,0}};
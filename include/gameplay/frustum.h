@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include "core/types.h"
+
+namespace gameplay {
+	// The six planes of a view projection as (normal, distance). Normals
+	// point inwards and are normalized, so a plane's dot with a point is
+	// the signed distance in world units.
+	struct Frustum {
+		static constexpr u32 PLANE_COUNT = 6;
+
+		// left, right, bottom, top, near, far
+		glm::vec4 planes[PLANE_COUNT]{};
+
+		Frustum() = default;
+		explicit Frustum(const glm::mat4& view_proj);
+
+		// false only when the sphere is entirely outside one plane
+		bool intersects(const glm::vec3& center, f32 radius) const;
+		// visible[i] = intersects({x[i], y[i], z[i]}, radius[i]) for i in
+		// [0, count), eight spheres at a time with AVX2 and four with SSE
+		void intersects(const f32* x, const f32* y, const f32* z,
+						const f32* radius, u32 count, u8* visible) const;
+	};
+} // namespace gameplay
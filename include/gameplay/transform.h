@@ -1,60 +1,126 @@
 #pragma once
 
-#include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/quaternion_float.hpp>
+#include <glm/geometric.hpp>
 #include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <memory>
 #include "core/types.h"
+#include "gameplay/transform_store.h"
 
 namespace gameplay {
+	// rotation of euler angles in radians: yaw around -y, then roll around
+	// -z, then pitch around -x
+	glm::quat euler_rotation(const glm::vec3& euler);
+	// euler angles of a rotation, the inverse of euler_rotation
+	glm::vec3 euler_angles(const glm::quat& rotation);
+
+	// One transform of a TransformStore. Only the store and the index are
+	// held, getters and setters go straight to the store's arrays, so copies
+	// refer to the same transform and stay valid when the store grows.
+	// Default constructed transforms are standalone, they own a store of
+	// their own and copies of them are independent values.
 	class Transform {
 	public:
-		const glm::mat4&
-		calculate_transform(const ArrayList<Transform>& transforms);
-		const glm::mat4& transform() const { return mTransform; }
-		inline const glm::vec3& euler() const { return mEulerAngles; }
-		inline const glm::vec3& position() const { return mPosition; }
-		inline const glm::vec3& scale() const { return mScale; }
-		inline const glm::vec3& right() const { return mRight; }
-		inline const glm::vec3& forward() const { return mForward; }
-		inline const glm::vec3& up() const { return mUp; }
-
-		inline Transform& scale(const glm::vec3& scale) {
-			mScale = scale;
-			mDirty = true;
+		Transform() :
+			mOwned(std::make_unique<TransformStore>(1)), mStore(mOwned.get()),
+			mIndex(0) {}
+		inline Transform(TransformStore& store, u32 index) :
+			mStore(&store), mIndex(index) {}
+		inline Transform(const Transform& other) :
+			mOwned(other.mOwned ? std::make_unique<TransformStore>(*other.mOwned)
+								: nullptr),
+			mStore(mOwned ? mOwned.get() : other.mStore),
+			mIndex(other.mIndex) {}
+		inline Transform& operator=(const Transform& other) {
+			if (this != &other) {
+				*this = Transform{other};
+			}
 			return *this;
 		}
+		Transform(Transform&&) noexcept = default;
+		Transform& operator=(Transform&&) noexcept = default;
 
-		inline Transform& position(const glm::vec3& pos) {
-			mPosition = pos;
-			return *this;
+		inline TransformStore& store() const { return *mStore; }
+		inline u32 index() const { return mIndex; }
+		// world matrix as of the last TransformStore::update
+		inline const glm::mat4& transform() const {
+			return mStore->world(mIndex);
 		}
-
-		Transform& rotation(const glm::vec3& rotation);
-
-		Transform& rotation(const glm::quat& rotation);
-
-		inline const glm::mat4& rotation_matrix() const {
-			return mRotationMatrix;
+		// recomputes the world matrix on its own, parent_index indexes
+		// transforms
+		inline const glm::mat4&
+		calculate_transform(const ArrayList<Transform>& transforms) {
+			const s32 parent = parent_index();
+			return mStore->update(mIndex, parent >= 0
+										   ? transforms[parent].transform()
+										   : glm::mat4{1.f});
 		}
-
-		inline void parent_index(s32 ind) {
-			mParentIndex = ind;
-			mDirty = true;
+		inline glm::vec3 position() const { return mStore->position(mIndex); }
+		inline glm::quat rotation() const { return mStore->rotation(mIndex); }
+		inline glm::vec3 scale() const { return mStore->scale(mIndex); }
+		inline s32 parent_index() const { return mStore->parent_index(mIndex); }
+		// set by every setter until the world matrix is recomputed
+		inline bool dirty() const { return mStore->dirty(mIndex); }
+		inline glm::vec3 euler() const { return euler_angles(rotation()); }
+		inline glm::mat4 rotation_matrix() const {
+			return glm::mat4(rotation());
+		}
+		inline glm::vec3 right() const {
+			return rotation() * glm::vec3{1.f, 0.f, 0.f};
+		}
+		inline glm::vec3 forward() const {
+			return rotation() * glm::vec3{0.f, 0.f, 1.f};
+		}
+		inline glm::vec3 up() const {
+			return glm::normalize(glm::cross(right(), forward()));
 		}
 
-		inline s32 parent_index() const { return mParentIndex; }
+		inline Transform& position(const glm::vec3& position) {
+			mStore->position(mIndex, position);
+			return *this;
+		}
+		inline Transform& rotation(const glm::quat& rotation) {
+			mStore->rotation(mIndex, rotation);
+			return *this;
+		}
+		// euler angles in radians
+		inline Transform& rotation(const glm::vec3& euler) {
+			return rotation(euler_rotation(euler));
+		}
+		inline Transform& scale(const glm::vec3& scale) {
+			mStore->scale(mIndex, scale);
+			return *this;
+		}
+		inline Transform& parent_index(s32 parent) {
+			mStore->parent_index(mIndex, parent);
+			return *this;
+		}
 
 	private:
-		glm::mat4x4 mTransform{1.0};
-		glm::vec3 mPosition{0.0};
-		glm::quat mRotation{};
-		glm::vec3 mEulerAngles{0.0, 0.0, 0.0};
-		glm::vec3 mScale{1.0, 1.0, 1.0};
-		glm::vec3 mRight{1.0, 0.0, 0.0};
-		glm::vec3 mForward{0.0, 0.0, -1.0};
-		glm::vec3 mUp{0.0, 1.0, 0.0};
-		glm::mat4x4 mRotationMatrix{1};
-		s32 mParentIndex{-1};
-		bool mDirty{true};
+		// the store of a standalone transform
+		std::unique_ptr<TransformStore> mOwned{};
+		TransformStore* mStore;
+		u32 mIndex;
 	};
+
+	inline Transform TransformStore::operator[](u32 index) {
+		return {*this, index};
+	}
+
+	inline glm::vec3 TransformView::euler() const {
+		return euler_angles(rotation());
+	}
+	inline glm::mat4 TransformView::rotation_matrix() const {
+		return glm::mat4(rotation());
+	}
+	inline glm::vec3 TransformView::right() const {
+		return rotation() * glm::vec3{1.f, 0.f, 0.f};
+	}
+	inline glm::vec3 TransformView::forward() const {
+		return rotation() * glm::vec3{0.f, 0.f, 1.f};
+	}
+	inline glm::vec3 TransformView::up() const {
+		return glm::normalize(glm::cross(right(), forward()));
+	}
 } // namespace gameplay
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "core/types.h"
+
+namespace gameplay {
+	// Update order of a transform array sorted by depth in the hierarchy, so
+	// all parents of a level are computed before any of their children and a
+	// level can be split over threads. The transforms keep their indices,
+	// entities, physics and the renderer refer to them by index.
+	class TransformHierarchy {
+	public:
+		// from the parent index of every transform, call again whenever
+		// transforms are added or reparented
+		void build(const ArrayList<s32>& parents);
+
+		inline u32 level_count() const { return mLevelStarts.size() - 1; }
+		// transform indices of level [level_start(l), level_start(l + 1))
+		inline const ArrayList<u32>& order() const { return mOrder; }
+		inline u32 level_start(u32 level) const { return mLevelStarts[level]; }
+
+	private:
+		ArrayList<u32> mOrder{};
+		// offsets into mOrder per level, with the end appended
+		ArrayList<u32> mLevelStarts{0};
+	};
+} // namespace gameplay
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <glm/ext/quaternion_float.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <span>
+#include "core/simd.h"
+#include "core/thread_pool.h"
+#include "core/types.h"
+#include "gameplay/transform_hierarchy.h"
+
+namespace gameplay {
+	class Transform;
+	class TransformStore;
+
+	// transform indices [begin, end)
+	struct TransformRange {
+		u32 begin;
+		u32 end;
+	};
+
+	// Read only view of one transform of a TransformStore with the getters
+	// of Transform, for code that only reads transforms.
+	class TransformView {
+	public:
+		inline TransformView(const TransformStore& store, u32 index) :
+			mStore(&store), mIndex(index) {}
+
+		inline glm::vec3 position() const;
+		inline glm::quat rotation() const;
+		inline glm::vec3 scale() const;
+		inline s32 parent_index() const;
+		inline bool dirty() const;
+		inline const glm::mat4& transform() const;
+		// computed from the rotation, defined with Transform's
+		inline glm::vec3 euler() const;
+		inline glm::mat4 rotation_matrix() const;
+		inline glm::vec3 right() const;
+		inline glm::vec3 forward() const;
+		inline glm::vec3 up() const;
+
+	private:
+		const TransformStore* mStore;
+		u32 mIndex;
+	};
+
+	// Owns every transform of the engine as a structure of arrays, Transform
+	// is an index into it. Positions, rotations and scales live in aligned
+	// arrays of their own, so physics moving a transform touches 12 bytes
+	// and the kernels read whole lanes. The positions and rotations of the
+	// previous physics step are kept next to them and blended while
+	// composing, so rendering an interpolated frame copies nothing. Local
+	// matrices of dirty transforms are composed 8 (AVX2) or 4 (SSE) at a
+	// time, then multiplied by their parent's world matrix as many at a time,
+	// one hierarchy level after the other.
+	class TransformStore {
+	public:
+		// transforms per worker chunk, a multiple of every lane width
+		static constexpr u32 CHUNK_SIZE = 256;
+
+		TransformStore() = default;
+		// count transforms at the origin
+		explicit TransformStore(u32 count);
+
+		// appends a transform at the origin without rotation or parent
+		Transform add();
+		void reserve(u32 count);
+
+		inline u32 size() const { return mParents.size(); }
+		inline Transform operator[](u32 index);
+		inline TransformView operator[](u32 index) const {
+			return {*this, index};
+		}
+
+		inline glm::vec3 position(u32 index) const {
+			return {mPositionX[index], mPositionY[index], mPositionZ[index]};
+		}
+		inline glm::quat rotation(u32 index) const {
+			glm::quat rotation{};
+			rotation.x = mRotationX[index];
+			rotation.y = mRotationY[index];
+			rotation.z = mRotationZ[index];
+			rotation.w = mRotationW[index];
+			return rotation;
+		}
+		inline glm::vec3 scale(u32 index) const {
+			return {mScaleX[index], mScaleY[index], mScaleZ[index]};
+		}
+		inline s32 parent_index(u32 index) const { return mParents[index]; }
+		inline bool dirty(u32 index) const { return mDirty[index] != 0; }
+
+		// position and rotation are blended from the previous step by the
+		// next update
+		inline void position(u32 index, const glm::vec3& position) {
+			mPositionX[index] = position.x;
+			mPositionY[index] = position.y;
+			mPositionZ[index] = position.z;
+			mDirty[index] = 1;
+			mMoving[index] = bBlend;
+		}
+		inline void rotation(u32 index, const glm::quat& rotation) {
+			mRotationX[index] = rotation.x;
+			mRotationY[index] = rotation.y;
+			mRotationZ[index] = rotation.z;
+			mRotationW[index] = rotation.w;
+			mDirty[index] = 1;
+			mMoving[index] = bBlend;
+		}
+		inline void scale(u32 index, const glm::vec3& scale) {
+			mScaleX[index] = scale.x;
+			mScaleY[index] = scale.y;
+			mScaleZ[index] = scale.z;
+			mDirty[index] = 1;
+		}
+		inline void parent_index(u32 index, s32 parent) {
+			mParents[index] = parent;
+			mDirty[index] = 1;
+			bHierarchyDirty = true;
+		}
+
+		// remembers the current positions and rotations as the ones of the
+		// previous step, call before every simulated step. Until the first
+		// call transforms are drawn where they are.
+		void save_previous();
+		// recomputes the world matrices of dirty and moving transforms and
+		// everything below them, with positions and rotations blended from
+		// the previous step by alpha, then clears the dirty flags
+		void update(core::ThreadPool& pool, f32 alpha = 1.f);
+		// recomputes a single world matrix without blending, under parent's
+		// world matrix instead of the one at parent_index, and clears its
+		// dirty flag
+		const glm::mat4& update(u32 index, const glm::mat4& parent);
+		// sorted runs of world matrices the last update changed, consumers
+		// that mirror world() have to read them after every update
+		inline const ArrayList<TransformRange>& changed_ranges() const {
+			return mChangedRanges;
+		}
+
+		// world matrices by transform index, valid after update
+		inline std::span<const glm::mat4> world() const { return mWorld; }
+		inline const glm::mat4& world(u32 index) const {
+			return mWorld[index];
+		}
+
+	private:
+		// local matrices of the dirty and moving transforms in [begin, end)
+		void compose(u32 begin, u32 end, f32 alpha);
+		void compose(u32 index, f32 alpha);
+		// world matrices of level entries [begin, end) of mHierarchy.order()
+		void multiply(u32 begin, u32 end);
+		void multiply(u32 index);
+		void collect_changed_ranges();
+
+	private:
+		core::AlignedList<f32> mPositionX{};
+		core::AlignedList<f32> mPositionY{};
+		core::AlignedList<f32> mPositionZ{};
+		core::AlignedList<f32> mRotationX{};
+		core::AlignedList<f32> mRotationY{};
+		core::AlignedList<f32> mRotationZ{};
+		core::AlignedList<f32> mRotationW{};
+		core::AlignedList<f32> mScaleX{};
+		core::AlignedList<f32> mScaleY{};
+		core::AlignedList<f32> mScaleZ{};
+		// state at the start of the current step
+		core::AlignedList<f32> mPreviousPositionX{};
+		core::AlignedList<f32> mPreviousPositionY{};
+		core::AlignedList<f32> mPreviousPositionZ{};
+		core::AlignedList<f32> mPreviousRotationX{};
+		core::AlignedList<f32> mPreviousRotationY{};
+		core::AlignedList<f32> mPreviousRotationZ{};
+		core::AlignedList<f32> mPreviousRotationW{};
+		ArrayList<s32> mParents{};
+		ArrayList<u8> mDirty{};
+		// position or rotation set since the previous step
+		ArrayList<u8> mMoving{};
+		// world matrix recomputed in the current update
+		ArrayList<u8> mChanged{};
+		// the 12 entries of each local matrix that aren't constant, in
+		// column order
+		core::AlignedList<f32> mLocal[12]{};
+		// one cache line per matrix
+		core::AlignedList<glm::mat4, 64> mWorld{};
+		ArrayList<TransformRange> mChangedRanges{};
+		TransformHierarchy mHierarchy{};
+		bool bHierarchyDirty{true};
+		// save_previous was called, positions and rotations are blended
+		bool bBlend{false};
+	};
+
+	inline glm::vec3 TransformView::position() const {
+		return mStore->position(mIndex);
+	}
+	inline glm::quat TransformView::rotation() const {
+		return mStore->rotation(mIndex);
+	}
+	inline glm::vec3 TransformView::scale() const {
+		return mStore->scale(mIndex);
+	}
+	inline s32 TransformView::parent_index() const {
+		return mStore->parent_index(mIndex);
+	}
+	inline bool TransformView::dirty() const { return mStore->dirty(mIndex); }
+	inline const glm::mat4& TransformView::transform() const {
+		return mStore->world(mIndex);
+	}
+} // namespace gameplay
+
+// Transform needs the complete store, and the store hands out Transforms
+#include "gameplay/transform.h"
@@ -1,13 +1,16 @@
 #pragma once
 
 #include <glm/vec3.hpp>
-#include "gameplay/transform.h"
+#include "gameplay/transform_store.h"
 #include "core/types.h"
 #include "physics/physics_types.h"
 
 namespace physics {
 	class AABBCollider {
 	public:
+		AABBCollider(gameplay::TransformStore& transform_list,
+					 u32 transform_index, const glm::vec3& size);
+		// follows the transform transform_list[transform_index] refers to
 		AABBCollider(ArrayList<gameplay::Transform>& transform_list,
 					 u32 transform_index, const glm::vec3& size);
 		AABBCollider(const AABBCollider&) = delete;
@@ -15,12 +18,25 @@ namespace physics {
 		AABBCollider(AABBCollider&&) noexcept;
 		AABBCollider& operator=(AABBCollider&&) noexcept;
 		IntersectData check_collision(const AABBCollider& other) const;
+		// fills distance and normal of hit, object_index is left untouched
+		bool raycast(const Ray& ray, RaycastHit& hit) const;
 		inline const glm::vec3& size() const { return mSize; }
+		inline glm::vec3 center() const {
+			return mTransformList->position(mTransformIndex);
+		}
+		inline BoundingBox bounds() const {
+			const glm::vec3 c = center();
+			return {c - mSize * 0.5f, c + mSize * 0.5f};
+		}
 
 	private:
 		glm::vec3 mSize;
 		s32 mTransformIndex;
-		ArrayList<gameplay::Transform>& mTransformList;
+		// pointer rather than reference so colliders stay move assignable
+		gameplay::TransformStore* mTransformList;
 	};
 
+	// slab test shared by AABB raycasts and sweeps against inflated boxes,
+	// fills distance and normal of hit
+	bool raycast_box(const BoundingBox& box, const Ray& ray, RaycastHit& hit);
 } // namespace physics
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "core/types.h"
+#include "physics/physics_types.h"
+
+namespace physics {
+	// Indices into the physics objects array, first < second.
+	struct BroadphasePair {
+		u32 first;
+		u32 second;
+	};
+
+	// Sort and sweep over the axis with the largest spread of centers.
+	// The proxy order is kept between steps, so the per-step sort is an
+	// insertion sort over an almost sorted array, which is close to linear
+	// when bodies move coherently.
+	class SweepAndPrune {
+	public:
+		// marks a proxy for removal in update
+		static constexpr u32 REMOVED_PROXY = ~0u;
+
+		// ids are opaque to the sweep, update maps them to object indices
+		void add(u32 id);
+		// ids are the object indices into bounds
+		void update(const ArrayList<BoundingBox>& bounds);
+		// indices[id] is the object index into bounds, proxies mapped to
+		// REMOVED_PROXY are dropped. Removal stays O(1) for the caller and
+		// the compaction rides on the pass that reads the bounds anyway.
+		void update(const ArrayList<BoundingBox>& bounds,
+					const ArrayList<u32>& indices);
+		// drops the proxies update would drop, before an id of one of them
+		// is added again
+		void remove_stale(const ArrayList<u32>& indices);
+		inline const ArrayList<BroadphasePair>& pairs() const {
+			return mPairs;
+		}
+		inline u32 size() const { return mProxies.size(); }
+		inline u8 axis() const { return mAxis; }
+
+	private:
+		struct Proxy {
+			BoundingBox bounds;
+			u32 id;
+			// refreshed from the id on every update
+			u32 object_index;
+		};
+
+		template <typename F>
+		void update_proxies(const ArrayList<BoundingBox>& bounds,
+							F&& object_index);
+		void sort_proxies();
+		// pairs of the sorted proxies, a lane of candidates at a time
+		void sweep();
+
+	private:
+		ArrayList<Proxy> mProxies{};
+		ArrayList<BroadphasePair> mPairs{};
+		// radix keys sorting the pairs
+		ArrayList<u64> mPairKeys{};
+		// proxy bounds in sweep order, the sweep axis first, padded by a
+		// lane so whole lanes can be loaded up to the last proxy
+		ArrayList<f32> mSweepMin[3]{};
+		ArrayList<f32> mSweepMax[3]{};
+		u8 mAxis{0};
+		// set when proxies were added or the axis changed, the order is
+		// then far from sorted and a full sort beats insertion sort
+		bool bResort{false};
+	};
+
+	// Uniform grid rebuilt every step, meant for dense piles of similarly
+	// sized bodies. Entries are radix sorted by the 64-bit Morton code of
+	// their cell, so each cell is one run and cells close in space sit close
+	// in memory. Neighbouring cells are found through a hash table keyed by
+	// code. Bounds much larger than the typical one stay out of the grid and
+	// are tested against every other proxy instead.
+	class SpatialHashGrid {
+	public:
+		// objects are the indices into bounds to sort into the grid
+		void update(const ArrayList<BoundingBox>& bounds,
+					const ArrayList<u32>& objects);
+		inline const ArrayList<BroadphasePair>& pairs() const {
+			return mPairs;
+		}
+		// edge length picked by the last update
+		inline f32 cell_size() const { return mCellSize; }
+		// proxies the last update kept out of the grid
+		inline u32 large_count() const { return mLarge.size(); }
+
+	private:
+		struct Entry {
+			BoundingBox bounds;
+			u32 object_index;
+		};
+
+		// a run of mSorted sharing one Morton code
+		struct Cell {
+			u64 code;
+			u32 begin;
+			u32 end;
+		};
+
+		// the code is kept next to the index so a probe touches one line
+		struct CellSlot {
+			u64 code;
+			u32 cell;
+		};
+
+		void add_pairs(const Entry& entry, u32 begin, u32 end);
+
+	private:
+		// unsorted entries of the current step
+		ArrayList<Entry> mEntries{};
+		// Morton code of the cell holding bounds.min per entry and the
+		// entry order, sorted together
+		ArrayList<u64> mCodes{};
+		ArrayList<u32> mOrder{};
+		// mEntries in Morton order
+		ArrayList<Entry> mSorted{};
+		ArrayList<Cell> mCells{};
+		// index into mCells by hashed code, open addressing
+		ArrayList<CellSlot> mCellTable{};
+		ArrayList<Entry> mLarge{};
+		ArrayList<BroadphasePair> mPairs{};
+		// radix keys sorting the pairs
+		ArrayList<u64> mPairKeys{};
+		f32 mCellSize{1.f};
+	};
+} // namespace physics
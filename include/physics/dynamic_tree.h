@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <glm/common.hpp>
+#include <glm/vec3.hpp>
+#include "core/types.h"
+#include "physics/physics_types.h"
+
+namespace physics {
+	constexpr s32 NULL_NODE = -1;
+
+	// Bounding volume hierarchy over fattened collider bounds. Leaves are only
+	// reinserted when the tight bounds leave the fat ones, and the tree is
+	// kept balanced with AVL style rotations on every insertion and removal.
+	class DynamicTree {
+	public:
+		// leaf bounds are grown by this much on every side
+		static constexpr f32 MARGIN = 0.1f;
+		// predicted displacement is stretched by this much when refitting
+		static constexpr f32 DISPLACEMENT_MULTIPLIER = 2.f;
+
+		DynamicTree() = default;
+		// returns the proxy id of the new leaf
+		s32 create_proxy(const BoundingBox& bounds, u32 object_index);
+		void destroy_proxy(s32 proxy);
+		// returns true if the leaf had to be reinserted
+		bool move_proxy(s32 proxy, const BoundingBox& bounds,
+						const glm::vec3& displacement);
+
+		// calls callback(object_index) for every leaf overlapping bounds,
+		// the callback returns false to stop the query
+		template <typename F>
+		void query(const BoundingBox& bounds, F&& callback) const;
+
+		// calls callback(object_index, max_distance) for every leaf hit by
+		// the ray. The callback returns the new max distance, which clips
+		// the ray, or 0 to stop the query.
+		template <typename F>
+		void raycast(const Ray& ray, F&& callback) const;
+
+		// rays traced together by raycast_packet, one SIMD lane each
+		static constexpr u32 PACKET_SIZE = 4;
+		// raycast for up to PACKET_SIZE rays at once, against node bounds
+		// grown by radius for sphere casts. Each node is tested against all
+		// rays together and the traversal descends while any of them hits.
+		// Calls callback(ray, object_index, max_distance) for every ray and
+		// leaf it hits, which returns the new max distance of that ray or 0
+		// to drop it from the packet.
+		template <typename F>
+		void raycast_packet(const Ray* rays, u32 count, f32 radius,
+							F&& callback) const;
+
+		void overlap_aabb(const BoundingBox& bounds, ArrayList<u32>& out) const;
+		void overlap_sphere(const glm::vec3& center, f32 radius,
+							ArrayList<u32>& out) const;
+
+		inline const BoundingBox& fat_bounds(s32 proxy) const {
+			return mNodes[proxy].bounds;
+		}
+		inline u32 object_index(s32 proxy) const {
+			return mNodes[proxy].object_index;
+		}
+		// for owners that move their objects around in memory
+		inline void object_index(s32 proxy, u32 object_index) {
+			mNodes[proxy].object_index = object_index;
+		}
+		inline s32 height() const {
+			return mRoot == NULL_NODE ? 0 : mNodes[mRoot].height;
+		}
+		inline u32 proxy_count() const { return mProxyCount; }
+		// checks parent links, heights and bounds of the whole tree
+		bool validate() const;
+
+	private:
+		struct Node {
+			BoundingBox bounds;
+			// next free node when the node is unused
+			s32 parent{NULL_NODE};
+			s32 children[2]{NULL_NODE, NULL_NODE};
+			// leaves are 0, free nodes -1
+			s32 height{-1};
+			u32 object_index{0};
+
+			inline bool is_leaf() const { return children[0] == NULL_NODE; }
+		};
+
+		static constexpr u32 STACK_SIZE = 256;
+
+		struct RayPacket {
+			alignas(16) f32 origin[3][PACKET_SIZE];
+			alignas(16) f32 inverse_direction[3][PACKET_SIZE];
+			alignas(16) f32 max_distance[PACKET_SIZE];
+		};
+
+		// bit i is set if ray i of the packet hits bounds grown by radius
+		static u32 packet_mask(const BoundingBox& bounds, f32 radius,
+							   const RayPacket& packet);
+
+		s32 allocate_node();
+		void free_node(s32 node);
+		void insert_leaf(s32 leaf);
+		void remove_leaf(s32 leaf);
+		s32 balance(s32 node);
+		bool validate(s32 node) const;
+
+	private:
+		ArrayList<Node> mNodes{};
+		s32 mRoot{NULL_NODE};
+		s32 mFreeList{NULL_NODE};
+		u32 mProxyCount{0};
+	};
+
+	template <typename F>
+	void DynamicTree::query(const BoundingBox& bounds, F&& callback) const {
+		if (mRoot == NULL_NODE) {
+			return;
+		}
+		s32 stack[STACK_SIZE];
+		u32 count = 0;
+		stack[count++] = mRoot;
+		while (count > 0) {
+			const Node& node = mNodes[stack[--count]];
+			if (!node.bounds.overlaps(bounds)) {
+				continue;
+			}
+			if (node.is_leaf()) {
+				if (!callback(node.object_index)) {
+					return;
+				}
+			} else {
+				assert(count + 2 <= STACK_SIZE);
+				stack[count++] = node.children[0];
+				stack[count++] = node.children[1];
+			}
+		}
+	}
+
+	template <typename F>
+	void DynamicTree::raycast(const Ray& ray, F&& callback) const {
+		if (mRoot == NULL_NODE) {
+			return;
+		}
+		const glm::vec3 inverse_direction = 1.f / ray.direction;
+		f32 max_distance = ray.max_distance;
+		s32 stack[STACK_SIZE];
+		u32 count = 0;
+		stack[count++] = mRoot;
+		while (count > 0) {
+			const Node& node = mNodes[stack[--count]];
+			// slab test against the node bounds
+			const glm::vec3 t0 =
+				(node.bounds.min - ray.origin) * inverse_direction;
+			const glm::vec3 t1 =
+				(node.bounds.max - ray.origin) * inverse_direction;
+			const glm::vec3 t_min = glm::min(t0, t1);
+			const glm::vec3 t_max = glm::max(t0, t1);
+			const f32 enter = glm::max(glm::max(t_min.x, t_min.y),
+									   glm::max(t_min.z, 0.f));
+			const f32 exit = glm::min(glm::min(t_max.x, t_max.y),
+									  glm::min(t_max.z, max_distance));
+			if (enter > exit) {
+				continue;
+			}
+			if (node.is_leaf()) {
+				max_distance = callback(node.object_index, max_distance);
+				if (max_distance <= 0.f) {
+					return;
+				}
+			} else {
+				assert(count + 2 <= STACK_SIZE);
+				stack[count++] = node.children[0];
+				stack[count++] = node.children[1];
+			}
+		}
+	}
+
+	template <typename F>
+	void DynamicTree::raycast_packet(const Ray* rays, u32 count, f32 radius,
+									 F&& callback) const {
+		assert(count <= PACKET_SIZE);
+		if (mRoot == NULL_NODE || count == 0) {
+			return;
+		}
+		RayPacket packet;
+		for (u32 lane = 0; lane < PACKET_SIZE; ++lane) {
+			// unused lanes copy the last ray and never hit anything
+			const Ray& ray = rays[std::min(lane, count - 1)];
+			for (u32 axis = 0; axis < 3; ++axis) {
+				packet.origin[axis][lane] = ray.origin[axis];
+				packet.inverse_direction[axis][lane] =
+					1.f / ray.direction[axis];
+			}
+			packet.max_distance[lane] = lane < count ? ray.max_distance : -1.f;
+		}
+		u32 active = (1u << count) - 1;
+		s32 stack[STACK_SIZE];
+		u32 size = 0;
+		stack[size++] = mRoot;
+		while (size > 0) {
+			const Node& node = mNodes[stack[--size]];
+			u32 mask = packet_mask(node.bounds, radius, packet) & active;
+			if (mask == 0) {
+				continue;
+			}
+			if (!node.is_leaf()) {
+				assert(size + 2 <= STACK_SIZE);
+				stack[size++] = node.children[0];
+				stack[size++] = node.children[1];
+				continue;
+			}
+			for (; mask != 0; mask &= mask - 1) {
+				const u32 lane = std::countr_zero(mask);
+				f32& max_distance = packet.max_distance[lane];
+				max_distance = callback(lane, node.object_index, max_distance);
+				if (max_distance <= 0.f) {
+					max_distance = -1.f;
+					active &= ~(1u << lane);
+				}
+			}
+			if (active == 0) {
+				return;
+			}
+		}
+	}
+} // namespace physics
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "core/types.h"
+
+namespace physics {
+	// Union-find over physics object indices. Bodies connected through
+	// contacts end up in the same island and sleep or wake together.
+	class Islands {
+	public:
+		// every index in its own island
+		void reset(u32 count);
+		// index of the island root, compresses the path on the way
+		u32 find(u32 index);
+		void merge(u32 a, u32 b);
+		inline u32 size() const { return mParents.size(); }
+
+	private:
+		ArrayList<u32> mParents{};
+		// upper bound of the tree height below each root
+		ArrayList<u8> mRanks{};
+	};
+} // namespace physics
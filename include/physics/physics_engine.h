@@ -2,12 +2,17 @@
 
 #include <filesystem>
 #include <optional>
+#include <span>
 #include "assets/scene/gltf_importer.h"
 #include "core/input.h"
 #include "core/types.h"
 #include "gameplay/movement_component.h"
 #include "physics/aabb_collider.h"
+#include "physics/broadphase.h"
+#include "physics/dynamic_tree.h"
+#include "physics/islands.h"
 #include "physics/plane_collider.h"
+#include "physics/sphere_batch.h"
 #include "physics/sphere_collider.h"
 
 namespace core {
@@ -21,17 +26,53 @@ namespace tinygltf {
 
 namespace physics {
 
+	struct PhysicsObjectSettings {
+		s32 transform_index;
+		ColliderType type;
+		ColliderSettings settings;
+		std::optional<gameplay::MovementComponent> movement_comp{};
+		std::optional<RigidBody> rb{};
+	};
+
 	class Engine {
 	public:
-		Engine(core::Engine* core_engine);
-		// returns index of the newly added physics object
-		s32 add_physics_object(
+		Engine(core::Engine* core_engine,
+			   BroadphaseType broadphase = BroadphaseType::SweepAndPrune);
+		PhysicsHandle add_physics_object(
 			s32 transform_index, ColliderType type, ColliderSettings settings,
 			std::optional<gameplay::MovementComponent> movement_comp = {},
 			std::optional<RigidBody> rb = {});
+		// reserves storage once for the whole batch, appends to handles
+		void
+		add_physics_objects(const ArrayList<PhysicsObjectSettings>& objects,
+							ArrayList<PhysicsHandle>& handles);
+		// moves the last object and its components into the freed slots,
+		// returns false for stale handles
+		bool remove_physics_object(PhysicsHandle handle);
+
+		inline bool valid(PhysicsHandle handle) const {
+			return handle.slot < mSlotGenerations.size() &&
+				mSlotGenerations[handle.slot] == handle.generation &&
+				mSlotIndices[handle.slot] != INVALID_INDEX;
+		}
+		// current object index of the handle, -1 if stale
+		inline s32 index(PhysicsHandle handle) const {
+			return valid(handle) ? mSlotIndices[handle.slot] : -1;
+		}
+		inline PhysicsHandle handle(u32 object_index) const {
+			const u32 slot = mObjectSlots[object_index];
+			return {slot, mSlotGenerations[slot]};
+		}
 
 		void handle_input_event(core::PollResult& poll_result);
 		void simulate(f32 delta_time);
+		// stages of simulate, public so benchmarks can time them alone
+		// fills broadphase_pairs() with potentially colliding objects
+		void broadphase(f32 delta_time);
+		// fills collisions() from broadphase_pairs()
+		void narrowphase();
+		// solves collisions() for velocities, then pushes objects apart
+		void resolve_contacts();
 		void handle_collisions();
         void load_scene(const asset::GLTFImporter& scene_asset);
 
@@ -48,13 +89,72 @@ namespace physics {
 		inline const ArrayList<AABBCollider>& aabb_colliders() const {
 			return mAABBs;
 		}
+		inline const SphereBatch& sphere_batch() const { return mSphereBatch; }
 		inline const ArrayList<PlaneCollider>& plane_colliders() const {
 			return mPlanes;
 		}
+		inline const ArrayList<BroadphasePair>& broadphase_pairs() const {
+			return mPairs;
+		}
+		inline const ArrayList<CollisionContact>& collisions() const {
+			return mCollisions;
+		}
+		inline const DynamicTree& tree() const { return mTree; }
+		inline BroadphaseType broadphase_type() const {
+			return mBroadphaseType;
+		}
+
+		// closest hit against sphere, AABB and plane colliders
+		bool raycast(const Ray& ray, RaycastHit& hit) const;
+		// closest hit of a sphere of radius swept along the ray, distance is
+		// how far its center travels. Boxes are grown by radius, which makes
+		// hits around their edges and corners slightly early.
+		bool spherecast(const Ray& ray, f32 radius, RaycastHit& hit) const;
+		// hits[i] is the closest hit of rays[i], with object_index NO_HIT on
+		// a miss, and the number of hits is returned. Only the first
+		// hits.size() rays are cast when hits is shorter. Rays are traced in
+		// packets and big batches are split over the worker threads, so
+		// neither may be called while simulate runs.
+		u32 raycast_batch(std::span<const Ray> rays,
+						  std::span<RaycastHit> hits) const;
+		u32 spherecast_batch(std::span<const Ray> rays, f32 radius,
+							 std::span<RaycastHit> hits) const;
+		// physics object indices of colliders overlapping the shape
+		void overlap_sphere(const glm::vec3& center, f32 radius,
+							ArrayList<u32>& out) const;
+		void overlap_aabb(const BoundingBox& bounds, ArrayList<u32>& out) const;
+
+		// wakes the island of the object on the next step
+		void wake(u32 object_index);
+
+		// world space, radians per second. Objects without a rigid body,
+		// boxes and zero sized spheres don't rotate and ignore the setter.
+		glm::vec3 angular_velocity(u32 object_index) const;
+		void angular_velocity(u32 object_index, const glm::vec3& velocity);
+		// body space inverse inertia diagonals, indexed like the rigid
+		// bodies
+		inline const ArrayList<glm::vec3>& inverse_inertia() const {
+			return mInverseInertia;
+		}
+
+		// Flat copy of the simulation state, reusing the capacity of out.
+		// Restoring it and stepping again reproduces the original steps bit
+		// for bit. Rolling back without adds or removes in between only
+		// copies arrays, otherwise colliders and proxies are rebuilt.
+		// Snapshots are meant for the process that took them.
+		void snapshot(ArrayList<u8>& out) const;
+		// false for blobs of another layout, truncated or inconsistent ones,
+		// the engine is left untouched then
+		bool restore(const ArrayList<u8>& snapshot);
+
 		inline void iterations(u32 iterations) { mMaxIterations = iterations; }
 		inline u32 iterations() const { return mMaxIterations; }
 
 	private:
+		static constexpr u32 INVALID_INDEX = SweepAndPrune::REMOVED_PROXY;
+		// rays per worker chunk of a batched query
+		static constexpr u32 QUERY_CHUNK_SIZE = 64;
+
 		struct Node {
 			Node* parent{nullptr};
 			ArrayList<Node*> children{};
@@ -68,24 +168,205 @@ namespace physics {
 			}
 		};
 
+		// scratch of one narrowphase chunk, kept between steps so the
+		// buffers are only allocated while the scene grows
+		struct NarrowphaseChunk {
+			// sphere pairs of the chunk for the batched test
+			ArrayList<u32> sphere_first{};
+			ArrayList<u32> sphere_second{};
+			ArrayList<IntersectData> sphere_results{};
+			ArrayList<CollisionContact> contacts{};
+		};
+
+		struct CachedImpulse {
+			u64 key;
+			f32 impulse;
+		};
+
+		// arrays restore reads a snapshot into, swapped with the live ones
+		// once the snapshot checks out. Kept between calls so rolling back
+		// every frame reuses the memory of the state it replaced.
+		struct RestoreScratch {
+			ArrayList<PhysicsObject> objects{};
+			ArrayList<gameplay::MovementComponent> movement_components{};
+			ArrayList<RigidBody> rigid_bodies{};
+			ArrayList<glm::vec3> angular_velocities{};
+			ArrayList<glm::vec3> inverse_inertia{};
+			ArrayList<u32> sphere_owners{};
+			ArrayList<u32> aabb_owners{};
+			ArrayList<u32> plane_owners{};
+			ArrayList<u32> movement_owners{};
+			ArrayList<u32> rigid_body_owners{};
+			ArrayList<u32> slot_indices{};
+			ArrayList<u32> slot_generations{};
+			ArrayList<u32> free_slots{};
+			ArrayList<u32> object_slots{};
+			ArrayList<BoundingBox> bounds{};
+			ArrayList<f32> sleep_times{};
+			ArrayList<CachedImpulse> contact_cache{};
+		};
+
+		// solver view of one contact
+		struct ContactConstraint {
+			// movement component of each object, -1 if it has none
+			s32 movement[2];
+			f32 inverse_mass[2];
+			// rigid body of each object for the angular terms, -1 if it
+			// doesn't rotate
+			s32 rigidbody[2];
+			// positions the contact was generated at
+			glm::vec3 position[2];
+			// contact point relative to position
+			glm::vec3 offset[2];
+			// world inverse inertia times offset x normal, the change in
+			// angular velocity per unit impulse
+			glm::vec3 angular_response[2];
+			glm::vec3 normal;
+			// inverse of the effective inverse mass along the normal,
+			// linear and angular
+			f32 normal_mass;
+			// separating velocity the solver aims for
+			f32 target_velocity;
+			// accumulated over the iterations, clamped to pushing only
+			f32 normal_impulse;
+			u64 key;
+		};
+
 		glm::vec3 compute_force(const RigidBody& rb);
+		// integrates physics objects [begin, end), disjoint ranges can run
+		// concurrently as every object owns its transform and movement
+		void integrate(u32 begin, u32 end, f32 delta_time);
+		// integrates the orientation of rigid bodies [begin, end) into
+		// their transforms, after the linear pass
+		void integrate_rotations(u32 begin, u32 end, f32 delta_time);
+
+		// moves bullets that passed through an AABB or plane during
+		// integration back to just inside the first surface they hit
+		void sweep_bullets(f32 delta_time);
+
+		// swap and pop for component arrays, fixing up the owner of the
+		// component that moved into index
+		template <typename T>
+		void remove_component(ArrayList<T>& components, ArrayList<u32>& owners,
+							  u32 index, s32 PhysicsObject::*component_index);
+		// points everything that refers to object from at object to
+		void move_object(u32 from, u32 to);
+
+		// closest hits of up to DynamicTree::PACKET_SIZE rays, radius 0
+		// for raycasts
+		void cast_packet(const Ray* rays, u32 count, f32 radius,
+						 RaycastHit* hits) const;
+		u32 cast_batch(std::span<const Ray> rays, f32 radius,
+					   std::span<RaycastHit> hits) const;
+		// sphere of radius swept along ray against one collider
+		bool cast(const Ray& ray, f32 radius, u32 object_index,
+				  RaycastHit& hit) const;
+
+		// refreshes mBounds and refits the tree leaves
+		void update_bounds(f32 delta_time);
+		// contacts of mPairs [begin, end) into chunk.contacts
+		void narrowphase(u32 begin, u32 end, NarrowphaseChunk& chunk) const;
+
+		// narrowphase entries, indexed by the collider types of a pair with
+		// the lower type first. Fill contact and return true on overlap.
+		using CollideFunction = bool (Engine::*)(const PhysicsObject& a,
+												 const PhysicsObject& b,
+												 CollisionContact& contact)
+			const;
+		bool collide_sphere_sphere(const PhysicsObject& a,
+								   const PhysicsObject& b,
+								   CollisionContact& contact) const;
+		bool collide_sphere_aabb(const PhysicsObject& a, const PhysicsObject& b,
+								 CollisionContact& contact) const;
+		bool collide_sphere_plane(const PhysicsObject& a,
+								  const PhysicsObject& b,
+								  CollisionContact& contact) const;
+		bool collide_aabb_aabb(const PhysicsObject& a, const PhysicsObject& b,
+							   CollisionContact& contact) const;
+		bool collide_aabb_plane(const PhysicsObject& a, const PhysicsObject& b,
+								CollisionContact& contact) const;
+		f32 restitution(const PhysicsObject& a, const PhysicsObject& b) const;
+
+		// groups touching bodies into islands and puts islands to sleep
+		// once all their bodies stayed slow for long enough
+		void update_islands(f32 delta_time);
 
 		void load_node(const tinygltf::Node* inputNode,
 					   const tinygltf::Model* input, Node* parent);
-        f32 calculate_separating_velocity(const CollisionContact& contact);
-        void resolve_velocity(f32 duration);
-        void resolve_interpenetration(f32 duration);
-		void resolve_contacts(f32 duration);
+		// builds mConstraints from mCollisions and applies last step's
+		// impulses of the same pairs
+		void prepare_contacts();
+		// one sequential impulse pass over mConstraints
+		void solve_velocities();
+		// velocity of the contact point of object j, zero if static
+		glm::vec3 contact_velocity(const ContactConstraint& constraint,
+								   u32 j) const;
+		// applies impulse along the normal, positive pushes objects[0]
+		void apply_impulse(const ContactConstraint& constraint, f32 impulse);
+		// writes the accumulated impulses to mContactCache
+		void store_impulses();
+		void resolve_interpenetration();
 
 	private:
 		core::Engine* mCoreEngine{nullptr};
 		ArrayList<PhysicsObject> mPhysicsObjects{};
 		ArrayList<gameplay::MovementComponent> mMovementComponents{};
 		ArrayList<RigidBody> mRigidBodies{};
+		// angular state of mRigidBodies, same indexing, kept out of
+		// RigidBody so the linear integration doesn't stream it
+		ArrayList<glm::vec3> mAngularVelocities{};
+		ArrayList<glm::vec3> mInverseInertia{};
 		ArrayList<SphereCollider> mSpheres{};
 		ArrayList<AABBCollider> mAABBs{};
 		ArrayList<PlaneCollider> mPlanes{};
+		// owning physics object of each component, same indexing as the
+		// component arrays
+		ArrayList<u32> mSphereOwners{};
+		ArrayList<u32> mAABBOwners{};
+		ArrayList<u32> mPlaneOwners{};
+		ArrayList<u32> mMovementOwners{};
+		ArrayList<u32> mRigidBodyOwners{};
+		// slot map, handles index mSlotIndices and mSlotGenerations, which
+		// point into the dense object arrays
+		ArrayList<u32> mSlotIndices{};
+		ArrayList<u32> mSlotGenerations{};
+		ArrayList<u32> mFreeSlots{};
+		// a removed object's sweep proxy lingers until the next update, its
+		// slot can't be handed out again before the sweep drops it
+		bool bSweepStale{false};
+		// slot of each physics object, also the sweep and prune proxy id
+		ArrayList<u32> mObjectSlots{};
+		// positions and radii of mSpheres, same indexing
+		SphereBatch mSphereBatch{};
+		ArrayList<NarrowphaseChunk> mNarrowphaseChunks{};
+		// indexed by physics object, only valid for sphere and AABB objects
+		ArrayList<BoundingBox> mBounds{};
+		// shared spatial index for queries, also the broadphase when
+		// mBroadphaseType is DynamicTree
+		DynamicTree mTree{};
+		// tree proxy per physics object, NULL_NODE if not in the tree
+		ArrayList<s32> mTreeProxies{};
+		SweepAndPrune mSweepAndPrune{};
+		SpatialHashGrid mSpatialHash{};
+		// objects with bounds, the input of mSpatialHash
+		ArrayList<u32> mGridObjects{};
+		BroadphaseType mBroadphaseType{BroadphaseType::SweepAndPrune};
+		ArrayList<BroadphasePair> mPairs{};
+		Islands mIslands{};
+		// seconds each object has been below the sleep velocity
+		ArrayList<f32> mSleepTimes{};
+		// smallest sleep time per island root
+		ArrayList<f32> mIslandSleepTimes{};
         ArrayList<CollisionContact> mCollisions{};
-		u32 mMaxIterations;
+		ArrayList<ContactConstraint> mConstraints{};
+		// accumulated normal impulse of each pair in the last step, sorted
+		// by the slots of the pair so it survives removals. Flat rather
+		// than hashed so snapshots copy it in one go.
+		ArrayList<CachedImpulse> mContactCache{};
+		RestoreScratch mRestoreScratch{};
+		// changes whenever objects are added or removed, unique across
+		// engines so a snapshot can tell whether its structure still matches
+		u64 mStructureVersion{0};
+		u32 mMaxIterations{8};
 	};
 } // namespace physics
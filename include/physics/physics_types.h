@@ -5,6 +5,20 @@
 namespace physics {
 	enum class ColliderType : u8 { None, Sphere, AABB, Plane, MAX };
 
+	enum class BroadphaseType : u8 { SweepAndPrune, DynamicTree, SpatialHash };
+
+	// Stable reference to a physics object. Object indices change when other
+	// objects are removed, handles don't, and go stale once their object is
+	// removed.
+	struct PhysicsHandle {
+		u32 slot{~0u};
+		u32 generation{0};
+
+		inline bool operator==(const PhysicsHandle& other) const {
+			return slot == other.slot && generation == other.generation;
+		}
+	};
+
 	struct PhysicsObject {
 		s32 transform_index;
 		s32 collider_component_index;
@@ -12,6 +26,8 @@ namespace physics {
 		s32 rigidbody_component_index;
 		ColliderType collider_type;
 		bool has_input{false};
+		// skipped by integration and the broadphase until woken
+		bool sleeping{false};
 	};
 
 	union ColliderSettings {
@@ -25,13 +41,49 @@ namespace physics {
 		f32 inverse_mass = 1;
 		f32 gravity_factor = 1;
 		f32 damping = 1;
+		f32 restitution = 0.5f;
+		// sphere bodies only, swept against AABBs and planes each step so
+		// they can't pass through thin geometry
+		bool bullet = false;
 	};
 
 	struct CollisionContact {
-		const PhysicsObject* objects[2];
+		// physics object indices, valid until an object is removed
+		u32 objects[2];
 		f32 restitution;
+		// points from objects[1] towards objects[0]
 		glm::vec3 contact_normal;
+		// penetration depth, positive while overlapping
+		f32 distance;
+		// world space point the contact acts on
+		glm::vec3 contact_point;
+	};
+
+	struct BoundingBox {
+		glm::vec3 min;
+		glm::vec3 max;
+
+		inline bool overlaps(const BoundingBox& other) const {
+			return min.x <= other.max.x && max.x >= other.min.x &&
+				min.y <= other.max.y && max.y >= other.min.y &&
+				min.z <= other.max.z && max.z >= other.min.z;
+		}
+	};
+
+	struct Ray {
+		glm::vec3 origin;
+		// expected to be normalized
+		glm::vec3 direction;
+		f32 max_distance{MAX_F32};
+	};
+
+	// object_index of batched query results that hit nothing
+	constexpr u32 NO_HIT = ~0u;
+
+	struct RaycastHit {
+		u32 object_index;
 		f32 distance;
+		glm::vec3 normal;
 	};
 
 	struct IntersectData {
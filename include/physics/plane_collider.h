@@ -15,6 +15,8 @@ namespace physics {
 		PlaneCollider& operator=(PlaneCollider&&) = default;
 		PlaneCollider normalized() const;
 		IntersectData check_collision(const SphereCollider& sphere);
+		// fills distance and normal of hit, object_index is left untouched
+		bool raycast(const Ray& ray, RaycastHit& hit) const;
 		inline const glm::vec3& normal() const { return mNormal; }
 		inline const f32 distance() const { return mDistance; }
 		inline void normal(const glm::vec3& other) { mNormal = other; }
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include "core/types.h"
+#include "physics/physics_types.h"
+
+namespace physics {
+	// Structure of arrays copy of the sphere colliders. The engine gathers it
+	// once per step so the narrowphase streams through contiguous floats
+	// instead of reading a whole transform per sphere. Kernels use AVX2 or
+	// SSE lanes depending on what the translation unit is compiled with.
+	class SphereBatch {
+	public:
+		inline u32 push(const glm::vec3& center, f32 radius) {
+			mX.push_back(center.x);
+			mY.push_back(center.y);
+			mZ.push_back(center.z);
+			mRadius.push_back(radius);
+			return mX.size() - 1;
+		}
+
+		inline void set(u32 index, const glm::vec3& center) {
+			mX[index] = center.x;
+			mY[index] = center.y;
+			mZ[index] = center.z;
+		}
+
+		inline void set(u32 index, const glm::vec3& center, f32 radius) {
+			set(index, center);
+			mRadius[index] = radius;
+		}
+
+		// moves the last sphere into index, like the collider arrays
+		inline void remove(u32 index) {
+			mX[index] = mX.back();
+			mY[index] = mY.back();
+			mZ[index] = mZ.back();
+			mRadius[index] = mRadius.back();
+			mX.pop_back();
+			mY.pop_back();
+			mZ.pop_back();
+			mRadius.pop_back();
+		}
+
+		inline glm::vec3 center(u32 index) const {
+			return {mX[index], mY[index], mZ[index]};
+		}
+		inline f32 radius(u32 index) const { return mRadius[index]; }
+		inline u32 size() const { return mX.size(); }
+
+		void clear();
+		void reserve(u32 count);
+
+		// tests sphere index against spheres [first, first + count)
+		void check_collision_range(u32 index, u32 first, u32 count,
+								   IntersectData* out) const;
+		// tests sphere index against spheres others[0, count)
+		void check_collision(u32 index, const u32* others, u32 count,
+							 IntersectData* out) const;
+		// tests spheres first[i] against second[i] for i in [0, count)
+		void check_collision(const u32* first, const u32* second, u32 count,
+							 IntersectData* out) const;
+
+	private:
+		ArrayList<f32> mX{};
+		ArrayList<f32> mY{};
+		ArrayList<f32> mZ{};
+		ArrayList<f32> mRadius{};
+	};
+} // namespace physics
@@ -1,12 +1,15 @@
 #pragma once
 #include <glm/vec3.hpp>
-#include "gameplay/transform.h"
+#include "gameplay/transform_store.h"
 #include "core/types.h"
 #include "physics/physics_types.h"
 
 namespace physics {
 	class SphereCollider {
 	public:
+		SphereCollider(gameplay::TransformStore& transform_list,
+					   s32 transform_index, float radius);
+		// follows the transform transform_list[transform_index] refers to
 		SphereCollider(ArrayList<gameplay::Transform>& transform_list,
 					   s32 transform_index, float radius);
 		SphereCollider(const SphereCollider&) = delete;
@@ -14,14 +17,26 @@ namespace physics {
 		SphereCollider(SphereCollider&& other) noexcept;
 		SphereCollider& operator=(SphereCollider&&) noexcept;
 		IntersectData check_collision(const SphereCollider& other) const;
+		// fills distance and normal of hit, object_index is left untouched
+		bool raycast(const Ray& ray, RaycastHit& hit) const;
 		inline float radius() const { return mRadius; }
-		inline const glm::vec3& center() const {
-			return mTransformList[mTransformIndex].position();
+		inline glm::vec3 center() const {
+			return mTransformList->position(mTransformIndex);
+		}
+		inline BoundingBox bounds() const {
+			const glm::vec3 c = center();
+			return {c - mRadius, c + mRadius};
 		}
 
 	private:
 		float mRadius;
 		s32 mTransformIndex;
-		ArrayList<gameplay::Transform>& mTransformList;
+		// pointer rather than reference so colliders stay move assignable
+		gameplay::TransformStore* mTransformList;
 	};
+
+	// shared by sphere raycasts and sphere casts against grown spheres,
+	// fills distance and normal of hit
+	bool raycast_sphere(const glm::vec3& center, f32 radius, const Ray& ray,
+						RaycastHit& hit);
 } // namespace physics
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include "core/types.h"
+#include "render/vulkan/image.h"
+#include "render/vulkan/types.h"
+
+namespace render::vulkan {
+	class VulkanRenderer;
+
+	// Mip chain of the farthest depth in every region of the depth
+	// attachment, for occlusion tests against what was drawn so far. Level 0
+	// is half the attachment rounded up and every level halves the one
+	// before the same way, so texel t of level l covers the attachment's
+	// pixels [t, t + 1) * 2^(l + 1). Built by a compute downsample, one
+	// dispatch per level, and kept in the general layout.
+	class DepthPyramid {
+	public:
+		// invocations per side of a downsample workgroup, local_size of
+		// depth_reduce.comp.glsl
+		static constexpr u32 GROUP_SIZE = 8;
+
+		DepthPyramid() = default;
+		// depth has to be a sampled depth attachment of extent
+		DepthPyramid(VulkanRenderer* renderer, const Image& depth,
+					 VkExtent2D extent);
+		DepthPyramid(const DepthPyramid&) = delete;
+		DepthPyramid& operator=(const DepthPyramid&) = delete;
+		DepthPyramid(DepthPyramid&& other) noexcept;
+		DepthPyramid& operator=(DepthPyramid&& other) noexcept;
+		~DepthPyramid();
+
+		// records the downsample of depth, which has to be in the depth
+		// attachment layout and is left in it
+		void build(VkCommandBuffer buf, VkImage depth);
+
+		// the whole chain as a combined image sampler at binding 0
+		inline VkDescriptorSet read_set() const { return mReadSet; }
+		inline VkDescriptorSetLayout read_layout() const {
+			return mReadLayout;
+		}
+		// of the depth attachment, not of level 0
+		inline VkExtent2D extent() const { return mExtent; }
+		inline u32 level_count() const { return mLevelCount; }
+
+	private:
+		void destroy();
+
+	private:
+		VkDevice mDevice{};
+		VmaAllocator mAllocator{};
+		VkImage mImage{};
+		VmaAllocation mMemory{};
+		// every level, for the occlusion tests
+		VkImageView mView{};
+		// one per level, written by the downsample
+		ArrayList<VkImageView> mLevelViews{};
+		VkSampler mSampler{};
+		// owns every set below, destroyed with the pyramid
+		VkDescriptorPool mDescriptorPool{};
+		// level i reads level i - 1, or the depth attachment for level 0
+		ArrayList<VkDescriptorSet> mReduceSets{};
+		VkDescriptorSet mReadSet{};
+		VkDescriptorSetLayout mReadLayout{};
+		VkPipelineLayout mReduceLayout{};
+		VkPipeline mReducePipeline{};
+		VkExtent2D mExtent{};
+		u32 mLevelCount{0};
+	};
+} // namespace render::vulkan
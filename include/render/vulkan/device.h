@@ -17,6 +17,7 @@ namespace render::vulkan {
 		ObjectLifetime mLifetime{ObjectLifetime::TEMP};
 		VkQueue mGraphicsQueue{};
 		u32 mGraphicsQueueFamily{};
+		bool bDrawIndirectCount{false};
 
 	public:
 		Device() = default;
@@ -53,5 +54,8 @@ namespace render::vulkan {
 		}
 
 		inline VmaAllocator allocator() { return mAllocator; }
+
+		// vkCmdDrawIndexedIndirectCount is enabled
+		inline bool draw_indirect_count() const { return bDrawIndirectCount; }
 	};
 } // namespace render::vulkan
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <span>
+#include "core/thread_pool.h"
+#include "core/types.h"
+#include "gameplay/frustum.h"
+
+namespace render::vulkan {
+	// laid out like VkDrawIndexedIndirectCommand, lists of them are copied
+	// into indirect buffers as they are
+	struct DrawCommand {
+		u32 index_count;
+		u32 instance_count;
+		u32 first_index;
+		s32 vertex_offset;
+		u32 first_instance;
+	};
+
+	// consecutive draw commands sharing their pipeline and descriptor sets,
+	// material_index is any of their materials, -1 is the default one
+	struct DrawBatch {
+		s32 material_index;
+		u32 first_command;
+		u32 command_count;
+	};
+
+	// CPU side frustum culling of a model's draw commands, for devices
+	// without drawIndirectCount. Bounding spheres are moved to world space
+	// and tested 8 (AVX2) or 4 (SSE) at a time on the workers, then the
+	// visible commands are packed batch by batch so the draw list keeps the
+	// material order and each batch is still one indirect draw.
+	class DrawCuller {
+	public:
+		// commands per worker chunk, a multiple of every lane width
+		static constexpr u32 CHUNK_SIZE = 256;
+
+		// commands sorted by batch, bounds[i] is the bounding sphere of
+		// commands[i] in the space of its first_instance transform with the
+		// radius in w
+		void assign(const ArrayList<DrawCommand>& commands,
+					const ArrayList<glm::vec4>& bounds,
+					const ArrayList<DrawBatch>& batches);
+
+		// world holds the matrix of every transform, commands whose
+		// transform isn't in it are never culled
+		void cull(const gameplay::Frustum& frustum,
+				  std::span<const glm::mat4> world, core::ThreadPool& pool);
+
+		inline u32 size() const { return mCommands.size(); }
+		inline const ArrayList<DrawCommand>& commands() const {
+			return mCommands;
+		}
+		inline const ArrayList<DrawBatch>& batches() const { return mBatches; }
+
+		// the commands that passed the last cull, in batch order
+		inline const ArrayList<DrawCommand>& visible_commands() const {
+			return mVisibleCommands;
+		}
+		// batches over visible_commands, empty ones are left out
+		inline const ArrayList<DrawBatch>& visible_batches() const {
+			return mVisibleBatches;
+		}
+
+	private:
+		// sphere tests of commands [begin, end) into mVisible
+		void test(const gameplay::Frustum& frustum,
+				  std::span<const glm::mat4> world, u32 begin, u32 end);
+
+	private:
+		ArrayList<DrawCommand> mCommands{};
+		ArrayList<glm::vec4> mBounds{};
+		ArrayList<DrawBatch> mBatches{};
+		ArrayList<u8> mVisible{};
+		ArrayList<DrawCommand> mVisibleCommands{};
+		ArrayList<DrawBatch> mVisibleBatches{};
+	};
+} // namespace render::vulkan
@@ -57,6 +57,9 @@ namespace render::vulkan::builder {
 
 		VkPipeline build_pipeline(VkDevice device, VkRenderPass pass);
 
+		// from the single compute shader module added, after build_layout
+		VkPipeline build_compute_pipeline(VkDevice device);
+
 		PipelineBuilder& set_shaders(render::vulkan::ShaderSet* set);
 
 		inline VkPipelineLayout layout() const { return mPipelineLayout; }
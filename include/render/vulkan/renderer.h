@@ -3,9 +3,11 @@
 #include <vector>
 #include <vulkan/vulkan_core.h>
 #include "assets/scene/gltf_importer.h"
+#include "core/thread_pool.h"
 #include "gameplay/camera.h"
-#include "gameplay/transform.h"
+#include "gameplay/transform_store.h"
 #include "render/vulkan/descriptor_allocator.h"
+#include "render/vulkan/depth_pyramid.h"
 #include "render/vulkan/descriptor_set_builder.h"
 #include "render/vulkan/device.h"
 #include "render/vulkan/image.h"
@@ -16,6 +18,8 @@
 #include "render/vulkan/surface.h"
 #include "render/vulkan/swapchain.h"
 #include "render/vulkan/types.h"
+#include "render/vulkan/upload_ring.h"
+#include "render/vulkan/upload_tracker.h"
 
 struct SDL_Window;
 
@@ -23,6 +27,9 @@ namespace render::vulkan {
 
 	constexpr u32 MAXIMUM_FRAMES_IN_FLIGHT = 2;
 	constexpr u32 MAX_OBJECTS = 1000;
+	// shared by the frames in flight, for uniform and storage data rewritten
+	// every frame. Minimum size, reserve_transient grows it for the scene.
+	constexpr u32 TRANSIENT_RING_SIZE = 1024 * 1024;
 
 	struct VertexBuffer {
 		u32 size{0};
@@ -37,11 +44,21 @@ namespace render::vulkan {
 		void init_commands();
 		void init_framebuffers();
 		void init_default_renderpass();
+		// clear starts from a cleared framebuffer instead of the last pass's
+		// contents, present leaves the color image ready for presenting
+		VkRenderPass create_renderpass(bool clear, bool present);
 		void init_sync_objects();
 		void init_descriptors();
+		void create_transient_buffer(u32 size);
 		void init_scene();
 		size_t pad_uniform_buffer(size_t original_size);
-		void begin_renderpass(FrameData& frame_data, u32& image_index);
+		// waits for the frame's fence, acquires the next image and begins
+		// the command buffer
+		void begin_frame(FrameData& frame_data, u32& image_index);
+		void begin_renderpass(FrameData& frame_data, u32 image_index,
+							  VkRenderPass renderpass);
+		// the pyramid has to follow the depth attachment's size
+		void rebuild_swapchain(u32 width, u32 height);
 		void end_renderpass(VkCommandBuffer buf);
 		void resize();
 
@@ -69,7 +86,28 @@ namespace render::vulkan {
 		}
 
 		void handle_input_event(core::PollResult& poll_result);
-		void draw(const ArrayList<gameplay::Transform>& transforms);
+		void draw(const gameplay::TransformStore& transforms,
+				  core::ThreadPool& pool);
+		// grows the transient ring so every frame in flight fits
+		// command_count CPU culled commands, only called when the draw
+		// list is built so drawing never reallocates
+		void reserve_transient(u32 command_count);
+
+		// culls draws on the worker threads instead of in a compute pass,
+		// devices without drawIndirectCount always do
+		inline void cpu_culling(bool enabled) {
+			bCpuCulling = enabled || !mDevice.draw_indirect_count();
+		}
+		inline bool cpu_culling() const { return bCpuCulling; }
+
+		// tests the GPU culling pass's draws against the depth of the ones
+		// visible last frame too, the CPU path only culls by the frustum
+		inline void occlusion_culling(bool enabled) {
+			bOcclusionCulling = enabled;
+		}
+		inline bool occlusion_culling() const { return bOcclusionCulling; }
+
+		inline gameplay::Camera& camera() { return mCamera; }
 
 		inline SDL_Window* window() const { return mpWindow; }
 
@@ -99,6 +137,10 @@ namespace render::vulkan {
 
 		inline VkRenderPass render_pass() const { return mRenderPass; }
 
+		inline const DepthPyramid& depth_pyramid() const {
+			return mDepthPyramid;
+		}
+
 		// I'm obviously not gonna keep all this in this megaclass.
 		// This is temporary, I'll refactor once I get it running.
 
@@ -110,6 +152,11 @@ namespace render::vulkan {
 		Surface mSurface{};
 		Swapchain mSwapchain{};
 		VkRenderPass mRenderPass{};
+		// the occlusion culled frame draws in two passes sharing the
+		// framebuffers of mRenderPass, the early one clears and the late
+		// one presents
+		VkRenderPass mEarlyRenderPass{};
+		VkRenderPass mLateRenderPass{};
 		HashMap<Material, ArrayList<Mesh>> mMaterialMap{};
 		HashMap<Material, VertexBuffer> mMaterialBufferMap{};
 		FrameData mFrames[MAXIMUM_FRAMES_IN_FLIGHT];
@@ -119,13 +166,22 @@ namespace render::vulkan {
 		VkDescriptorSetLayout mGlobalDescriptorSetLayout{};
 		VkDescriptorSetLayout mObjectsDescriptorSetLayout{};
 		VkDescriptorSetLayout mTextureSamplerDescriptorSetLayout{};
-		Scene mScene{};
+		SceneData mSceneData{};
 		GLTFModel mGltfScene;
 		UploadContext mUploadContext{};
 		u32 mCurrFrame{0};
 		bool mShouldResize{false};
+		bool bCpuCulling{false};
+		bool bOcclusionCulling{true};
 		ShaderCache mShaderCache{};
 		gameplay::Camera mCamera{};
 		ImageCache mImageCache{};
+		// object matrices each frame's object_buffer is missing
+		UploadTracker mObjectUploads{MAXIMUM_FRAMES_IN_FLIGHT};
+		// persistently mapped, each frame's transient data is allocated from
+		// it through mTransient
+		Buffer mTransientBuffer{};
+		UploadRing mTransient{};
+		DepthPyramid mDepthPyramid{};
 	};
 } // namespace render::vulkan
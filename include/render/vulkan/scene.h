@@ -2,7 +2,9 @@
 
 #include <glm/gtc/type_ptr.hpp>
 #include "assets/scene/gltf_importer.h"
+#include "gameplay/frustum.h"
 #include "gameplay/transform.h"
+#include "render/vulkan/draw_culler.h"
 #include "render/vulkan/image.h"
 #include "render/vulkan/types.h"
 
@@ -13,22 +15,25 @@ namespace tinygltf {
 
 namespace render::vulkan {
 
-	class Scene {
-	public:
-		SceneData scene_data{};
-
-	public:
-		Scene(VmaAllocator allocator, size_t buffer_size, SceneData data);
-		Scene() = default;
-		void destroy();
-		void write_to_buffer(size_t offset);
-		void write_to_buffer(size_t offset, SceneData data);
-		VkDescriptorBufferInfo buffer_info(size_t offset);
+	class DepthPyramid;
+
+	// which draws a GPU culling pass tests and where it writes them
+	enum class CullPhase : u32 {
+		// every draw against the frustum
+		FRUSTUM = 0,
+		// the draws visible last frame against the frustum
+		EARLY = 1,
+		// every draw against the frustum and the depth pyramid of the early
+		// phase's draws, keeps the ones the early phase didn't draw
+		LATE = 2,
+	};
 
-	private:
-		Buffer mSceneDataBuffer{};
-		size_t mBufferSize{0};
-		VmaAllocator mAllocator{};
+	// camera of a GPU culling pass, the projection has to be symmetric
+	struct CullView {
+		glm::mat4 view;
+		glm::mat4 projection;
+		f32 near_plane;
+		f32 far_plane;
 	};
 
 	class GLTFModel {
@@ -45,10 +50,28 @@ namespace render::vulkan {
 		GLTFModel(GLTFModel&& other) noexcept;
 		GLTFModel& operator=(GLTFModel&& other) noexcept;
 
-		void draw(VkCommandBuffer buf, ObjectData* data, FrameData& frame_data,
-				  u32 uniform_offset);
-
-		void update(ObjectData* data);
+		// compacts the draws of phase into frame's indirect buffer on the
+		// GPU, recorded outside of the render pass before the draw of the
+		// same phase. Only the late phase reads pyramid.
+		void cull(VkCommandBuffer buf, const FrameData& frame_data, u32 frame,
+				  const CullView& view, const DepthPyramid& pyramid,
+				  CullPhase phase);
+		void draw(VkCommandBuffer buf, FrameData& frame_data, u32 frame,
+				  CullPhase phase);
+		// CPU side culling for devices without drawIndirectCount, world
+		// holds the object matrices by transform index
+		void cull(const gameplay::Frustum& frustum,
+				  std::span<const glm::mat4> world, core::ThreadPool& pool);
+		// draws the commands of the last CPU cull, which the caller copied
+		// to commands at offset
+		void draw(VkCommandBuffer buf, FrameData& frame_data,
+				  VkBuffer commands, VkDeviceSize offset);
+		inline const ArrayList<DrawCommand>& visible_commands() const {
+			return mCuller.visible_commands();
+		}
+		// flattens the visible primitives into the indirect buffer, has to
+		// run again after a node's visibility changes
+		void build_draw_commands();
 
 	public:
 		struct {
@@ -66,6 +89,8 @@ namespace render::vulkan {
 			u32 first_index;
 			u32 index_count;
 			s32 material_index;
+			// bounding sphere in node space, radius in w
+			glm::vec4 bounds;
 		};
 
 		// Contains the node's geometry if there is any
@@ -79,6 +104,8 @@ namespace render::vulkan {
 			Mesh mesh;
 			glm::mat4 matrix;
 			std::string name;
+			// index of the node's transform and object matrix
+			u32 transform_index{0};
 			bool visible{true};
 
 			~Node() {
@@ -111,22 +138,91 @@ namespace render::vulkan {
 		void load_textures(tinygltf::Model* input);
 
 		void load_materials(tinygltf::Model* input);
+		// texture_layout picks the textured shaders, the default ones
+		// without it
+		Material create_material(VkDescriptorSetLayout texture_layout);
 
 		void load_node(const tinygltf::Node* inputNode,
 					   const tinygltf::Model* input, Node* parent,
 					   std::vector<uint32_t>& indexBuffer,
 					   std::vector<Vertex>& vertexBuffer);
 
-		void draw_node(VkCommandBuffer buf, ObjectData* ssbo, int& ssbo_index,
-					   Node* node, FrameData& frame_data, u32 uniform_offset);
+		struct IndirectDraw {
+			s32 material_index;
+			DrawCommand command;
+			glm::vec4 bounds;
+		};
+
+		// per indirect command, laid out like CullData in
+		// frustum_cull.comp.glsl
+		struct CullData {
+			glm::vec4 sphere;
+			u32 batch;
+			u32 first_command;
+			u32 pad[2];
+		};
+
+		// laid out like the push constants of frustum_cull.comp.glsl
+		struct CullConstants {
+			glm::mat4 view;
+			glm::vec4 frustum;
+			glm::vec4 projection;
+			glm::vec2 depth_size;
+			f32 near_plane;
+			f32 far_plane;
+			u32 command_count;
+			u32 batch_count;
+			u32 phase;
+		};
+
+		// written by the culling pass, one per frame in flight. The late
+		// phase writes the second half of both.
+		struct CullFrame {
+			Buffer commands{};
+			// visible draws per batch
+			Buffer counts{};
+			VkDescriptorSet set{};
+		};
+
+		// what the last bind_material call of a draw left bound
+		struct BindState {
+			VkPipeline pipeline{};
+			VkDescriptorSet texture_set{};
+		};
+
+		void collect_draws(Node* node, ArrayList<IndirectDraw>& draws);
+		// pipeline, texture set and index range from the most significant
+		// bits down, draws with the same upper half bind the same state
+		u64 sort_key(const IndirectDraw& draw) const;
+
+		void init_culling(const ArrayList<DrawCommand>& commands,
+						  ArrayList<CullData>& cull_data);
+		void destroy_culling();
+		// binds only what differs from bound
+		void bind_material(VkCommandBuffer buf, FrameData& frame_data,
+						   s32 material_index, BindState& bound);
 
-		void update_node(ObjectData* ssbo, int& ssbo_index, Node* node);
+		// device local buffer filled through a staging copy
+		Buffer upload_buffer(const void* data, size_t size,
+							 VkBufferUsageFlags usage);
 
 	private:
 		Device* mDevice;
 		Buffer mVertexBuffer{};
 		Buffer mIndexBuffer{};
+		// every visible primitive and its batches, both culling paths pick
+		// from these
+		DrawCuller mCuller{};
+		Buffer mDrawCommands{};
+		Buffer mCullBuffer{};
+		// per draw, whether the last late phase found it visible
+		Buffer mVisibility{};
+		ArrayList<CullFrame> mCullFrames{};
+		VkPipelineLayout mCullLayout{};
+		VkPipeline mCullPipeline{};
 		Material mDefaultMaterial{};
+		// pipeline and layout every textured material shares
+		Material mTexturedMaterial{};
 		ObjectLifetime mLifetime{ObjectLifetime::TEMP};
 	};
 } // namespace render::vulkan
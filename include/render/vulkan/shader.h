@@ -6,7 +6,11 @@
 #include "device.h"
 
 namespace render::vulkan {
-	enum class ShaderType : u64 { VERTEX = 0x00000001, FRAGMENT = 0x00000010 };
+	enum class ShaderType : u64 {
+		VERTEX = 0x00000001,
+		FRAGMENT = 0x00000010,
+		COMPUTE = 0x00000020
+	};
 
 	struct Shader {
 
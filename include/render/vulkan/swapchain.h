@@ -60,6 +60,10 @@ namespace render::vulkan {
 
 		inline VkFormat depth_format() const { return mDepthFormat; }
 
+		inline const Image& depth_attachment() const {
+			return mDepthAttachment;
+		}
+
 	private:
 		ObjectLifetime mLifetime{ObjectLifetime::TEMP};
 		VkFormat mSwapchainImageFormat{};
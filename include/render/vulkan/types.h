@@ -25,11 +25,15 @@ namespace render::vulkan {
 	public:
 		VkBuffer handle{};
 		VmaAllocation memory{};
+		// only set for buffers created with VMA_ALLOCATION_CREATE_MAPPED_BIT,
+		// stays valid until destroy
+		void* mapped{nullptr};
 
 	public:
 		Buffer() = default;
 		Buffer(VmaAllocator alloc, size_t allocation_size,
-			   VkBufferUsageFlags usage, VmaMemoryUsage mem_usage);
+			   VkBufferUsageFlags usage, VmaMemoryUsage mem_usage,
+			   VmaAllocationCreateFlags flags = 0);
 		Buffer(const Buffer& other);
 		Buffer& operator=(const Buffer& other);
 		Buffer(Buffer&& other) noexcept;
@@ -41,6 +45,10 @@ namespace render::vulkan {
 		// ctor/assignment: causes double free.
 		void destroy();
 
+		// makes host writes to a mapped buffer visible to the device, a no-op
+		// on host coherent memory
+		void flush(VkDeviceSize offset, VkDeviceSize size) const;
+
 	private:
 		VmaAllocator mAlloc;
 	};
@@ -62,13 +70,18 @@ namespace render::vulkan {
         u32 id;
 	};
 
+	// camera and scene bindings of the global set
+	constexpr u32 GLOBAL_DYNAMIC_OFFSETS = 2;
+
 	struct FrameData {
 		VkCommandPool command_pool{};
 		VkCommandBuffer command_buffer{};
 		VkSemaphore present_semaphore{}, render_semaphore{};
 		VkFence render_fence{};
-		Buffer camera_buffer{};
 		VkDescriptorSet global_descriptor{};
+		// where this frame's camera and scene data sit in the transient ring,
+		// bound with global_descriptor in binding order
+		u32 global_offsets[GLOBAL_DYNAMIC_OFFSETS]{};
 		Buffer object_buffer{};
 		VkDescriptorSet object_descriptor{};
 	};
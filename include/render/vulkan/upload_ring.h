@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstring>
+#include <type_traits>
+#include "core/types.h"
+
+namespace render::vulkan {
+	// Ring allocator over one persistently mapped buffer shared by all frames
+	// in flight. A frame allocates from the head and what it got stays valid
+	// until begin_frame is called for it again, which has to be after its
+	// fence signalled. A busy frame can take more than its share as long as
+	// the others leave room.
+	class UploadRing {
+	public:
+		struct Allocation {
+			// null when the ring is full
+			void* data{nullptr};
+			// from the start of the buffer, for descriptors and dynamic offsets
+			u32 offset{0};
+		};
+
+		UploadRing() = default;
+		// size has to be a multiple of every alignment asked for
+		UploadRing(void* mapped, u32 size, u32 frame_count);
+
+		// frees what frame allocated the last time it was recorded
+		void begin_frame(u32 frame);
+
+		// alignment has to be a power of two
+		Allocation allocate(u32 size, u32 alignment);
+
+		template <typename T>
+		inline Allocation write(const T& value, u32 alignment) {
+			static_assert(std::is_trivially_copyable_v<T>);
+			Allocation allocation = allocate(sizeof(T), alignment);
+			if (allocation.data) {
+				std::memcpy(allocation.data, &value, sizeof(T));
+			}
+			return allocation;
+		}
+
+		// offset and size covering everything the current frame wrote,
+		// the whole buffer once it wrapped around
+		void frame_range(u32& offset, u32& size) const;
+
+		// bytes the frames in flight hold, padding included
+		inline u32 used() const { return mHead - mTail; }
+		inline u32 capacity() const { return mSize; }
+
+	private:
+		u8* mData{nullptr};
+		u32 mSize{0};
+		u32 mCurrentFrame{0};
+		// running byte counts, positions are taken modulo mSize
+		u64 mHead{0};
+		u64 mTail{0};
+		u64 mFrameStart{0};
+		ArrayList<u64> mFrameEnds{};
+	};
+} // namespace render::vulkan
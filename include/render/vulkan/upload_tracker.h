@@ -0,0 +1,37 @@
+#pragma once
+
+#include <span>
+#include "core/types.h"
+#include "gameplay/transform_store.h"
+
+namespace render::vulkan {
+	// Which objects are stale in each frame in flight's copy of a per object
+	// buffer. Ranges that changed are queued for every frame, and a frame
+	// writes only its own queue once it comes around again, so a change
+	// reaches all copies without rewriting the unchanged objects.
+	class UploadTracker {
+	public:
+		// clean objects between two stale ranges up to this far apart are
+		// rewritten too, one bigger copy beats two small ones
+		static constexpr u32 MERGE_GAP = 4;
+		// queues longer than this collapse into one full upload
+		static constexpr u32 MAX_QUEUED_RANGES = 1024;
+
+		explicit UploadTracker(u32 frame_count);
+
+		// changed ranges of one update; a different object count than last
+		// time makes every object stale in every frame
+		void push(std::span<const gameplay::TransformRange> changed,
+				  u32 object_count);
+		// merged, sorted and clipped ranges frame has to write, empties its
+		// queue. Valid until the next call.
+		const ArrayList<gameplay::TransformRange>& take(u32 frame);
+
+		inline u32 object_count() const { return mObjectCount; }
+
+	private:
+		ArrayList<ArrayList<gameplay::TransformRange>> mQueues;
+		ArrayList<gameplay::TransformRange> mMerged{};
+		u32 mObjectCount{0};
+	};
+} // namespace render::vulkan
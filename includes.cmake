@@ -1,5 +1,8 @@
 set(GUCCIGEDON_TRANSLATION_UNITS
     src/core/logger.cpp
+    src/core/thread_pool.cpp
+    src/core/fixed_timestep.cpp
+    src/core/radix_sort.cpp
     src/render/vulkan/renderer.cpp
     src/render/vulkan/builders.cpp
     src/render/vulkan/mesh.cpp
@@ -14,8 +17,15 @@ set(GUCCIGEDON_TRANSLATION_UNITS
     src/render/vulkan/descriptor_allocator.cpp
     src/render/vulkan/shader.cpp
     src/render/vulkan/descriptor_set_builder.cpp
+    src/render/vulkan/upload_tracker.cpp
+    src/render/vulkan/upload_ring.cpp
+    src/render/vulkan/draw_culler.cpp
+    src/render/vulkan/depth_pyramid.cpp
     src/gameplay/camera.cpp
     src/gameplay/transform.cpp
+    src/gameplay/transform_hierarchy.cpp
+    src/gameplay/transform_store.cpp
+    src/gameplay/frustum.cpp
     src/core/input.cpp
     src/core/sapfire_engine.cpp
     src/gameplay/input_component.cpp
@@ -26,4 +36,13 @@ set(GUCCIGEDON_TRANSLATION_UNITS
     src/physics/aabb_collider.cpp
     src/physics/plane_collider.cpp
     src/physics/physics_engine.cpp
+    src/physics/broadphase.cpp
+    src/physics/dynamic_tree.cpp
+    src/physics/sphere_batch.cpp
+    src/physics/narrowphase.cpp
+    src/physics/islands.cpp
+    src/physics/solver.cpp
+    src/physics/ccd.cpp
+    src/physics/snapshot.cpp
+    src/physics/queries.cpp
 )
@@ -0,0 +1,18 @@
+#include "core/fixed_timestep.h"
+
+namespace core {
+	u32 FixedTimestep::advance(f32 frame_time) {
+		mAccumulator += frame_time;
+		u32 steps = 0;
+		while (mAccumulator >= mStep && steps < mMaxSubsteps) {
+			mAccumulator -= mStep;
+			++steps;
+		}
+		// a frame too slow to catch up drops the rest instead of making the
+		// next frame slower as well
+		if (mAccumulator >= mStep) {
+			mAccumulator = 0.f;
+		}
+		return steps;
+	}
+} // namespace core
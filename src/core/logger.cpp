@@ -31,8 +31,7 @@ namespace core {
 	void Logger::serialize() {
 		while (true) {
 			std::unique_lock<std::mutex> lock(mLogMutex);
-			mCV.wait(lock,
-					 [] { return !instance->bEmpty || instance->bClosing; });
+			mCV.wait(lock, [this] { return !bEmpty || bClosing; });
 			std::cout << mStream.view() << std::endl;
 			if (!bClosing) {
 				mFileHandle << mStream.view() << std::endl;
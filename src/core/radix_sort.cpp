@@ -0,0 +1,58 @@
+#include "core/radix_sort.h"
+
+namespace core {
+	constexpr u32 RADIX_BITS = 8;
+	constexpr u32 RADIX_SIZE = 1 << RADIX_BITS;
+	constexpr u32 PASS_COUNT = 64 / RADIX_BITS;
+
+	// values is null when only the keys are sorted
+	static void sort(ArrayList<u64>& keys, ArrayList<u32>* values) {
+		const u32 count = keys.size();
+		if (count < 2) {
+			return;
+		}
+		// every pass's histogram in a single read of the keys
+		u32 histograms[PASS_COUNT][RADIX_SIZE]{};
+		for (u64 key : keys) {
+			for (u32 pass = 0; pass < PASS_COUNT; ++pass) {
+				++histograms[pass][(key >> (pass * RADIX_BITS)) &
+								   (RADIX_SIZE - 1)];
+			}
+		}
+		ArrayList<u64> sorted_keys(count);
+		ArrayList<u32> sorted_values(values != nullptr ? count : 0);
+		for (u32 pass = 0; pass < PASS_COUNT; ++pass) {
+			u32* histogram = histograms[pass];
+			const u32 shift = pass * RADIX_BITS;
+			// the digits don't depend on the order, one bucket holding
+			// every key means nothing would move
+			if (histogram[(keys[0] >> shift) & (RADIX_SIZE - 1)] == count) {
+				continue;
+			}
+			u32 offset = 0;
+			for (u32 digit = 0; digit < RADIX_SIZE; ++digit) {
+				const u32 size = histogram[digit];
+				histogram[digit] = offset;
+				offset += size;
+			}
+			for (u32 i = 0; i < count; ++i) {
+				const u32 target =
+					histogram[(keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+				sorted_keys[target] = keys[i];
+				if (values != nullptr) {
+					sorted_values[target] = (*values)[i];
+				}
+			}
+			keys.swap(sorted_keys);
+			if (values != nullptr) {
+				values->swap(sorted_values);
+			}
+		}
+	}
+
+	void radix_sort(ArrayList<u64>& keys, ArrayList<u32>& values) {
+		sort(keys, &values);
+	}
+
+	void radix_sort(ArrayList<u64>& keys) { sort(keys, nullptr); }
+} // namespace core
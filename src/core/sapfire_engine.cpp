@@ -1,4 +1,5 @@
 #include "core/sapfire_engine.h"
+#include <chrono>
 #include <glm/gtc/type_ptr.hpp>
 #include "assets/scene/gltf_importer.h"
 #include "gameplay/transform.h"
@@ -22,7 +23,7 @@ namespace core {
 						   const tinygltf::Model* in, s32 parent_index) {
 		const tinygltf::Node& inputNode = *inNode;
 		const tinygltf::Model& input = *in;
-		gameplay::Transform transform{};
+		gameplay::Transform transform = mTransforms.add();
 		if (inputNode.translation.size() == 3) {
 			transform.position(glm::make_vec3(inputNode.translation.data()));
 		}
@@ -33,8 +34,7 @@ namespace core {
 			transform.scale(glm::make_vec3(inputNode.scale.data()));
 		}
         transform.parent_index(parent_index);
-		mTransforms.push_back(transform);
-		s32 _parent_index = mTransforms.size() - 1;
+		s32 _parent_index = transform.index();
 		if (inputNode.children.size() > 0) {
 			for (const auto& child_index : inputNode.children) {
 				load_node(&input.nodes[child_index], in, _parent_index);
@@ -42,7 +42,15 @@ namespace core {
 		}
 	}
 
+	void Engine::store_previous_state() { mTransforms.save_previous(); }
+
+	void Engine::update_world_transforms(f32 alpha) {
+		mTransforms.update(mThreadPool, alpha);
+	}
+
 	void Engine::run() {
+		using Clock = std::chrono::steady_clock;
+		Clock::time_point previous_time = Clock::now();
 		bool quit = false;
 		while (!quit) {
 			PollResult poll_result{};
@@ -54,11 +62,20 @@ namespace core {
 				// mPhysics->handle_input_event(poll_result);
 				mRenderer->handle_input_event(poll_result);
 			} while (poll_result.result != 0);
-			mPhysics->simulate(0.000016f);
-			for (auto& transform : mTransforms) {
-				transform.calculate_transform(mTransforms);
+			const Clock::time_point now = Clock::now();
+			const f32 frame_time =
+				std::chrono::duration<f32>(now - previous_time).count();
+			previous_time = now;
+			const u32 steps = mTimestep.advance(frame_time);
+			for (u32 step = 0; step < steps; ++step) {
+				// only the state before the last step is blended from
+				if (step == steps - 1) {
+					store_previous_state();
+				}
+				mPhysics->simulate(mTimestep.step());
 			}
-			mRenderer->draw(mTransforms);
+			update_world_transforms(mTimestep.alpha());
+			mRenderer->draw(mTransforms, mThreadPool);
 		}
 	}
 } // namespace core
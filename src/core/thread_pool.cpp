@@ -0,0 +1,97 @@
+#include "core/thread_pool.h"
+
+namespace core {
+	ThreadPool::ThreadPool(u32 worker_count) {
+		mWorkers.reserve(worker_count);
+		for (u32 i = 0; i < worker_count; ++i) {
+			mWorkers.emplace_back(&ThreadPool::work, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			bStopping = true;
+		}
+		mWake.notify_all();
+		// jthreads join on destruction
+		mWorkers.clear();
+	}
+
+	u32 ThreadPool::default_worker_count() {
+		const u32 hardware_threads = std::thread::hardware_concurrency();
+		return hardware_threads > 1 ? hardware_threads - 1 : 0;
+	}
+
+	void ThreadPool::run(u32 chunk_count, void* context,
+						 ChunkFunction function) {
+		if (chunk_count == 0) {
+			return;
+		}
+		if (mWorkers.empty() || chunk_count == 1) {
+			for (u32 chunk = 0; chunk < chunk_count; ++chunk) {
+				function(context, chunk);
+			}
+			return;
+		}
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mJob = {context, function, chunk_count};
+			mNextChunk.store(0, std::memory_order_relaxed);
+			mPending.store(chunk_count, std::memory_order_relaxed);
+			++mGeneration;
+		}
+		mWake.notify_all();
+		execute({context, function, chunk_count});
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDone.wait(lock, [this] {
+			return mPending.load(std::memory_order_acquire) == 0 &&
+				mActive == 0;
+		});
+	}
+
+	void ThreadPool::execute(const Job& job) {
+		while (true) {
+			const u32 chunk =
+				mNextChunk.fetch_add(1, std::memory_order_relaxed);
+			if (chunk >= job.chunk_count) {
+				return;
+			}
+			job.function(job.context, chunk);
+			if (mPending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				std::unique_lock<std::mutex> lock(mMutex);
+				mDone.notify_one();
+			}
+		}
+	}
+
+	void ThreadPool::work() {
+		u64 generation = 0;
+		while (true) {
+			Job job{};
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mWake.wait(lock, [&] {
+					return bStopping || mGeneration != generation;
+				});
+				if (bStopping) {
+					return;
+				}
+				generation = mGeneration;
+				// woke after every chunk was claimed, run() may already
+				// be setting up the next job
+				if (mNextChunk.load(std::memory_order_relaxed) >=
+					mJob.chunk_count) {
+					continue;
+				}
+				job = mJob;
+				++mActive;
+			}
+			execute(job);
+			std::unique_lock<std::mutex> lock(mMutex);
+			if (--mActive == 0) {
+				mDone.notify_one();
+			}
+		}
+	}
+} // namespace core
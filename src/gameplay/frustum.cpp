@@ -0,0 +1,75 @@
+#include "gameplay/frustum.h"
+#include <cmath>
+#include "core/simd.h"
+
+namespace gameplay {
+	Frustum::Frustum(const glm::mat4& view_proj) {
+		// rows of the matrix, glm stores columns
+		glm::vec4 rows[4];
+		for (u32 i = 0; i < 4; ++i) {
+			rows[i] = {view_proj[0][i], view_proj[1][i], view_proj[2][i],
+					   view_proj[3][i]};
+		}
+		planes[0] = rows[3] + rows[0];
+		planes[1] = rows[3] - rows[0];
+		planes[2] = rows[3] + rows[1];
+		planes[3] = rows[3] - rows[1];
+		planes[4] = rows[3] + rows[2];
+		planes[5] = rows[3] - rows[2];
+		for (glm::vec4& plane : planes) {
+			const f32 length = std::sqrt(plane.x * plane.x + plane.y * plane.y +
+										 plane.z * plane.z);
+			plane = plane * (1.f / length);
+		}
+	}
+
+	bool Frustum::intersects(const glm::vec3& center, f32 radius) const {
+		for (const glm::vec4& plane : planes) {
+			if (plane.x * center.x + plane.y * center.y + plane.z * center.z +
+					plane.w <
+				-radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void Frustum::intersects(const f32* x, const f32* y, const f32* z,
+							 const f32* radius, u32 count, u8* visible) const {
+		u32 i = 0;
+#ifdef CORE_SIMD
+		using namespace core::simd;
+		Lane normal_x[PLANE_COUNT];
+		Lane normal_y[PLANE_COUNT];
+		Lane normal_z[PLANE_COUNT];
+		Lane distance[PLANE_COUNT];
+		for (u32 p = 0; p < PLANE_COUNT; ++p) {
+			normal_x[p] = broadcast(planes[p].x);
+			normal_y[p] = broadcast(planes[p].y);
+			normal_z[p] = broadcast(planes[p].z);
+			distance[p] = broadcast(planes[p].w);
+		}
+		for (; i + LANES <= count; i += LANES) {
+			const Lane cx = load(x + i);
+			const Lane cy = load(y + i);
+			const Lane cz = load(z + i);
+			const Lane negative_radius = sub(zero(), load(radius + i));
+			Lane outside = zero();
+			for (u32 p = 0; p < PLANE_COUNT; ++p) {
+				const Lane d =
+					add(add(add(mul(normal_x[p], cx), mul(normal_y[p], cy)),
+							mul(normal_z[p], cz)),
+						distance[p]);
+				outside = either(outside, less(d, negative_radius));
+			}
+			const s32 bits = mask(outside);
+			for (u32 lane = 0; lane < LANES; ++lane) {
+				visible[i + lane] = ((bits >> lane) & 1) == 0;
+			}
+		}
+#endif
+		for (; i < count; ++i) {
+			visible[i] = intersects({x[i], y[i], z[i]}, radius[i]);
+		}
+	}
+} // namespace gameplay
@@ -1,53 +1,22 @@
 #include "gameplay/transform.h"
-#include <glm/glm.hpp>
-#include <glm/gtc/quaternion.hpp>
-#include <glm/gtx/quaternion.hpp>
-#include <glm/gtx/transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <glm/ext/quaternion_trigonometric.hpp>
 
 namespace gameplay {
-	const glm::mat4&
-	Transform::calculate_transform(const ArrayList<Transform>& transforms) {
-		if (mDirty) {
-			glm::mat4 scale= glm::scale(mScale);
-			glm::mat4 rot= glm::toMat4(mRotation);
-			glm::mat4 transl= glm::translate(glm::mat4(1), mPosition);
-			mTransform = transl * rot * scale;
-            if(mParentIndex >= 0){
-                mTransform = transforms[mParentIndex].mTransform * mTransform;
-            }
-		}
-		return mTransform;
+	glm::quat euler_rotation(const glm::vec3& euler) {
+		return glm::angleAxis(euler.y, glm::vec3{0.f, -1.f, 0.f}) *
+			glm::angleAxis(euler.z, glm::vec3{0.f, 0.f, -1.f}) *
+			glm::angleAxis(euler.x, glm::vec3{-1.f, 0.f, 0.f});
 	}
 
-	Transform& Transform::rotation(const glm::vec3& rotation) {
-		mEulerAngles = rotation;
-		mRotation = glm::quat(rotation);
-		glm::mat4 yaw_rot =
-			glm::rotate(glm::mat4{1}, mEulerAngles.y, {0, -1, 0});
-		glm::mat4 roll_rot =
-			glm::rotate(glm::mat4{yaw_rot}, mEulerAngles.z, {0, 0, -1});
-		mRotationMatrix =
-			glm::rotate(glm::mat4{roll_rot}, mEulerAngles.x, {-1, 0, 0});
-		mForward = {0, 0, 1};
-		mRight = {1, 0, 0};
-		mForward = mRotationMatrix * glm::vec4(mForward, 0.f);
-		mRight = mRotationMatrix * glm::vec4(mRight, 0.f);
-		mUp = glm::normalize(glm::cross(mRight, mForward));
-		mDirty = true;
-		return *this;
+	glm::vec3 euler_angles(const glm::quat& rotation) {
+		// the matrix is Ry(-yaw) * Rz(-roll) * Rx(-pitch), roll is the
+		// middle angle and comes out of [-pi/2, pi/2]
+		const glm::mat4 m(rotation);
+		const f32 roll = std::asin(std::clamp(m[0][1], -1.f, 1.f));
+		const f32 yaw = std::atan2(-m[0][2], m[0][0]);
+		const f32 pitch = std::atan2(-m[2][1], m[1][1]);
+		return {-pitch, -yaw, -roll};
 	}
-
-	Transform& Transform::rotation(const glm::quat& rotation) {
-		mRotation = rotation;
-		mEulerAngles = glm::eulerAngles(mRotation);
-		mRotationMatrix = glm::mat4(mRotation);
-		mForward = {0, 0, 1};
-		mRight = {1, 0, 0};
-		mForward = mRotationMatrix * glm::vec4(mForward, 0.f);
-		mRight = mRotationMatrix * glm::vec4(mRight, 0.f);
-		mUp = glm::normalize(glm::cross(mRight, mForward));
-		mDirty = true;
-		return *this;
-	}
-
 } // namespace gameplay
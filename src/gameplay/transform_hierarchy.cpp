@@ -0,0 +1,41 @@
+#include "gameplay/transform_hierarchy.h"
+#include <algorithm>
+#include <cassert>
+
+namespace gameplay {
+	void TransformHierarchy::build(const ArrayList<s32>& parents) {
+		// parents may come after their children in the array, so depths are
+		// resolved by walking up to the first ancestor with a known one
+		constexpr u32 UNKNOWN = ~0u;
+		ArrayList<u32> depths(parents.size(), UNKNOWN);
+		ArrayList<u32> path{};
+		u32 level_count = 0;
+		for (u32 i = 0; i < parents.size(); ++i) {
+			s32 current = i;
+			while (current >= 0 && depths[current] == UNKNOWN) {
+				assert(path.size() <= parents.size() && "hierarchy cycle");
+				path.push_back(current);
+				current = parents[current];
+			}
+			u32 depth = current >= 0 ? depths[current] + 1 : 0;
+			for (u32 j = path.size(); j-- > 0; ++depth) {
+				depths[path[j]] = depth;
+			}
+			path.clear();
+			level_count = std::max(level_count, depth);
+		}
+		// counting sort keeps each level in array order
+		mLevelStarts.assign(level_count + 1, 0);
+		for (u32 depth : depths) {
+			++mLevelStarts[depth + 1];
+		}
+		for (u32 level = 1; level <= level_count; ++level) {
+			mLevelStarts[level] += mLevelStarts[level - 1];
+		}
+		ArrayList<u32> cursors(mLevelStarts.begin(), mLevelStarts.end() - 1);
+		mOrder.resize(parents.size());
+		for (u32 i = 0; i < parents.size(); ++i) {
+			mOrder[cursors[depths[i]]++] = i;
+		}
+	}
+} // namespace gameplay
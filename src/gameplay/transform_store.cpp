@@ -0,0 +1,404 @@
+#include "gameplay/transform_store.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace gameplay {
+	// affine matrix from its 12 entries that aren't constant, column order
+	static inline void write_affine(const f32* entries, glm::mat4& out) {
+		out[0] = {entries[0], entries[1], entries[2], 0.f};
+		out[1] = {entries[3], entries[4], entries[5], 0.f};
+		out[2] = {entries[6], entries[7], entries[8], 0.f};
+		out[3] = {entries[9], entries[10], entries[11], 1.f};
+	}
+
+	TransformStore::TransformStore(u32 count) {
+		reserve(count);
+		for (u32 i = 0; i < count; ++i) {
+			add();
+		}
+	}
+
+	Transform TransformStore::add() {
+		const u32 index = size();
+		for (core::AlignedList<f32>* array :
+			 {&mPositionX, &mPositionY, &mPositionZ, &mRotationX, &mRotationY,
+			  &mRotationZ, &mScaleX, &mScaleY, &mScaleZ, &mPreviousPositionX,
+			  &mPreviousPositionY, &mPreviousPositionZ, &mPreviousRotationX,
+			  &mPreviousRotationY, &mPreviousRotationZ}) {
+			array->push_back(0.f);
+		}
+		mRotationW.push_back(1.f);
+		mPreviousRotationW.push_back(1.f);
+		mScaleX[index] = mScaleY[index] = mScaleZ[index] = 1.f;
+		for (core::AlignedList<f32>& entries : mLocal) {
+			entries.push_back(0.f);
+		}
+		mWorld.emplace_back(1.f);
+		mParents.push_back(-1);
+		mDirty.push_back(1);
+		mMoving.push_back(0);
+		mChanged.push_back(0);
+		bHierarchyDirty = true;
+		return {*this, index};
+	}
+
+	void TransformStore::reserve(u32 count) {
+		for (core::AlignedList<f32>* array :
+			 {&mPositionX, &mPositionY, &mPositionZ, &mRotationX, &mRotationY,
+			  &mRotationZ, &mRotationW, &mScaleX, &mScaleY, &mScaleZ,
+			  &mPreviousPositionX, &mPreviousPositionY, &mPreviousPositionZ,
+			  &mPreviousRotationX, &mPreviousRotationY, &mPreviousRotationZ,
+			  &mPreviousRotationW}) {
+			array->reserve(count);
+		}
+		for (core::AlignedList<f32>& entries : mLocal) {
+			entries.reserve(count);
+		}
+		mWorld.reserve(count);
+		mParents.reserve(count);
+		mDirty.reserve(count);
+		mMoving.reserve(count);
+		mChanged.reserve(count);
+	}
+
+	void TransformStore::save_previous() {
+		if (!bBlend) {
+			// nothing was tracked yet, take over every transform
+			mPreviousPositionX = mPositionX;
+			mPreviousPositionY = mPositionY;
+			mPreviousPositionZ = mPositionZ;
+			mPreviousRotationX = mRotationX;
+			mPreviousRotationY = mRotationY;
+			mPreviousRotationZ = mRotationZ;
+			mPreviousRotationW = mRotationW;
+			bBlend = true;
+			return;
+		}
+		for (u32 i = 0; i < size(); ++i) {
+			if (!mMoving[i]) {
+				continue;
+			}
+			mPreviousPositionX[i] = mPositionX[i];
+			mPreviousPositionY[i] = mPositionY[i];
+			mPreviousPositionZ[i] = mPositionZ[i];
+			mPreviousRotationX[i] = mRotationX[i];
+			mPreviousRotationY[i] = mRotationY[i];
+			mPreviousRotationZ[i] = mRotationZ[i];
+			mPreviousRotationW[i] = mRotationW[i];
+			mMoving[i] = 0;
+			// last drawn blended, the matrix still has to reach the state
+			mDirty[i] = 1;
+		}
+	}
+
+	void TransformStore::update(core::ThreadPool& pool, f32 alpha) {
+		// the previous state is only kept once save_previous was called
+		if (!bBlend) {
+			alpha = 1.f;
+		}
+		if (bHierarchyDirty) {
+			mHierarchy.build(mParents);
+			bHierarchyDirty = false;
+		}
+		// local matrices don't depend on each other
+		pool.parallel_for(size(), CHUNK_SIZE, [&](u32, u32 begin, u32 end) {
+			compose(begin, end, alpha);
+		});
+		for (u32 level = 0; level < mHierarchy.level_count(); ++level) {
+			const u32 first = mHierarchy.level_start(level);
+			pool.parallel_for(mHierarchy.level_start(level + 1) - first,
+							  CHUNK_SIZE, [&](u32, u32 begin, u32 end) {
+								  multiply(first + begin, first + end);
+							  });
+		}
+		collect_changed_ranges();
+	}
+
+	const glm::mat4& TransformStore::update(u32 index,
+											const glm::mat4& parent) {
+		compose(index, 1.f);
+		f32 local[12];
+		for (u32 entry = 0; entry < 12; ++entry) {
+			local[entry] = mLocal[entry][index];
+		}
+		glm::mat4 world{};
+		write_affine(local, world);
+		mWorld[index] = parent * world;
+		mDirty[index] = 0;
+		return mWorld[index];
+	}
+
+	void TransformStore::collect_changed_ranges() {
+		mChangedRanges.clear();
+		const u32 count = size();
+		u32 i = 0;
+		while (i < count) {
+			// skip untouched transforms 8 flags at a time
+			u64 flags = 0;
+			if (i + sizeof(flags) <= count) {
+				std::memcpy(&flags, &mChanged[i], sizeof(flags));
+				if (flags == 0) {
+					i += sizeof(flags);
+					continue;
+				}
+			}
+			if (!mChanged[i]) {
+				++i;
+				continue;
+			}
+			const u32 begin = i;
+			while (i < count && mChanged[i]) {
+				++i;
+			}
+			mChangedRanges.push_back({begin, i});
+		}
+	}
+
+	void TransformStore::compose(u32 begin, u32 end, f32 alpha) {
+		u32 i = begin;
+#ifdef CORE_SIMD
+		using namespace core::simd;
+		// TransformStore::add would hide it
+		using core::simd::add;
+		static_assert(CHUNK_SIZE % LANES == 0);
+		// chunks start on a multiple of CHUNK_SIZE, so every lane load below
+		// is aligned
+		assert(begin % LANES == 0);
+		const Lane one = broadcast(1.f);
+		const Lane two = broadcast(2.f);
+		const Lane t = broadcast(alpha);
+		const Lane s = broadcast(1.f - alpha);
+		for (; i + LANES <= end; i += LANES) {
+			bool dirty = false;
+			for (u32 lane = 0; lane < LANES; ++lane) {
+				dirty |= (mDirty[i + lane] | mMoving[i + lane]) != 0;
+			}
+			if (!dirty) {
+				continue;
+			}
+			// normalized lerp from the previous rotation along the shorter
+			// arc, at rest both are equal and the rotation comes out as is
+			Lane x = load_aligned(&mRotationX[i]);
+			Lane y = load_aligned(&mRotationY[i]);
+			Lane z = load_aligned(&mRotationZ[i]);
+			Lane w = load_aligned(&mRotationW[i]);
+			const Lane px = load_aligned(&mPreviousRotationX[i]);
+			const Lane py = load_aligned(&mPreviousRotationY[i]);
+			const Lane pz = load_aligned(&mPreviousRotationZ[i]);
+			const Lane pw = load_aligned(&mPreviousRotationW[i]);
+			const Lane cosine =
+				add(add(mul(x, px), mul(y, py)), add(mul(z, pz), mul(w, pw)));
+			const Lane weight =
+				select(less(cosine, zero()), sub(zero(), t), t);
+			x = add(mul(px, s), mul(x, weight));
+			y = add(mul(py, s), mul(y, weight));
+			z = add(mul(pz, s), mul(z, weight));
+			w = add(mul(pw, s), mul(w, weight));
+			const Lane length = root(
+				add(add(mul(x, x), mul(y, y)), add(mul(z, z), mul(w, w))));
+			x = div(x, length);
+			y = div(y, length);
+			z = div(z, length);
+			w = div(w, length);
+			// same terms as glm::mat3_cast, scaled per column
+			const Lane xx = mul(x, x);
+			const Lane yy = mul(y, y);
+			const Lane zz = mul(z, z);
+			const Lane xy = mul(x, y);
+			const Lane xz = mul(x, z);
+			const Lane yz = mul(y, z);
+			const Lane wx = mul(w, x);
+			const Lane wy = mul(w, y);
+			const Lane wz = mul(w, z);
+			const Lane sx = load_aligned(&mScaleX[i]);
+			const Lane sy = load_aligned(&mScaleY[i]);
+			const Lane sz = load_aligned(&mScaleZ[i]);
+			store_aligned(&mLocal[0][i],
+						  mul(sub(one, mul(two, add(yy, zz))), sx));
+			store_aligned(&mLocal[1][i], mul(mul(two, add(xy, wz)), sx));
+			store_aligned(&mLocal[2][i], mul(mul(two, sub(xz, wy)), sx));
+			store_aligned(&mLocal[3][i], mul(mul(two, sub(xy, wz)), sy));
+			store_aligned(&mLocal[4][i],
+						  mul(sub(one, mul(two, add(xx, zz))), sy));
+			store_aligned(&mLocal[5][i], mul(mul(two, add(yz, wx)), sy));
+			store_aligned(&mLocal[6][i], mul(mul(two, add(xz, wy)), sz));
+			store_aligned(&mLocal[7][i], mul(mul(two, sub(yz, wx)), sz));
+			store_aligned(&mLocal[8][i],
+						  mul(sub(one, mul(two, add(xx, yy))), sz));
+			const f32* current[3]{&mPositionX[i], &mPositionY[i],
+								  &mPositionZ[i]};
+			const f32* previous[3]{&mPreviousPositionX[i],
+								   &mPreviousPositionY[i],
+								   &mPreviousPositionZ[i]};
+			for (u32 axis = 0; axis < 3; ++axis) {
+				store_aligned(&mLocal[9 + axis][i],
+							  add(mul(load_aligned(previous[axis]), s),
+								  mul(load_aligned(current[axis]), t)));
+			}
+		}
+#endif
+		for (; i < end; ++i) {
+			if (mDirty[i] | mMoving[i]) {
+				compose(i, alpha);
+			}
+		}
+	}
+
+	void TransformStore::compose(u32 index, f32 alpha) {
+		f32 x = mRotationX[index];
+		f32 y = mRotationY[index];
+		f32 z = mRotationZ[index];
+		f32 w = mRotationW[index];
+		const f32 px = mPreviousRotationX[index];
+		const f32 py = mPreviousRotationY[index];
+		const f32 pz = mPreviousRotationZ[index];
+		const f32 pw = mPreviousRotationW[index];
+		const f32 weight = x * px + y * py + z * pz + w * pw < 0.f ? -alpha
+																	 : alpha;
+		x = px * (1.f - alpha) + x * weight;
+		y = py * (1.f - alpha) + y * weight;
+		z = pz * (1.f - alpha) + z * weight;
+		w = pw * (1.f - alpha) + w * weight;
+		const f32 length = std::sqrt(x * x + y * y + z * z + w * w);
+		x /= length;
+		y /= length;
+		z /= length;
+		w /= length;
+		const f32 sx = mScaleX[index];
+		const f32 sy = mScaleY[index];
+		const f32 sz = mScaleZ[index];
+		const f32 matrix[12]{
+			(1.f - 2.f * (y * y + z * z)) * sx,
+			2.f * (x * y + w * z) * sx,
+			2.f * (x * z - w * y) * sx,
+			2.f * (x * y - w * z) * sy,
+			(1.f - 2.f * (x * x + z * z)) * sy,
+			2.f * (y * z + w * x) * sy,
+			2.f * (x * z + w * y) * sz,
+			2.f * (y * z - w * x) * sz,
+			(1.f - 2.f * (x * x + y * y)) * sz,
+			mPreviousPositionX[index] * (1.f - alpha) +
+				mPositionX[index] * alpha,
+			mPreviousPositionY[index] * (1.f - alpha) +
+				mPositionY[index] * alpha,
+			mPreviousPositionZ[index] * (1.f - alpha) +
+				mPositionZ[index] * alpha,
+		};
+		for (u32 entry = 0; entry < 12; ++entry) {
+			mLocal[entry][index] = matrix[entry];
+		}
+	}
+
+	void TransformStore::multiply(u32 begin, u32 end) {
+		const ArrayList<u32>& order = mHierarchy.order();
+		u32 i = begin;
+#ifdef CORE_SIMD
+		using namespace core::simd;
+		// TransformStore::add would hide it
+		using core::simd::add;
+		// world matrices are 16 floats apart
+		const f32* world = reinterpret_cast<const f32*>(mWorld.data());
+		for (; i + LANES <= end; i += LANES) {
+			alignas(32) u32 indices[LANES];
+			alignas(32) u32 parents[LANES];
+			bool changed = false;
+			bool root = false;
+			for (u32 lane = 0; lane < LANES; ++lane) {
+				const u32 index = order[i + lane];
+				const s32 parent = mParents[index];
+				// parents were finished by the previous level
+				const bool lane_changed = mDirty[index] || mMoving[index] ||
+					(parent >= 0 && mChanged[parent]);
+				mChanged[index] = lane_changed;
+				mDirty[index] = 0;
+				changed |= lane_changed;
+				root |= parent < 0;
+				indices[lane] = index;
+				parents[lane] = parent >= 0 ? parent * 16 : 0;
+			}
+			if (!changed) {
+				continue;
+			}
+			// the first level holds every root and nothing else
+			if (root) {
+				for (u32 lane = 0; lane < LANES; ++lane) {
+					if (mChanged[indices[lane]]) {
+						multiply(indices[lane]);
+					}
+				}
+				continue;
+			}
+			Lane local[12];
+			for (u32 entry = 0; entry < 12; ++entry) {
+				local[entry] = gather(mLocal[entry].data(), indices);
+			}
+			// the upper 3 rows of the parent, the last one is 0 0 0 1
+			Lane parent[4][3];
+			for (u32 column = 0; column < 4; ++column) {
+				for (u32 row = 0; row < 3; ++row) {
+					parent[column][row] =
+						gather(world + column * 4 + row, parents);
+				}
+			}
+			alignas(32) f32 entries[12][LANES];
+			for (u32 column = 0; column < 4; ++column) {
+				for (u32 row = 0; row < 3; ++row) {
+					Lane sum = add(
+						add(mul(parent[0][row], local[column * 3]),
+							mul(parent[1][row], local[column * 3 + 1])),
+						mul(parent[2][row], local[column * 3 + 2]));
+					if (column == 3) {
+						sum = add(sum, parent[3][row]);
+					}
+					store_aligned(entries[column * 3 + row], sum);
+				}
+			}
+			for (u32 lane = 0; lane < LANES; ++lane) {
+				if (!mChanged[indices[lane]]) {
+					continue;
+				}
+				f32 matrix[12];
+				for (u32 entry = 0; entry < 12; ++entry) {
+					matrix[entry] = entries[entry][lane];
+				}
+				write_affine(matrix, mWorld[indices[lane]]);
+			}
+		}
+#endif
+		for (; i < end; ++i) {
+			const u32 index = order[i];
+			const s32 parent = mParents[index];
+			const bool changed = mDirty[index] || mMoving[index] ||
+				(parent >= 0 && mChanged[parent]);
+			mChanged[index] = changed;
+			mDirty[index] = 0;
+			if (changed) {
+				multiply(index);
+			}
+		}
+	}
+
+	void TransformStore::multiply(u32 index) {
+		f32 local[12];
+		for (u32 entry = 0; entry < 12; ++entry) {
+			local[entry] = mLocal[entry][index];
+		}
+		const s32 parent = mParents[index];
+		if (parent < 0) {
+			write_affine(local, mWorld[index]);
+			return;
+		}
+		const glm::mat4& p = mWorld[parent];
+		f32 matrix[12];
+		for (u32 column = 0; column < 4; ++column) {
+			for (u32 row = 0; row < 3; ++row) {
+				matrix[column * 3 + row] = p[0][row] * local[column * 3] +
+					p[1][row] * local[column * 3 + 1] +
+					p[2][row] * local[column * 3 + 2] +
+					(column == 3 ? p[3][row] : 0.f);
+			}
+		}
+		write_affine(matrix, mWorld[index]);
+	}
+} // namespace gameplay
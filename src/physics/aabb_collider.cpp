@@ -2,11 +2,16 @@
 #include <glm/gtx/component_wise.hpp>
 
 namespace physics {
-	AABBCollider::AABBCollider(ArrayList<gameplay::Transform>& transform_list,
+	AABBCollider::AABBCollider(gameplay::TransformStore& transform_list,
 							   u32 transform_index, const glm::vec3& size) :
-		mTransformList(transform_list),
+		mTransformList(&transform_list),
 		mTransformIndex(transform_index), mSize(size) {}
 
+	AABBCollider::AABBCollider(ArrayList<gameplay::Transform>& transform_list,
+							   u32 transform_index, const glm::vec3& size) :
+		AABBCollider(transform_list[transform_index].store(),
+					 transform_list[transform_index].index(), size) {}
+
 	AABBCollider::AABBCollider(AABBCollider&& other) noexcept :
 		mTransformList(other.mTransformList) {
 		mTransformIndex = other.mTransformIndex;
@@ -26,8 +31,8 @@ namespace physics {
 
 	IntersectData
 	AABBCollider::check_collision(const AABBCollider& other) const {
-		const glm::vec3 this_pos = mTransformList[mTransformIndex].position();
-		const glm::vec3 other_pos = other.mTransformList[other.mTransformIndex].position();
+		const glm::vec3 this_pos = center();
+		const glm::vec3 other_pos = other.center();
 		const glm::vec3 max_extent_a = {this_pos.x + (mSize.x * 0.5f),
 										this_pos.y + (mSize.y * 0.5f),
 										this_pos.z + (mSize.z * 0.5f)};
@@ -46,4 +51,36 @@ namespace physics {
 		const float max_val = glm::compMax(distance);
 		return IntersectData(max_val < 0, max_val);
 	}
+
+	bool AABBCollider::raycast(const Ray& ray, RaycastHit& hit) const {
+		return raycast_box(bounds(), ray, hit);
+	}
+
+	bool raycast_box(const BoundingBox& box, const Ray& ray, RaycastHit& hit) {
+		const glm::vec3 inverse_direction = 1.f / ray.direction;
+		const glm::vec3 t0 = (box.min - ray.origin) * inverse_direction;
+		const glm::vec3 t1 = (box.max - ray.origin) * inverse_direction;
+		const glm::vec3 t_min = glm::min(t0, t1);
+		const glm::vec3 t_max = glm::max(t0, t1);
+		u32 axis = 0;
+		if (t_min[1] > t_min[axis])
+			axis = 1;
+		if (t_min[2] > t_min[axis])
+			axis = 2;
+		const f32 enter = t_min[axis];
+		const f32 exit = glm::compMin(t_max);
+		if (enter > exit || exit < 0.f || enter > ray.max_distance) {
+			return false;
+		}
+		// origin inside the box
+		if (enter < 0.f) {
+			hit.distance = 0.f;
+			hit.normal = -ray.direction;
+			return true;
+		}
+		hit.distance = enter;
+		hit.normal = {0, 0, 0};
+		hit.normal[axis] = ray.direction[axis] > 0.f ? -1.f : 1.f;
+		return true;
+	}
 } // namespace physics
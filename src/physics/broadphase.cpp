@@ -0,0 +1,361 @@
+#include "physics/broadphase.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include "core/radix_sort.h"
+#include "core/simd.h"
+
+namespace physics {
+	// cells per axis a 64-bit Morton code holds, coordinates past it are
+	// clamped. That is past where f32 positions can tell cells apart.
+	constexpr s32 GRID_RESOLUTION = 1 << 21;
+	constexpr u32 EMPTY_CELL = ~0u;
+	// room for a lane of loads past the last proxy of the sweep
+#ifdef CORE_SIMD
+	constexpr u32 SWEEP_PADDING = core::simd::LANES;
+#else
+	constexpr u32 SWEEP_PADDING = 0;
+#endif
+	// bounds with an extent over this many times the mean skip the grid
+	constexpr f32 LARGE_PROXY_FACTOR = 2.f;
+	// half of the 26 neighbours, so each pair of cells is visited once
+	constexpr s32 FORWARD_NEIGHBOURS[13][3] = {
+		{1, 0, 0}, {-1, 1, 0}, {0, 1, 0}, {1, 1, 0}, {-1, -1, 1},
+		{0, -1, 1}, {1, -1, 1}, {-1, 0, 1}, {0, 0, 1}, {1, 0, 1},
+		{-1, 1, 1}, {0, 1, 1}, {1, 1, 1},
+	};
+
+	static inline BroadphasePair make_pair(u32 a, u32 b) {
+		return {std::min(a, b), std::max(a, b)};
+	}
+
+	// by first then second, radix sorted as first and second packed into
+	// one key
+	static inline void sort_pairs(ArrayList<BroadphasePair>& pairs,
+								  ArrayList<u64>& keys) {
+		keys.resize(pairs.size());
+		for (u32 i = 0; i < pairs.size(); ++i) {
+			keys[i] = static_cast<u64>(pairs[i].first) << 32 | pairs[i].second;
+		}
+		core::radix_sort(keys);
+		for (u32 i = 0; i < pairs.size(); ++i) {
+			pairs[i] = {static_cast<u32>(keys[i] >> 32),
+						static_cast<u32>(keys[i])};
+		}
+	}
+
+	// spreads the low 21 bits of v to every third bit
+	static inline u64 part_by_2(u64 v) {
+		v &= 0x1fffff;
+		v = (v | (v << 32)) & 0x1f00000000ffff;
+		v = (v | (v << 16)) & 0x1f0000ff0000ff;
+		v = (v | (v << 8)) & 0x100f00f00f00f00f;
+		v = (v | (v << 4)) & 0x10c30c30c30c30c3;
+		v = (v | (v << 2)) & 0x1249249249249249;
+		return v;
+	}
+
+	static inline u32 compact_by_2(u64 v) {
+		v &= 0x1249249249249249;
+		v = (v | (v >> 2)) & 0x10c30c30c30c30c3;
+		v = (v | (v >> 4)) & 0x100f00f00f00f00f;
+		v = (v | (v >> 8)) & 0x1f0000ff0000ff;
+		v = (v | (v >> 16)) & 0x1f00000000ffff;
+		v = (v | (v >> 32)) & 0x1fffff;
+		return static_cast<u32>(v);
+	}
+
+	static inline u64 morton(u32 x, u32 y, u32 z) {
+		return part_by_2(x) | part_by_2(y) << 1 | part_by_2(z) << 2;
+	}
+
+	// slot of code in a table of 1 << bits cells. The low bits of the code
+	// keep cells close in space close in the table, the high bits folded in
+	// spread cells that share them
+	static inline u32 cell_slot(u64 code, u32 bits) {
+		const u64 mask = (1ull << bits) - 1;
+		return static_cast<u32>((code ^ (code >> bits)) & mask);
+	}
+
+	void SweepAndPrune::add(u32 id) {
+		mProxies.push_back({{}, id, id});
+		bResort = true;
+	}
+
+	void SweepAndPrune::sort_proxies() {
+		const u8 axis = mAxis;
+		auto less = [axis](const Proxy& a, const Proxy& b) {
+			return a.bounds.min[axis] < b.bounds.min[axis];
+		};
+		if (bResort) {
+			std::sort(mProxies.begin(), mProxies.end(), less);
+			bResort = false;
+			return;
+		}
+		for (u32 i = 1; i < mProxies.size(); ++i) {
+			if (!less(mProxies[i], mProxies[i - 1])) {
+				continue;
+			}
+			Proxy proxy = mProxies[i];
+			u32 j = i;
+			while (j > 0 && less(proxy, mProxies[j - 1])) {
+				mProxies[j] = mProxies[j - 1];
+				--j;
+			}
+			mProxies[j] = proxy;
+		}
+	}
+
+	void SweepAndPrune::update(const ArrayList<BoundingBox>& bounds) {
+		update_proxies(bounds, [](u32 id) { return id; });
+	}
+
+	void SweepAndPrune::update(const ArrayList<BoundingBox>& bounds,
+							   const ArrayList<u32>& indices) {
+		update_proxies(bounds, [&](u32 id) { return indices[id]; });
+	}
+
+	void SweepAndPrune::remove_stale(const ArrayList<u32>& indices) {
+		std::erase_if(mProxies, [&](const Proxy& proxy) {
+			return indices[proxy.id] == REMOVED_PROXY;
+		});
+	}
+
+	template <typename F>
+	void SweepAndPrune::update_proxies(const ArrayList<BoundingBox>& bounds,
+									   F&& object_index) {
+		mPairs.clear();
+		glm::vec3 sum{0, 0, 0};
+		glm::vec3 sum_squared{0, 0, 0};
+		// drop removed proxies in place, keeping the almost sorted order
+		u32 count = 0;
+		for (u32 i = 0; i < mProxies.size(); ++i) {
+			Proxy proxy = mProxies[i];
+			proxy.object_index = object_index(proxy.id);
+			if (proxy.object_index == REMOVED_PROXY) {
+				continue;
+			}
+			proxy.bounds = bounds[proxy.object_index];
+			const glm::vec3 center =
+				(proxy.bounds.min + proxy.bounds.max) * 0.5f;
+			sum += center;
+			sum_squared += center * center;
+			mProxies[count++] = proxy;
+		}
+		mProxies.resize(count);
+		sort_proxies();
+		sweep();
+		// sweep order depends on the proxy order, sort so that the pair list
+		// only depends on the input bounds
+		sort_pairs(mPairs, mPairKeys);
+		// pick the axis with the largest variance for the next step, only
+		// switching when it is clearly better since a switch costs a resort
+		if (mProxies.size() > 1) {
+			const f32 count = static_cast<f32>(mProxies.size());
+			const glm::vec3 variance = sum_squared - sum * sum / count;
+			u8 best_axis = 0;
+			if (variance[1] > variance[best_axis])
+				best_axis = 1;
+			if (variance[2] > variance[best_axis])
+				best_axis = 2;
+			if (variance[best_axis] > variance[mAxis] * 2.f) {
+				mAxis = best_axis;
+				bResort = true;
+			}
+		}
+	}
+
+	void SweepAndPrune::sweep() {
+		const u32 count = mProxies.size();
+		const u8 axes[3] = {mAxis, static_cast<u8>((mAxis + 1) % 3),
+							static_cast<u8>((mAxis + 2) % 3)};
+		for (u32 k = 0; k < 3; ++k) {
+			mSweepMin[k].resize(count + SWEEP_PADDING);
+			mSweepMax[k].resize(count + SWEEP_PADDING);
+			for (u32 i = 0; i < count; ++i) {
+				mSweepMin[k][i] = mProxies[i].bounds.min[axes[k]];
+				mSweepMax[k][i] = mProxies[i].bounds.max[axes[k]];
+			}
+		}
+		const f32* min[3] = {mSweepMin[0].data(), mSweepMin[1].data(),
+							 mSweepMin[2].data()};
+		const f32* max[3] = {mSweepMax[0].data(), mSweepMax[1].data(),
+							 mSweepMax[2].data()};
+		for (u32 i = 0; i < count; ++i) {
+			const u32 a = mProxies[i].object_index;
+#ifdef CORE_SIMD
+			using namespace core::simd;
+			const Lane sweep_max = broadcast(max[0][i]);
+			const Lane min1 = broadcast(min[1][i]);
+			const Lane max1 = broadcast(max[1][i]);
+			const Lane min2 = broadcast(min[2][i]);
+			const Lane max2 = broadcast(max[2][i]);
+			for (u32 j = i + 1; j < count; j += LANES) {
+				const Lane past = less(sweep_max, load(min[0] + j));
+				const Lane apart = either(
+					either(less(max1, load(min[1] + j)),
+						   less(load(max[1] + j), min1)),
+					either(less(max2, load(min[2] + j)),
+						   less(load(max[2] + j), min2)));
+				// lanes of the padding are dropped
+				const u32 lanes = std::min(count - j, LANES);
+				u32 hits = ~mask(either(past, apart)) & ((1u << lanes) - 1);
+				while (hits != 0) {
+					const u32 lane = std::countr_zero(hits);
+					hits &= hits - 1;
+					mPairs.push_back(
+						make_pair(a, mProxies[j + lane].object_index));
+				}
+				if (mask(past) != 0) {
+					break;
+				}
+			}
+#else
+			for (u32 j = i + 1; j < count; ++j) {
+				if (min[0][j] > max[0][i]) {
+					break;
+				}
+				if (min[1][j] > max[1][i] || max[1][j] < min[1][i] ||
+					min[2][j] > max[2][i] || max[2][j] < min[2][i]) {
+					continue;
+				}
+				mPairs.push_back(make_pair(a, mProxies[j].object_index));
+			}
+#endif
+		}
+	}
+
+	void SpatialHashGrid::update(const ArrayList<BoundingBox>& bounds,
+								 const ArrayList<u32>& objects) {
+		mPairs.clear();
+		mEntries.clear();
+		mLarge.clear();
+		if (objects.empty()) {
+			return;
+		}
+		const auto extent = [](const BoundingBox& box) {
+			const glm::vec3 size = box.max - box.min;
+			return std::max(size.x, std::max(size.y, size.z));
+		};
+		f32 mean = 0.f;
+		for (u32 object : objects) {
+			mean += extent(bounds[object]);
+		}
+		mean /= static_cast<f32>(objects.size());
+		// cells as large as the largest regular proxy, so overlapping
+		// proxies always sit in the same or in neighbouring cells
+		const f32 limit = mean * LARGE_PROXY_FACTOR;
+		f32 cell_size = 0.f;
+		glm::vec3 origin{MAX_F32, MAX_F32, MAX_F32};
+		for (u32 object : objects) {
+			const BoundingBox& box = bounds[object];
+			const f32 size = extent(box);
+			if (size > limit) {
+				mLarge.push_back({box, object});
+				continue;
+			}
+			cell_size = std::max(cell_size, size);
+			origin = glm::min(origin, box.min);
+			mEntries.push_back({box, object});
+		}
+		mCellSize = cell_size > 0.f ? cell_size : 1.f;
+		const f32 inverse_cell = 1.f / mCellSize;
+		mCodes.resize(mEntries.size());
+		mOrder.resize(mEntries.size());
+		for (u32 i = 0; i < mEntries.size(); ++i) {
+			const glm::vec3 cell =
+				(mEntries[i].bounds.min - origin) * inverse_cell;
+			u32 coords[3];
+			for (u32 axis = 0; axis < 3; ++axis) {
+				coords[axis] = static_cast<u32>(std::min(
+					cell[axis], static_cast<f32>(GRID_RESOLUTION - 1)));
+			}
+			mCodes[i] = morton(coords[0], coords[1], coords[2]);
+			mOrder[i] = i;
+		}
+		// entries in Morton order, each cell one run
+		core::radix_sort(mCodes, mOrder);
+		mSorted.resize(mEntries.size());
+		mCells.clear();
+		for (u32 i = 0; i < mOrder.size(); ++i) {
+			mSorted[i] = mEntries[mOrder[i]];
+			if (mCells.empty() || mCells.back().code != mCodes[i]) {
+				mCells.push_back({mCodes[i], i, i});
+			}
+			++mCells.back().end;
+		}
+		// neighbours are looked up by code, open addressing at most half
+		// full
+		const u32 bits = std::bit_width(std::max<u32>(mCells.size(), 16)) + 1;
+		const u32 mask = (1u << bits) - 1;
+		mCellTable.assign(mask + 1, {0, EMPTY_CELL});
+		for (u32 c = 0; c < mCells.size(); ++c) {
+			u32 slot = cell_slot(mCells[c].code, bits);
+			while (mCellTable[slot].cell != EMPTY_CELL) {
+				slot = (slot + 1) & mask;
+			}
+			mCellTable[slot] = {mCells[c].code, c};
+		}
+		const auto find_cell = [&](u64 code) {
+			for (u32 slot = cell_slot(code, bits);;
+				 slot = (slot + 1) & mask) {
+				const CellSlot& entry = mCellTable[slot];
+				if (entry.cell == EMPTY_CELL || entry.code == code) {
+					return entry.cell;
+				}
+			}
+		};
+		for (const Cell& cell : mCells) {
+			// the rest of the own cell, then the forward neighbours
+			for (u32 i = cell.begin; i < cell.end; ++i) {
+				add_pairs(mSorted[i], i + 1, cell.end);
+			}
+			const s32 x = compact_by_2(cell.code);
+			const s32 y = compact_by_2(cell.code >> 1);
+			const s32 z = compact_by_2(cell.code >> 2);
+			for (const auto& offset : FORWARD_NEIGHBOURS) {
+				const s32 nx = x + offset[0];
+				const s32 ny = y + offset[1];
+				const s32 nz = z + offset[2];
+				if (nx < 0 || ny < 0 || nz < 0 || nx >= GRID_RESOLUTION ||
+					ny >= GRID_RESOLUTION || nz >= GRID_RESOLUTION) {
+					continue;
+				}
+				const u32 neighbour = find_cell(morton(nx, ny, nz));
+				if (neighbour == EMPTY_CELL) {
+					continue;
+				}
+				for (u32 i = cell.begin; i < cell.end; ++i) {
+					add_pairs(mSorted[i], mCells[neighbour].begin,
+							  mCells[neighbour].end);
+				}
+			}
+		}
+		for (u32 i = 0; i < mLarge.size(); ++i) {
+			const Entry& large = mLarge[i];
+			for (const Entry& entry : mSorted) {
+				if (large.bounds.overlaps(entry.bounds)) {
+					mPairs.push_back(
+						make_pair(large.object_index, entry.object_index));
+				}
+			}
+			for (u32 j = i + 1; j < mLarge.size(); ++j) {
+				if (large.bounds.overlaps(mLarge[j].bounds)) {
+					mPairs.push_back(
+						make_pair(large.object_index, mLarge[j].object_index));
+				}
+			}
+		}
+		sort_pairs(mPairs, mPairKeys);
+	}
+
+	void SpatialHashGrid::add_pairs(const Entry& entry, u32 begin, u32 end) {
+		for (u32 i = begin; i < end; ++i) {
+			const Entry& other = mSorted[i];
+			if (entry.bounds.overlaps(other.bounds)) {
+				mPairs.push_back(
+					make_pair(entry.object_index, other.object_index));
+			}
+		}
+	}
+} // namespace physics
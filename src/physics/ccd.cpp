@@ -0,0 +1,101 @@
+#include "physics/physics_engine.h"
+#include <cmath>
+#include "core/sapfire_engine.h"
+
+namespace physics {
+	// how far past the time of impact a bullet is placed, deep enough for
+	// the narrowphase to report the contact and the solver to bounce it
+	constexpr f32 BULLET_PENETRATION = 0.01f;
+
+	// first time in [0, 1] the sphere moving by motion touches the plane,
+	// contacts it already starts in are left to the narrowphase
+	static bool sweep_sphere_plane(const glm::vec3& start,
+								   const glm::vec3& motion, f32 radius,
+								   const PlaneCollider& plane, f32& toi,
+								   glm::vec3& normal) {
+		const f32 side = glm::dot(start, plane.normal()) - plane.distance();
+		if (std::fabs(side) < radius) {
+			return false;
+		}
+		// approach the plane from whichever side the sphere is on
+		normal = side < 0.f ? -plane.normal() : plane.normal();
+		const f32 approach = glm::dot(motion, normal);
+		if (approach >= 0.f) {
+			return false;
+		}
+		toi = (std::fabs(side) - radius) / -approach;
+		return toi <= 1.f;
+	}
+
+	void Engine::sweep_bullets(f32 delta_time) {
+		for (u32 i = 0; i < mRigidBodies.size(); ++i) {
+			if (!mRigidBodies[i].bullet) {
+				continue;
+			}
+			const PhysicsObject& po = mPhysicsObjects[mRigidBodyOwners[i]];
+			if (po.collider_type != ColliderType::Sphere ||
+				po.movemevent_component_index < 0 || po.sleeping) {
+				continue;
+			}
+			const SphereCollider& sphere =
+				mSpheres[po.collider_component_index];
+			const glm::vec3& velocity =
+				mMovementComponents[po.movemevent_component_index].velocity;
+			const glm::vec3 end = sphere.center();
+			const glm::vec3 motion = velocity * delta_time;
+			const f32 distance = glm::length(motion);
+			// shorter moves overlap anything they pass through at the end
+			// or the start of the step, the narrowphase catches those
+			if (distance < sphere.radius()) {
+				continue;
+			}
+			const glm::vec3 start = end - motion;
+			f32 toi = 1.f;
+			glm::vec3 normal{0, 0, 0};
+			bool hit = false;
+			const Ray ray{start, motion / distance, distance};
+			const BoundingBox swept{
+				glm::min(start, end) - sphere.radius(),
+				glm::max(start, end) + sphere.radius()};
+			mTree.query(swept, [&](u32 other) {
+				const PhysicsObject& target = mPhysicsObjects[other];
+				if (target.collider_type != ColliderType::AABB) {
+					return true;
+				}
+				// the center against the box grown by the radius, slightly
+				// conservative around edges and corners
+				BoundingBox box =
+					mAABBs[target.collider_component_index].bounds();
+				box.min -= sphere.radius();
+				box.max += sphere.radius();
+				RaycastHit candidate{other};
+				if (raycast_box(box, ray, candidate) &&
+					candidate.distance > 0.f &&
+					candidate.distance / distance < toi) {
+					toi = candidate.distance / distance;
+					normal = candidate.normal;
+					hit = true;
+				}
+				return true;
+			});
+			for (const PlaneCollider& plane : mPlanes) {
+				f32 plane_toi = 1.f;
+				glm::vec3 plane_normal{0, 0, 0};
+				if (sweep_sphere_plane(start, motion, sphere.radius(), plane,
+									   plane_toi, plane_normal) &&
+					plane_toi < toi) {
+					toi = plane_toi;
+					normal = plane_normal;
+					hit = true;
+				}
+			}
+			if (!hit) {
+				continue;
+			}
+			const f32 approach = -glm::dot(motion, normal);
+			toi = std::min(toi + BULLET_PENETRATION / approach, 1.f);
+			mCoreEngine->transforms()[po.transform_index].position(
+				start + motion * toi);
+		}
+	}
+} // namespace physics
@@ -0,0 +1,327 @@
+#include "physics/dynamic_tree.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DYNAMIC_TREE_SIMD
+#endif
+
+namespace physics {
+	static inline BoundingBox combine(const BoundingBox& a,
+									  const BoundingBox& b) {
+		return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+	}
+
+	static inline bool contains(const BoundingBox& outer,
+								const BoundingBox& inner) {
+		return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+			outer.min.z <= inner.min.z && outer.max.x >= inner.max.x &&
+			outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+	}
+
+	// surface area heuristic, the factor of 2 is irrelevant for comparisons
+	static inline f32 area(const BoundingBox& box) {
+		const glm::vec3 d = box.max - box.min;
+		return d.x * d.y + d.y * d.z + d.z * d.x;
+	}
+
+	s32 DynamicTree::allocate_node() {
+		if (mFreeList == NULL_NODE) {
+			mNodes.push_back({});
+			mNodes.back().height = 0;
+			return mNodes.size() - 1;
+		}
+		const s32 node = mFreeList;
+		mFreeList = mNodes[node].parent;
+		mNodes[node] = {};
+		mNodes[node].height = 0;
+		return node;
+	}
+
+	void DynamicTree::free_node(s32 node) {
+		mNodes[node].parent = mFreeList;
+		mNodes[node].height = -1;
+		mFreeList = node;
+	}
+
+	s32 DynamicTree::create_proxy(const BoundingBox& bounds, u32 object_index) {
+		const s32 proxy = allocate_node();
+		mNodes[proxy].bounds = {bounds.min - MARGIN, bounds.max + MARGIN};
+		mNodes[proxy].object_index = object_index;
+		insert_leaf(proxy);
+		++mProxyCount;
+		return proxy;
+	}
+
+	void DynamicTree::destroy_proxy(s32 proxy) {
+		assert(mNodes[proxy].is_leaf());
+		remove_leaf(proxy);
+		free_node(proxy);
+		--mProxyCount;
+	}
+
+	bool DynamicTree::move_proxy(s32 proxy, const BoundingBox& bounds,
+								 const glm::vec3& displacement) {
+		assert(mNodes[proxy].is_leaf());
+		if (contains(mNodes[proxy].bounds, bounds)) {
+			return false;
+		}
+		remove_leaf(proxy);
+		BoundingBox fat{bounds.min - MARGIN, bounds.max + MARGIN};
+		// stretch the bounds along the direction of travel so fast bodies
+		// do not have to be reinserted every step
+		const glm::vec3 d = displacement * DISPLACEMENT_MULTIPLIER;
+		fat.min += glm::min(d, glm::vec3{0, 0, 0});
+		fat.max += glm::max(d, glm::vec3{0, 0, 0});
+		mNodes[proxy].bounds = fat;
+		insert_leaf(proxy);
+		return true;
+	}
+
+	void DynamicTree::insert_leaf(s32 leaf) {
+		if (mRoot == NULL_NODE) {
+			mRoot = leaf;
+			mNodes[leaf].parent = NULL_NODE;
+			return;
+		}
+		// descend towards the sibling that grows the total area the least
+		const BoundingBox leaf_bounds = mNodes[leaf].bounds;
+		s32 index = mRoot;
+		while (!mNodes[index].is_leaf()) {
+			const Node& node = mNodes[index];
+			const f32 node_area = area(node.bounds);
+			const f32 combined_area = area(combine(node.bounds, leaf_bounds));
+			// cost of making a new parent for this node and the leaf
+			const f32 cost = 2.f * combined_area;
+			// minimum cost of pushing the leaf further down
+			const f32 inheritance_cost = 2.f * (combined_area - node_area);
+			f32 child_costs[2];
+			for (u32 i = 0; i < 2; ++i) {
+				const Node& child = mNodes[node.children[i]];
+				const f32 grown = area(combine(child.bounds, leaf_bounds));
+				child_costs[i] = child.is_leaf()
+					? grown + inheritance_cost
+					: grown - area(child.bounds) + inheritance_cost;
+			}
+			if (cost < child_costs[0] && cost < child_costs[1]) {
+				break;
+			}
+			index = child_costs[0] < child_costs[1] ? node.children[0]
+													: node.children[1];
+		}
+		const s32 sibling = index;
+		const s32 old_parent = mNodes[sibling].parent;
+		const s32 new_parent = allocate_node();
+		mNodes[new_parent].parent = old_parent;
+		mNodes[new_parent].bounds =
+			combine(leaf_bounds, mNodes[sibling].bounds);
+		mNodes[new_parent].height = mNodes[sibling].height + 1;
+		mNodes[new_parent].children[0] = sibling;
+		mNodes[new_parent].children[1] = leaf;
+		mNodes[sibling].parent = new_parent;
+		mNodes[leaf].parent = new_parent;
+		if (old_parent == NULL_NODE) {
+			mRoot = new_parent;
+		} else if (mNodes[old_parent].children[0] == sibling) {
+			mNodes[old_parent].children[0] = new_parent;
+		} else {
+			mNodes[old_parent].children[1] = new_parent;
+		}
+		// walk back up refitting bounds and heights
+		index = mNodes[leaf].parent;
+		while (index != NULL_NODE) {
+			index = balance(index);
+			Node& node = mNodes[index];
+			const Node& a = mNodes[node.children[0]];
+			const Node& b = mNodes[node.children[1]];
+			node.height = 1 + std::max(a.height, b.height);
+			node.bounds = combine(a.bounds, b.bounds);
+			index = node.parent;
+		}
+	}
+
+	void DynamicTree::remove_leaf(s32 leaf) {
+		if (leaf == mRoot) {
+			mRoot = NULL_NODE;
+			return;
+		}
+		const s32 parent = mNodes[leaf].parent;
+		const s32 grandparent = mNodes[parent].parent;
+		const s32 sibling = mNodes[parent].children[0] == leaf
+			? mNodes[parent].children[1]
+			: mNodes[parent].children[0];
+		free_node(parent);
+		if (grandparent == NULL_NODE) {
+			mRoot = sibling;
+			mNodes[sibling].parent = NULL_NODE;
+			return;
+		}
+		if (mNodes[grandparent].children[0] == parent) {
+			mNodes[grandparent].children[0] = sibling;
+		} else {
+			mNodes[grandparent].children[1] = sibling;
+		}
+		mNodes[sibling].parent = grandparent;
+		s32 index = grandparent;
+		while (index != NULL_NODE) {
+			index = balance(index);
+			Node& node = mNodes[index];
+			const Node& a = mNodes[node.children[0]];
+			const Node& b = mNodes[node.children[1]];
+			node.height = 1 + std::max(a.height, b.height);
+			node.bounds = combine(a.bounds, b.bounds);
+			index = node.parent;
+		}
+	}
+
+	// Rotates node a if its children heights differ by more than one and
+	// returns the index of the subtree root afterwards. Below, b and c are
+	// the children of a, d and e the children of b, f and g those of c.
+	s32 DynamicTree::balance(s32 ia) {
+		Node& a = mNodes[ia];
+		if (a.is_leaf() || a.height < 2) {
+			return ia;
+		}
+		const s32 ib = a.children[0];
+		const s32 ic = a.children[1];
+		const s32 skew = mNodes[ic].height - mNodes[ib].height;
+		if (skew >= -1 && skew <= 1) {
+			return ia;
+		}
+		// promote the taller child, `up` takes a's place and a keeps the
+		// shorter grandchild
+		const bool right_heavy = skew > 1;
+		const s32 iup = right_heavy ? ic : ib;
+		const s32 iother = right_heavy ? ib : ic;
+		Node& up = mNodes[iup];
+		const s32 i0 = up.children[0];
+		const s32 i1 = up.children[1];
+		up.children[0] = ia;
+		up.parent = a.parent;
+		a.parent = iup;
+		if (up.parent == NULL_NODE) {
+			mRoot = iup;
+		} else if (mNodes[up.parent].children[0] == ia) {
+			mNodes[up.parent].children[0] = iup;
+		} else {
+			mNodes[up.parent].children[1] = iup;
+		}
+		const bool keep_first = mNodes[i0].height > mNodes[i1].height;
+		const s32 ikeep = keep_first ? i0 : i1;
+		const s32 imove = keep_first ? i1 : i0;
+		up.children[1] = ikeep;
+		if (right_heavy) {
+			a.children[1] = imove;
+		} else {
+			a.children[0] = imove;
+		}
+		mNodes[imove].parent = ia;
+		a.bounds = combine(mNodes[iother].bounds, mNodes[imove].bounds);
+		up.bounds = combine(a.bounds, mNodes[ikeep].bounds);
+		a.height = 1 + std::max(mNodes[iother].height, mNodes[imove].height);
+		up.height = 1 + std::max(a.height, mNodes[ikeep].height);
+		return iup;
+	}
+
+	void DynamicTree::overlap_aabb(const BoundingBox& bounds,
+								   ArrayList<u32>& out) const {
+		query(bounds, [&out](u32 object_index) {
+			out.push_back(object_index);
+			return true;
+		});
+	}
+
+	void DynamicTree::overlap_sphere(const glm::vec3& center, f32 radius,
+									 ArrayList<u32>& out) const {
+		if (mRoot == NULL_NODE) {
+			return;
+		}
+		const f32 radius_squared = radius * radius;
+		s32 stack[STACK_SIZE];
+		u32 count = 0;
+		stack[count++] = mRoot;
+		while (count > 0) {
+			const Node& node = mNodes[stack[--count]];
+			const glm::vec3 closest =
+				glm::clamp(center, node.bounds.min, node.bounds.max);
+			const glm::vec3 delta = closest - center;
+			if (glm::dot(delta, delta) > radius_squared) {
+				continue;
+			}
+			if (node.is_leaf()) {
+				out.push_back(node.object_index);
+			} else {
+				assert(count + 2 <= STACK_SIZE);
+				stack[count++] = node.children[0];
+				stack[count++] = node.children[1];
+			}
+		}
+	}
+
+	u32 DynamicTree::packet_mask(const BoundingBox& bounds, f32 radius,
+								 const RayPacket& packet) {
+#if defined(DYNAMIC_TREE_SIMD)
+		static_assert(PACKET_SIZE == 4);
+		// same slab test as raycast, one ray per lane
+		__m128 enter = _mm_setzero_ps();
+		__m128 exit = _mm_load_ps(packet.max_distance);
+		for (u32 axis = 0; axis < 3; ++axis) {
+			const __m128 origin = _mm_load_ps(packet.origin[axis]);
+			const __m128 inverse = _mm_load_ps(packet.inverse_direction[axis]);
+			const __m128 t0 = _mm_mul_ps(
+				_mm_sub_ps(_mm_set1_ps(bounds.min[axis] - radius), origin),
+				inverse);
+			const __m128 t1 = _mm_mul_ps(
+				_mm_sub_ps(_mm_set1_ps(bounds.max[axis] + radius), origin),
+				inverse);
+			enter = _mm_max_ps(enter, _mm_min_ps(t0, t1));
+			exit = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+		}
+		return _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+#else
+		u32 mask = 0;
+		for (u32 lane = 0; lane < PACKET_SIZE; ++lane) {
+			f32 enter = 0.f;
+			f32 exit = packet.max_distance[lane];
+			for (u32 axis = 0; axis < 3; ++axis) {
+				const f32 origin = packet.origin[axis][lane];
+				const f32 inverse = packet.inverse_direction[axis][lane];
+				const f32 t0 = (bounds.min[axis] - radius - origin) * inverse;
+				const f32 t1 = (bounds.max[axis] + radius - origin) * inverse;
+				enter = std::max(enter, std::min(t0, t1));
+				exit = std::min(exit, std::max(t0, t1));
+			}
+			mask |= static_cast<u32>(enter <= exit) << lane;
+		}
+		return mask;
+#endif
+	}
+
+	bool DynamicTree::validate() const {
+		if (mRoot == NULL_NODE) {
+			return mProxyCount == 0;
+		}
+		return mNodes[mRoot].parent == NULL_NODE && validate(mRoot);
+	}
+
+	bool DynamicTree::validate(s32 index) const {
+		const Node& node = mNodes[index];
+		if (node.is_leaf()) {
+			return node.height == 0;
+		}
+		const Node& a = mNodes[node.children[0]];
+		const Node& b = mNodes[node.children[1]];
+		if (a.parent != index || b.parent != index) {
+			return false;
+		}
+		if (node.height != 1 + std::max(a.height, b.height)) {
+			return false;
+		}
+		if (!contains(node.bounds, a.bounds) ||
+			!contains(node.bounds, b.bounds)) {
+			return false;
+		}
+		return validate(node.children[0]) && validate(node.children[1]);
+	}
+} // namespace physics
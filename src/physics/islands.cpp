@@ -0,0 +1,38 @@
+#include "physics/islands.h"
+#include <numeric>
+
+namespace physics {
+	void Islands::reset(u32 count) {
+		mParents.resize(count);
+		std::iota(mParents.begin(), mParents.end(), 0);
+		mRanks.assign(count, 0);
+	}
+
+	u32 Islands::find(u32 index) {
+		u32 root = index;
+		while (mParents[root] != root) {
+			root = mParents[root];
+		}
+		while (mParents[index] != root) {
+			const u32 next = mParents[index];
+			mParents[index] = root;
+			index = next;
+		}
+		return root;
+	}
+
+	void Islands::merge(u32 a, u32 b) {
+		a = find(a);
+		b = find(b);
+		if (a == b) {
+			return;
+		}
+		if (mRanks[a] < mRanks[b]) {
+			std::swap(a, b);
+		}
+		mParents[b] = a;
+		if (mRanks[a] == mRanks[b]) {
+			++mRanks[a];
+		}
+	}
+} // namespace physics
@@ -0,0 +1,244 @@
+#include "physics/physics_engine.h"
+#include <cmath>
+#include "core/sapfire_engine.h"
+
+namespace physics {
+	// used when neither object of a contact has a rigidbody
+	constexpr f32 DEFAULT_RESTITUTION = 0.5f;
+	// pairs per narrowphase task, fixed so the chunking and with it the
+	// contact order never depends on the thread count
+	constexpr u32 NARROWPHASE_CHUNK_SIZE = 128;
+
+	void Engine::narrowphase() {
+		const u32 chunk_count = core::ThreadPool::chunk_count(
+			mPairs.size(), NARROWPHASE_CHUNK_SIZE);
+		if (mNarrowphaseChunks.size() < chunk_count) {
+			mNarrowphaseChunks.resize(chunk_count);
+		}
+		mCoreEngine->thread_pool().parallel_for(
+			mPairs.size(), NARROWPHASE_CHUNK_SIZE,
+			[&](u32 chunk, u32 begin, u32 end) {
+				narrowphase(begin, end, mNarrowphaseChunks[chunk]);
+			});
+		// merge in chunk order so contacts come out in pair order no matter
+		// which thread ran which chunk
+		mCollisions.clear();
+		for (u32 chunk = 0; chunk < chunk_count; ++chunk) {
+			const auto& contacts = mNarrowphaseChunks[chunk].contacts;
+			mCollisions.insert(mCollisions.end(), contacts.begin(),
+							   contacts.end());
+		}
+	}
+
+	void Engine::narrowphase(u32 begin, u32 end,
+							 NarrowphaseChunk& chunk) const {
+		// upper triangle only, pairs are swapped so the lower type comes
+		// first. Planes never move so plane-plane stays empty.
+		static constexpr u32 TYPES = static_cast<u32>(ColliderType::MAX);
+		static constexpr CollideFunction table[TYPES][TYPES] = {
+			{nullptr, nullptr, nullptr, nullptr},
+			{nullptr, &Engine::collide_sphere_sphere,
+			 &Engine::collide_sphere_aabb, &Engine::collide_sphere_plane},
+			{nullptr, nullptr, &Engine::collide_aabb_aabb,
+			 &Engine::collide_aabb_plane},
+			{nullptr, nullptr, nullptr, nullptr},
+		};
+		chunk.contacts.clear();
+		// sphere pairs are the bulk of most scenes, reject them in one batch
+		// and consume the results in pair order below
+		chunk.sphere_first.clear();
+		chunk.sphere_second.clear();
+		for (u32 i = begin; i < end; ++i) {
+			const PhysicsObject& a = mPhysicsObjects[mPairs[i].first];
+			const PhysicsObject& b = mPhysicsObjects[mPairs[i].second];
+			if (a.collider_type == ColliderType::Sphere &&
+				b.collider_type == ColliderType::Sphere) {
+				chunk.sphere_first.push_back(a.collider_component_index);
+				chunk.sphere_second.push_back(b.collider_component_index);
+			}
+		}
+		chunk.sphere_results.resize(chunk.sphere_first.size());
+		mSphereBatch.check_collision(
+			chunk.sphere_first.data(), chunk.sphere_second.data(),
+			chunk.sphere_first.size(), chunk.sphere_results.data());
+		u32 sphere_pair_index = 0;
+		for (u32 i = begin; i < end; ++i) {
+			u32 first = mPairs[i].first;
+			u32 second = mPairs[i].second;
+			if (mPhysicsObjects[first].collider_type >
+				mPhysicsObjects[second].collider_type) {
+				std::swap(first, second);
+			}
+			const PhysicsObject& a = mPhysicsObjects[first];
+			const PhysicsObject& b = mPhysicsObjects[second];
+			if (a.collider_type == ColliderType::Sphere &&
+				b.collider_type == ColliderType::Sphere &&
+				!chunk.sphere_results[sphere_pair_index++].intersect) {
+				continue;
+			}
+			const CollideFunction collide =
+				table[static_cast<u32>(a.collider_type)]
+					 [static_cast<u32>(b.collider_type)];
+			if (!collide) {
+				continue;
+			}
+			CollisionContact& contact = chunk.contacts.emplace_back();
+			contact.objects[0] = first;
+			contact.objects[1] = second;
+			contact.restitution = restitution(a, b);
+			if (!(this->*collide)(a, b, contact)) {
+				chunk.contacts.pop_back();
+			}
+		}
+	}
+
+	// the bouncier body wins, static colliders without a rigidbody don't
+	// take part
+	f32 Engine::restitution(const PhysicsObject& a,
+							const PhysicsObject& b) const {
+		if (a.rigidbody_component_index < 0 &&
+			b.rigidbody_component_index < 0) {
+			return DEFAULT_RESTITUTION;
+		}
+		f32 result = 0.f;
+		if (a.rigidbody_component_index >= 0) {
+			result = mRigidBodies[a.rigidbody_component_index].restitution;
+		}
+		if (b.rigidbody_component_index >= 0) {
+			result = std::max(
+				result, mRigidBodies[b.rigidbody_component_index].restitution);
+		}
+		return result;
+	}
+
+	bool Engine::collide_sphere_sphere(const PhysicsObject& a,
+									   const PhysicsObject& b,
+									   CollisionContact& contact) const {
+		const glm::vec3 center_a =
+			mSphereBatch.center(a.collider_component_index);
+		const glm::vec3 center_b =
+			mSphereBatch.center(b.collider_component_index);
+		const f32 radius_a = mSphereBatch.radius(a.collider_component_index);
+		const glm::vec3 delta = center_a - center_b;
+		const f32 length = glm::length(delta);
+		const f32 penetration =
+			radius_a + mSphereBatch.radius(b.collider_component_index) - length;
+		if (penetration <= 0.f) {
+			return false;
+		}
+		contact.contact_normal =
+			length > 0.f ? delta / length : glm::vec3{0, 1, 0};
+		contact.distance = penetration;
+		contact.contact_point = center_a - contact.contact_normal * radius_a;
+		return true;
+	}
+
+	bool Engine::collide_sphere_aabb(const PhysicsObject& a,
+									 const PhysicsObject& b,
+									 CollisionContact& contact) const {
+		const SphereCollider& sphere = mSpheres[a.collider_component_index];
+		const BoundingBox box = mAABBs[b.collider_component_index].bounds();
+		const glm::vec3 center = sphere.center();
+		const glm::vec3 closest = glm::clamp(center, box.min, box.max);
+		const glm::vec3 delta = center - closest;
+		const f32 length_squared = glm::dot(delta, delta);
+		if (length_squared >= sphere.radius() * sphere.radius()) {
+			return false;
+		}
+		if (length_squared > 0.f) {
+			const f32 length = std::sqrt(length_squared);
+			contact.contact_normal = delta / length;
+			contact.distance = sphere.radius() - length;
+		} else {
+			// center inside the box, push out through the nearest face
+			f32 nearest = MAX_F32;
+			for (u32 axis = 0; axis < 3; ++axis) {
+				const f32 to_min = center[axis] - box.min[axis];
+				const f32 to_max = box.max[axis] - center[axis];
+				if (to_min < nearest) {
+					nearest = to_min;
+					contact.contact_normal = {0, 0, 0};
+					contact.contact_normal[axis] = -1.f;
+				}
+				if (to_max < nearest) {
+					nearest = to_max;
+					contact.contact_normal = {0, 0, 0};
+					contact.contact_normal[axis] = 1.f;
+				}
+			}
+			contact.distance = sphere.radius() + nearest;
+		}
+		contact.contact_point =
+			center - contact.contact_normal * sphere.radius();
+		return true;
+	}
+
+	bool Engine::collide_sphere_plane(const PhysicsObject& a,
+									  const PhysicsObject& b,
+									  CollisionContact& contact) const {
+		const SphereCollider& sphere = mSpheres[a.collider_component_index];
+		const PlaneCollider& plane = mPlanes[b.collider_component_index];
+		const f32 side =
+			glm::dot(sphere.center(), plane.normal()) - plane.distance();
+		const f32 penetration = sphere.radius() - std::fabs(side);
+		if (penetration <= 0.f) {
+			return false;
+		}
+		contact.contact_normal = side < 0.f ? -plane.normal() : plane.normal();
+		contact.distance = penetration;
+		contact.contact_point =
+			sphere.center() - contact.contact_normal * sphere.radius();
+		return true;
+	}
+
+	bool Engine::collide_aabb_aabb(const PhysicsObject& a,
+								   const PhysicsObject& b,
+								   CollisionContact& contact) const {
+		const AABBCollider& box_a = mAABBs[a.collider_component_index];
+		const AABBCollider& box_b = mAABBs[b.collider_component_index];
+		const glm::vec3 delta = box_a.center() - box_b.center();
+		const glm::vec3 overlap =
+			(box_a.size() + box_b.size()) * 0.5f - glm::abs(delta);
+		if (overlap.x <= 0.f || overlap.y <= 0.f || overlap.z <= 0.f) {
+			return false;
+		}
+		// push out along the axis of least overlap
+		u32 axis = 0;
+		if (overlap[1] < overlap[axis])
+			axis = 1;
+		if (overlap[2] < overlap[axis])
+			axis = 2;
+		contact.contact_normal = {0, 0, 0};
+		contact.contact_normal[axis] = delta[axis] < 0 ? -1.f : 1.f;
+		contact.distance = overlap[axis];
+		// middle of the overlapping region
+		const BoundingBox bounds_a = box_a.bounds();
+		const BoundingBox bounds_b = box_b.bounds();
+		contact.contact_point = (glm::max(bounds_a.min, bounds_b.min) +
+								 glm::min(bounds_a.max, bounds_b.max)) *
+			0.5f;
+		return true;
+	}
+
+	bool Engine::collide_aabb_plane(const PhysicsObject& a,
+									const PhysicsObject& b,
+									CollisionContact& contact) const {
+		const AABBCollider& box = mAABBs[a.collider_component_index];
+		const PlaneCollider& plane = mPlanes[b.collider_component_index];
+		const glm::vec3 extents = box.size() * 0.5f;
+		const f32 projected_radius =
+			glm::dot(extents, glm::abs(plane.normal()));
+		const f32 side =
+			glm::dot(box.center(), plane.normal()) - plane.distance();
+		const f32 penetration = projected_radius - std::fabs(side);
+		if (penetration <= 0.f) {
+			return false;
+		}
+		contact.contact_normal = side < 0.f ? -plane.normal() : plane.normal();
+		contact.distance = penetration;
+		// corner furthest along -normal
+		contact.contact_point =
+			box.center() - extents * glm::sign(contact.contact_normal);
+		return true;
+	}
+} // namespace physics
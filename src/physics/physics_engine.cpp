@@ -1,11 +1,56 @@
 #include "physics/physics_engine.h"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <tiny_gltf.h>
 #include "core/sapfire_engine.h"
 
 namespace physics {
+	// objects per integration task, small enough to balance across cores
+	// and large enough to amortize the dispatch
+	constexpr u32 INTEGRATION_CHUNK_SIZE = 256;
+	// bodies slower than this for TIME_TO_SLEEP seconds may go to sleep
+	constexpr f32 SLEEP_VELOCITY = 0.05f;
+	constexpr f32 TIME_TO_SLEEP = 0.5f;
 
-	Engine::Engine(core::Engine* core_engine) : mCoreEngine(core_engine) {}
+	// source of Engine::mStructureVersion
+	static std::atomic<u64> structure_versions{0};
+
+	Engine::Engine(core::Engine* core_engine, BroadphaseType broadphase) :
+		mCoreEngine(core_engine), mBroadphaseType(broadphase) {}
+
+	static inline bool plane_overlaps(const PlaneCollider& plane,
+									  const BoundingBox& box) {
+		const glm::vec3 center = (box.min + box.max) * 0.5f;
+		const glm::vec3 extents = (box.max - box.min) * 0.5f;
+		const f32 projected_radius =
+			glm::dot(extents, glm::abs(plane.normal()));
+		const f32 distance =
+			glm::dot(center, plane.normal()) - plane.distance();
+		return std::fabs(distance) <= projected_radius;
+	}
+
+	// diagonal of the body space inverse inertia tensor of a solid shape,
+	// zero for shapes that don't rotate
+	static glm::vec3 body_inverse_inertia(ColliderType type,
+										  const ColliderSettings& settings,
+										  f32 inverse_mass) {
+		switch (type) {
+		case ColliderType::Sphere: {
+			const f32 r2 = settings.radius * settings.radius;
+			// a point has no inertia to invert
+			if (!(r2 > 0.f)) {
+				return {0, 0, 0};
+			}
+			return glm::vec3{inverse_mass * 5.f / (2.f * r2)};
+		}
+		// the narrowphase treats boxes as axis aligned, a box that turned
+		// would still collide as if it hadn't
+		case ColliderType::AABB:
+		default:
+			return {0, 0, 0};
+		}
+	}
 
 	static s32 transform_index{0};
 	void Engine::load_scene(const asset::GLTFImporter& scene_asset) {
@@ -66,25 +111,30 @@ namespace physics {
 		++transform_index;
 	}
 
-	s32 Engine::add_physics_object(
+	PhysicsHandle Engine::add_physics_object(
 		s32 transform_index, ColliderType type, ColliderSettings settings,
 		std::optional<gameplay::MovementComponent> movement_comp,
 		std::optional<RigidBody> rb) {
+		const u32 object_index = mPhysicsObjects.size();
 		PhysicsObject object{transform_index};
 		object.collider_type = type;
 		switch (type) {
 		case ColliderType::Sphere:
 			mSpheres.emplace_back(mCoreEngine->transforms(), transform_index,
 								  settings.radius);
+			mSphereOwners.push_back(object_index);
 			object.collider_component_index = mSpheres.size() - 1;
+			mSphereBatch.push(mSpheres.back().center(), settings.radius);
 			break;
 		case ColliderType::AABB:
 			mAABBs.emplace_back(mCoreEngine->transforms(), transform_index,
 								settings.size);
+			mAABBOwners.push_back(object_index);
 			object.collider_component_index = mAABBs.size() - 1;
 			break;
 		case ColliderType::Plane:
 			mPlanes.emplace_back(settings.normal, settings.distance);
+			mPlaneOwners.push_back(object_index);
 			object.collider_component_index = mPlanes.size() - 1;
 			break;
 		default:
@@ -93,15 +143,221 @@ namespace physics {
 		object.movemevent_component_index = -1;
 		if (movement_comp.has_value()) {
 			mMovementComponents.push_back(movement_comp.value());
+			mMovementOwners.push_back(object_index);
 			object.movemevent_component_index = mMovementComponents.size() - 1;
 		}
 		object.rigidbody_component_index = -1;
 		if (rb.has_value()) {
 			mRigidBodies.push_back(rb.value());
+			mRigidBodyOwners.push_back(object_index);
+			mAngularVelocities.push_back({0, 0, 0});
+			mInverseInertia.push_back(
+				body_inverse_inertia(type, settings, rb->inverse_mass));
 			object.rigidbody_component_index = mRigidBodies.size() - 1;
 		}
 		mPhysicsObjects.push_back(object);
-		return mPhysicsObjects.size() - 1;
+		mStructureVersion = ++structure_versions;
+		u32 slot = mSlotIndices.size();
+		if (!mFreeSlots.empty()) {
+			if (bSweepStale) {
+				mSweepAndPrune.remove_stale(mSlotIndices);
+				bSweepStale = false;
+			}
+			slot = mFreeSlots.back();
+			mFreeSlots.pop_back();
+			mSlotIndices[slot] = object_index;
+		} else {
+			mSlotIndices.push_back(object_index);
+			mSlotGenerations.push_back(0);
+		}
+		mObjectSlots.push_back(slot);
+		mBounds.push_back({});
+		mTreeProxies.push_back(NULL_NODE);
+		mSleepTimes.push_back(0.f);
+		if (type == ColliderType::Sphere || type == ColliderType::AABB) {
+			mBounds.back() = type == ColliderType::Sphere
+				? mSpheres[object.collider_component_index].bounds()
+				: mAABBs[object.collider_component_index].bounds();
+			mTreeProxies.back() =
+				mTree.create_proxy(mBounds.back(), object_index);
+			if (mBroadphaseType == BroadphaseType::SweepAndPrune) {
+				// keyed by slot so removal doesn't have to find the proxy
+				mSweepAndPrune.add(slot);
+			}
+		}
+		return {slot, mSlotGenerations[slot]};
+	}
+
+	void Engine::add_physics_objects(
+		const ArrayList<PhysicsObjectSettings>& objects,
+		ArrayList<PhysicsHandle>& handles) {
+		u32 spheres = 0;
+		u32 aabbs = 0;
+		u32 movements = 0;
+		u32 rigidbodies = 0;
+		for (const auto& object : objects) {
+			spheres += object.type == ColliderType::Sphere;
+			aabbs += object.type == ColliderType::AABB;
+			movements += object.movement_comp.has_value();
+			rigidbodies += object.rb.has_value();
+		}
+		const u32 count = mPhysicsObjects.size() + objects.size();
+		mPhysicsObjects.reserve(count);
+		mObjectSlots.reserve(count);
+		mBounds.reserve(count);
+		mTreeProxies.reserve(count);
+		mSleepTimes.reserve(count);
+		mSpheres.reserve(mSpheres.size() + spheres);
+		mSphereOwners.reserve(mSpheres.size() + spheres);
+		mSphereBatch.reserve(mSpheres.size() + spheres);
+		mAABBs.reserve(mAABBs.size() + aabbs);
+		mAABBOwners.reserve(mAABBs.size() + aabbs);
+		mMovementComponents.reserve(mMovementComponents.size() + movements);
+		mMovementOwners.reserve(mMovementComponents.size() + movements);
+		mRigidBodies.reserve(mRigidBodies.size() + rigidbodies);
+		mRigidBodyOwners.reserve(mRigidBodies.size() + rigidbodies);
+		mAngularVelocities.reserve(mRigidBodies.size() + rigidbodies);
+		mInverseInertia.reserve(mRigidBodies.size() + rigidbodies);
+		handles.reserve(handles.size() + objects.size());
+		for (const auto& object : objects) {
+			handles.push_back(add_physics_object(
+				object.transform_index, object.type, object.settings,
+				object.movement_comp, object.rb));
+		}
+	}
+
+	template <typename T>
+	void Engine::remove_component(ArrayList<T>& components,
+								  ArrayList<u32>& owners, u32 index,
+								  s32 PhysicsObject::*component_index) {
+		const u32 last = components.size() - 1;
+		if (index != last) {
+			components[index] = std::move(components[last]);
+			owners[index] = owners[last];
+			mPhysicsObjects[owners[index]].*component_index = index;
+		}
+		components.pop_back();
+		owners.pop_back();
+	}
+
+	bool Engine::remove_physics_object(PhysicsHandle handle) {
+		if (!valid(handle)) {
+			return false;
+		}
+		const u32 object_index = mSlotIndices[handle.slot];
+		const PhysicsObject object = mPhysicsObjects[object_index];
+		mStructureVersion = ++structure_versions;
+		// whatever rested on the object would otherwise sleep in mid air
+		if (mTreeProxies[object_index] != NULL_NODE) {
+			mTree.query(mTree.fat_bounds(mTreeProxies[object_index]),
+						[&](u32 other) {
+							wake(other);
+							return true;
+						});
+		} else if (object.collider_type == ColliderType::Plane) {
+			const PlaneCollider& plane =
+				mPlanes[object.collider_component_index];
+			for (u32 i = 0; i < mPhysicsObjects.size(); ++i) {
+				if (mTreeProxies[i] != NULL_NODE &&
+					plane_overlaps(plane, mBounds[i])) {
+					wake(i);
+				}
+			}
+		}
+		switch (object.collider_type) {
+		case ColliderType::Sphere:
+			mSphereBatch.remove(object.collider_component_index);
+			remove_component(mSpheres, mSphereOwners,
+							 object.collider_component_index,
+							 &PhysicsObject::collider_component_index);
+			break;
+		case ColliderType::AABB:
+			remove_component(mAABBs, mAABBOwners,
+							 object.collider_component_index,
+							 &PhysicsObject::collider_component_index);
+			break;
+		case ColliderType::Plane:
+			remove_component(mPlanes, mPlaneOwners,
+							 object.collider_component_index,
+							 &PhysicsObject::collider_component_index);
+			break;
+		default:
+			break;
+		}
+		if (object.movemevent_component_index >= 0) {
+			remove_component(mMovementComponents, mMovementOwners,
+							 object.movemevent_component_index,
+							 &PhysicsObject::movemevent_component_index);
+		}
+		if (object.rigidbody_component_index >= 0) {
+			const u32 index = object.rigidbody_component_index;
+			mAngularVelocities[index] = mAngularVelocities.back();
+			mInverseInertia[index] = mInverseInertia.back();
+			mAngularVelocities.pop_back();
+			mInverseInertia.pop_back();
+			remove_component(mRigidBodies, mRigidBodyOwners,
+							 object.rigidbody_component_index,
+							 &PhysicsObject::rigidbody_component_index);
+		}
+		if (mTreeProxies[object_index] != NULL_NODE) {
+			mTree.destroy_proxy(mTreeProxies[object_index]);
+			bSweepStale |= mBroadphaseType == BroadphaseType::SweepAndPrune;
+		}
+		const u32 last = mPhysicsObjects.size() - 1;
+		if (object_index != last) {
+			move_object(last, object_index);
+		}
+		mPhysicsObjects.pop_back();
+		mObjectSlots.pop_back();
+		mBounds.pop_back();
+		mTreeProxies.pop_back();
+		mSleepTimes.pop_back();
+		// the sweep drops the proxy on its next update
+		mSlotIndices[handle.slot] = INVALID_INDEX;
+		// a reused slot must not warm start from the old pair
+		std::erase_if(mContactCache, [&](const CachedImpulse& cached) {
+			return cached.key >> 32 == handle.slot ||
+				(cached.key & 0xffffffffu) == handle.slot;
+		});
+		++mSlotGenerations[handle.slot];
+		mFreeSlots.push_back(handle.slot);
+		// per step results hold object indices that may have moved
+		mPairs.clear();
+		mCollisions.clear();
+		mConstraints.clear();
+		return true;
+	}
+
+	void Engine::move_object(u32 from, u32 to) {
+		const PhysicsObject& object = mPhysicsObjects[from];
+		switch (object.collider_type) {
+		case ColliderType::Sphere:
+			mSphereOwners[object.collider_component_index] = to;
+			break;
+		case ColliderType::AABB:
+			mAABBOwners[object.collider_component_index] = to;
+			break;
+		case ColliderType::Plane:
+			mPlaneOwners[object.collider_component_index] = to;
+			break;
+		default:
+			break;
+		}
+		if (object.movemevent_component_index >= 0) {
+			mMovementOwners[object.movemevent_component_index] = to;
+		}
+		if (object.rigidbody_component_index >= 0) {
+			mRigidBodyOwners[object.rigidbody_component_index] = to;
+		}
+		if (mTreeProxies[from] != NULL_NODE) {
+			mTree.object_index(mTreeProxies[from], to);
+		}
+		mSlotIndices[mObjectSlots[from]] = to;
+		mPhysicsObjects[to] = object;
+		mObjectSlots[to] = mObjectSlots[from];
+		mBounds[to] = mBounds[from];
+		mTreeProxies[to] = mTreeProxies[from];
+		mSleepTimes[to] = mSleepTimes[from];
 	}
 
 	// TODO: this is supposed to be pretty complicated alas
@@ -110,8 +366,104 @@ namespace physics {
 	}
 
 	void Engine::simulate(f32 delta_time) {
-		for (auto& po : mPhysicsObjects) {
-			if (po.movemevent_component_index == -1)
+		mCoreEngine->thread_pool().parallel_for(
+			mPhysicsObjects.size(), INTEGRATION_CHUNK_SIZE,
+			[&](u32, u32 begin, u32 end) {
+				integrate(begin, end, delta_time);
+			});
+		mCoreEngine->thread_pool().parallel_for(
+			mRigidBodies.size(), INTEGRATION_CHUNK_SIZE,
+			[&](u32, u32 begin, u32 end) {
+				integrate_rotations(begin, end, delta_time);
+			});
+		sweep_bullets(delta_time);
+		broadphase(delta_time);
+		narrowphase();
+		resolve_contacts();
+		update_islands(delta_time);
+	}
+
+	glm::vec3 Engine::angular_velocity(u32 object_index) const {
+		const s32 rb = mPhysicsObjects[object_index].rigidbody_component_index;
+		return rb >= 0 ? mAngularVelocities[rb] : glm::vec3{0, 0, 0};
+	}
+
+	void Engine::angular_velocity(u32 object_index,
+								  const glm::vec3& velocity) {
+		const s32 rb = mPhysicsObjects[object_index].rigidbody_component_index;
+		// shapes without inertia don't rotate, see body_inverse_inertia
+		if (rb >= 0 && mInverseInertia[rb] != glm::vec3{0, 0, 0}) {
+			mAngularVelocities[rb] = velocity;
+			wake(object_index);
+		}
+	}
+
+	void Engine::wake(u32 object_index) {
+		mPhysicsObjects[object_index].sleeping = false;
+		mSleepTimes[object_index] = 0.f;
+	}
+
+	void Engine::update_islands(f32 delta_time) {
+		const auto dynamic = [this](u32 object_index) {
+			return mPhysicsObjects[object_index].movemevent_component_index >=
+				0;
+		};
+		mIslands.reset(mPhysicsObjects.size());
+		for (const auto& contact : mCollisions) {
+			const u32 a = contact.objects[0];
+			const u32 b = contact.objects[1];
+			// static objects would join everything resting on them
+			if (dynamic(a) && dynamic(b)) {
+				mIslands.merge(a, b);
+			}
+		}
+		mIslandSleepTimes.assign(mPhysicsObjects.size(), MAX_F32);
+		for (u32 i = 0; i < mPhysicsObjects.size(); ++i) {
+			if (!dynamic(i)) {
+				continue;
+			}
+			// sleeping bodies keep their time, so an island of sleepers
+			// stays asleep until an awake body joins it
+			if (!mPhysicsObjects[i].sleeping) {
+				const glm::vec3& velocity =
+					mMovementComponents[mPhysicsObjects[i]
+											.movemevent_component_index]
+						.velocity;
+				const glm::vec3 spin = angular_velocity(i);
+				const f32 speed_squared = std::max(glm::dot(velocity, velocity),
+												   glm::dot(spin, spin));
+				mSleepTimes[i] = speed_squared < SLEEP_VELOCITY * SLEEP_VELOCITY
+					? mSleepTimes[i] + delta_time
+					: 0.f;
+			}
+			f32& island_time = mIslandSleepTimes[mIslands.find(i)];
+			island_time = std::min(island_time, mSleepTimes[i]);
+		}
+		for (u32 i = 0; i < mPhysicsObjects.size(); ++i) {
+			if (!dynamic(i)) {
+				continue;
+			}
+			PhysicsObject& po = mPhysicsObjects[i];
+			const bool rest =
+				mIslandSleepTimes[mIslands.find(i)] >= TIME_TO_SLEEP;
+			if (rest && !po.sleeping) {
+				po.sleeping = true;
+				mMovementComponents[po.movemevent_component_index].velocity = {
+					0, 0, 0};
+				if (po.rigidbody_component_index >= 0) {
+					mAngularVelocities[po.rigidbody_component_index] = {0, 0,
+																		0};
+				}
+			} else if (!rest && po.sleeping) {
+				wake(i);
+			}
+		}
+	}
+
+	void Engine::integrate(u32 begin, u32 end, f32 delta_time) {
+		for (u32 i = begin; i < end; ++i) {
+			const PhysicsObject& po = mPhysicsObjects[i];
+			if (po.movemevent_component_index == -1 || po.sleeping)
 				continue;
 			if (po.movemevent_component_index >= mMovementComponents.size()) {
 				core::Logger::Error(
@@ -129,7 +481,8 @@ namespace physics {
 					po.transform_index, mCoreEngine->transforms().size());
 				continue;
 			}
-			auto& transform = mCoreEngine->transforms()[po.transform_index];
+			gameplay::Transform transform =
+				mCoreEngine->transforms()[po.transform_index];
 			auto& movement = mMovementComponents[po.movemevent_component_index];
 			f32 damping = 1;
 			if (po.rigidbody_component_index >= 0) {
@@ -146,183 +499,216 @@ namespace physics {
 			position += movement.velocity * delta_time;
 			transform.position(position);
 		}
-		// TODO: collision detection
-		{}
-		mMaxIterations = mCollisions.size() * 2;
-		resolve_contacts(delta_time);
 	}
 
-	void Engine::handle_collisions() {}
-
-	f32 Engine::calculate_separating_velocity(const CollisionContact& contact) {
-		glm::vec3 relative_velocity{0};
-		if (contact.objects[0] &&
-			contact.objects[0]->movemevent_component_index >= 0) {
-			relative_velocity =
-				mMovementComponents[contact.objects[0]
-										->movemevent_component_index]
-					.velocity;
-		}
-		if (contact.objects[1] &&
-			contact.objects[1]->movemevent_component_index >= 0) {
-			relative_velocity -=
-				mMovementComponents[contact.objects[1]
-										->movemevent_component_index]
-					.velocity;
-		}
-		return glm::dot(relative_velocity, contact.contact_normal);
+	void Engine::integrate_rotations(u32 begin, u32 end, f32 delta_time) {
+		for (u32 i = begin; i < end; ++i) {
+			glm::vec3& velocity = mAngularVelocities[i];
+			// most bodies never spin, skip their transform entirely
+			if (velocity == glm::vec3{0, 0, 0}) {
+				continue;
+			}
+			const PhysicsObject& po = mPhysicsObjects[mRigidBodyOwners[i]];
+			if (po.sleeping || po.transform_index < 0) {
+				continue;
+			}
+			velocity *= std::pow(mRigidBodies[i].damping, delta_time);
+			gameplay::Transform transform =
+				mCoreEngine->transforms()[po.transform_index];
+			const glm::quat& rotation = transform.rotation();
+			// dq/dt = 0.5 * w * q with w as a pure quaternion
+			const glm::quat spin =
+				glm::quat{0, velocity.x, velocity.y, velocity.z} * rotation;
+			transform.rotation(
+				glm::normalize(rotation + spin * (0.5f * delta_time)));
+		}
 	}
 
-	void Engine::resolve_velocity(f32 duration) {
-		for (const auto& contact : mCollisions) {
-			f32 separating_velocity = calculate_separating_velocity(contact);
-			// contact either separating or stationary, so no impulse required
-			if (separating_velocity > 0) {
-				return;
+	void Engine::update_bounds(f32 delta_time) {
+		for (u32 i = 0; i < mPhysicsObjects.size(); ++i) {
+			const PhysicsObject& po = mPhysicsObjects[i];
+			// sleeping bodies don't move, their bounds are still valid
+			if (po.sleeping) {
+				continue;
 			}
-			f32 new_sep_velocity = -separating_velocity * contact.restitution;
-			// get velocity buildup due to acceleration only and remove it from
-			// separating velocity
-			{
-				glm::vec3 acceleration_caused_velocity{0};
-				if (contact.objects[0] &&
-					contact.objects[0]->movemevent_component_index >= 0) {
-					acceleration_caused_velocity +=
-						mMovementComponents[contact.objects[0]
-												->movemevent_component_index]
-							.acceleration;
-				}
-				if (contact.objects[1] &&
-					contact.objects[1]->movemevent_component_index >= 0) {
-					acceleration_caused_velocity -=
-						mMovementComponents[contact.objects[1]
-												->movemevent_component_index]
-							.acceleration;
-				}
-				f32 acceleration_caused_separation_velocity =
-					glm::dot(acceleration_caused_velocity,
-							 contact.contact_normal) *
-					duration;
-				if (acceleration_caused_separation_velocity < 0) {
-					new_sep_velocity += contact.restitution *
-						acceleration_caused_separation_velocity;
-					if (new_sep_velocity < 0) {
-						new_sep_velocity = 0;
+			switch (po.collider_type) {
+			case ColliderType::Sphere: {
+				const SphereCollider& sphere =
+					mSpheres[po.collider_component_index];
+				mSphereBatch.set(po.collider_component_index, sphere.center());
+				mBounds[i] = sphere.bounds();
+			} break;
+			case ColliderType::AABB:
+				mBounds[i] = mAABBs[po.collider_component_index].bounds();
+				break;
+			default:
+				continue;
+			}
+			glm::vec3 displacement{0, 0, 0};
+			if (po.movemevent_component_index >= 0) {
+				displacement =
+					mMovementComponents[po.movemevent_component_index]
+						.velocity *
+					delta_time;
+			}
+			mTree.move_proxy(mTreeProxies[i], mBounds[i], displacement);
+		}
+	}
+
+	void Engine::broadphase(f32 delta_time) {
+		update_bounds(delta_time);
+		mPairs.clear();
+		const auto awake = [this](u32 object_index) {
+			const PhysicsObject& po = mPhysicsObjects[object_index];
+			return po.movemevent_component_index >= 0 && !po.sleeping;
+		};
+		// static or sleeping objects never need resolving against each other
+		const auto add_awake_pairs =
+			[&](const ArrayList<BroadphasePair>& pairs) {
+				for (const auto& pair : pairs) {
+					if (awake(pair.first) || awake(pair.second)) {
+						mPairs.push_back(pair);
 					}
 				}
+			};
+		if (mBroadphaseType == BroadphaseType::SweepAndPrune) {
+			mSweepAndPrune.update(mBounds, mSlotIndices);
+			bSweepStale = false;
+			add_awake_pairs(mSweepAndPrune.pairs());
+		} else if (mBroadphaseType == BroadphaseType::SpatialHash) {
+			// the grid is rebuilt from scratch, so it takes every bounded
+			// object rather than keeping proxies
+			mGridObjects.clear();
+			for (u32 i = 0; i < mPhysicsObjects.size(); ++i) {
+				if (mTreeProxies[i] != NULL_NODE) {
+					mGridObjects.push_back(i);
+				}
 			}
-			f32 delta_vel = new_sep_velocity - separating_velocity;
-			f32 total_inverse_mass = 0;
-			if (contact.objects[0] &&
-				contact.objects[0]->rigidbody_component_index >= 0) {
-				total_inverse_mass +=
-					mRigidBodies[contact.objects[0]->rigidbody_component_index]
-						.inverse_mass;
-			}
-			if (contact.objects[1] &&
-				contact.objects[1]->rigidbody_component_index >= 0) {
-				total_inverse_mass +=
-					mRigidBodies[contact.objects[1]->rigidbody_component_index]
-						.inverse_mass;
+			mSpatialHash.update(mBounds, mGridObjects);
+			add_awake_pairs(mSpatialHash.pairs());
+		} else {
+			// only awake leaves query the tree, a pair of two awake
+			// objects is reported by the lower index only
+			for (u32 i = 0; i < mPhysicsObjects.size(); ++i) {
+				if (mTreeProxies[i] == NULL_NODE || !awake(i)) {
+					continue;
+				}
+				const BoundingBox& fat = mTree.fat_bounds(mTreeProxies[i]);
+				mTree.query(fat, [&](u32 other) {
+					if (other == i || (awake(other) && other < i)) {
+						return true;
+					}
+					mPairs.push_back({std::min(i, other), std::max(i, other)});
+					return true;
+				});
 			}
-			if (total_inverse_mass <= 0) {
-				return;
+			std::sort(mPairs.begin(), mPairs.end(),
+					  [](const BroadphasePair& a, const BroadphasePair& b) {
+						  return a.first < b.first ||
+							  (a.first == b.first && a.second < b.second);
+					  });
+		}
+		// planes are unbounded and few, so they skip the sweep and get tested
+		// against every awake box
+		for (u32 p : mPlaneOwners) {
+			const PlaneCollider& plane =
+				mPlanes[mPhysicsObjects[p].collider_component_index];
+			for (u32 i = 0; i < mPhysicsObjects.size(); ++i) {
+				const PhysicsObject& po = mPhysicsObjects[i];
+				if (!awake(i) ||
+					(po.collider_type != ColliderType::Sphere &&
+					 po.collider_type != ColliderType::AABB)) {
+					continue;
+				}
+				if (plane_overlaps(plane, mBounds[i])) {
+					mPairs.push_back({std::min(i, p), std::max(i, p)});
+				}
 			}
-			f32 impulse = delta_vel / total_inverse_mass;
-			glm::vec3 impulse_per_mass = contact.contact_normal * impulse;
-			// apply impulses
-			if (contact.objects[0] &&
-				contact.objects[0]->movemevent_component_index >= 0 &&
-				contact.objects[0]->rigidbody_component_index >= 0) {
-				const auto& inv_mass =
-					mRigidBodies[contact.objects[0]->rigidbody_component_index]
-						.inverse_mass;
-				mMovementComponents[contact.objects[0]
-										->movemevent_component_index]
-					.velocity += impulse_per_mass * inv_mass;
+		}
+	}
+
+	bool Engine::raycast(const Ray& ray, RaycastHit& hit) const {
+		bool found = false;
+		hit.distance = ray.max_distance;
+		mTree.raycast(ray, [&](u32 object_index, f32 max_distance) {
+			const PhysicsObject& po = mPhysicsObjects[object_index];
+			RaycastHit candidate{object_index};
+			Ray clipped{ray.origin, ray.direction, max_distance};
+			const bool is_hit = po.collider_type == ColliderType::Sphere
+				? mSpheres[po.collider_component_index].raycast(clipped,
+																candidate)
+				: mAABBs[po.collider_component_index].raycast(clipped,
+															  candidate);
+			if (!is_hit) {
+				return max_distance;
 			}
-			if (contact.objects[1] &&
-				contact.objects[1]->movemevent_component_index >= 0 &&
-				contact.objects[1]->rigidbody_component_index >= 0) {
-				const auto& inv_mass =
-					mRigidBodies[contact.objects[1]->rigidbody_component_index]
-						.inverse_mass;
-				mMovementComponents[contact.objects[1]
-										->movemevent_component_index]
-					.velocity += impulse_per_mass * -inv_mass;
+			found = true;
+			hit = candidate;
+			return candidate.distance;
+		});
+		for (u32 i : mPlaneOwners) {
+			RaycastHit candidate{i};
+			Ray clipped{ray.origin, ray.direction, hit.distance};
+			if (mPlanes[mPhysicsObjects[i].collider_component_index].raycast(
+					clipped, candidate)) {
+				found = true;
+				hit = candidate;
 			}
 		}
+		return found;
 	}
-	void Engine::resolve_interpenetration(f32 duration) {
-		for (const auto& contact : mCollisions) {
-			if (contact.distance <= 0)
-				return;
-			f32 total_inverse_mass = 0;
-			if (contact.objects[0] &&
-				contact.objects[0]->rigidbody_component_index >= 0) {
-				total_inverse_mass +=
-					mRigidBodies[contact.objects[0]->rigidbody_component_index]
-						.inverse_mass;
-			}
-			if (contact.objects[1] &&
-				contact.objects[1]->rigidbody_component_index >= 0) {
-				total_inverse_mass +=
-					mRigidBodies[contact.objects[1]->rigidbody_component_index]
-						.inverse_mass;
+
+	void Engine::overlap_sphere(const glm::vec3& center, f32 radius,
+								ArrayList<u32>& out) const {
+		const u32 first = out.size();
+		mTree.overlap_sphere(center, radius, out);
+		// refine the fat leaf bounds against the actual shapes
+		u32 count = first;
+		for (u32 i = first; i < out.size(); ++i) {
+			const PhysicsObject& po = mPhysicsObjects[out[i]];
+			bool overlaps = false;
+			if (po.collider_type == ColliderType::Sphere) {
+				const SphereCollider& sphere =
+					mSpheres[po.collider_component_index];
+				overlaps = glm::distance(sphere.center(), center) <=
+					sphere.radius() + radius;
+			} else {
+				const BoundingBox& box = mBounds[out[i]];
+				const glm::vec3 delta =
+					glm::clamp(center, box.min, box.max) - center;
+				overlaps = glm::dot(delta, delta) <= radius * radius;
 			}
-			if (total_inverse_mass <= 0)
-				return;
-			glm::vec3 move_per_inverse_mass = contact.contact_normal *
-				(contact.distance / total_inverse_mass);
-			if (contact.objects[0] &&
-				contact.objects[0]->transform_index >= 0 &&
-				contact.objects[0]->rigidbody_component_index >= 0) {
-				glm::vec3 particle_movement = move_per_inverse_mass *
-					mRigidBodies[contact.objects[0]->rigidbody_component_index]
-						.inverse_mass;
-				auto& transform =
-					mCoreEngine
-						->transforms()[contact.objects[0]->transform_index];
-				transform.position(transform.position() + particle_movement[0]);
+			if (overlaps) {
+				out[count++] = out[i];
 			}
-			if (contact.objects[1] &&
-				contact.objects[1]->transform_index >= 0 &&
-				contact.objects[1]->rigidbody_component_index >= 0) {
-				glm::vec3 particle_movement = move_per_inverse_mass *
-					mRigidBodies[contact.objects[1]->rigidbody_component_index]
-						.inverse_mass;
-				auto& transform =
-					mCoreEngine
-						->transforms()[contact.objects[1]->transform_index];
-				transform.position(transform.position() + particle_movement[1]);
+		}
+		out.resize(count);
+		// planes are unbounded and stay out of the tree
+		for (u32 i : mPlaneOwners) {
+			const PlaneCollider& plane =
+				mPlanes[mPhysicsObjects[i].collider_component_index];
+			if (std::fabs(glm::dot(center, plane.normal()) -
+						  plane.distance()) <= radius) {
+				out.push_back(i);
 			}
 		}
 	}
 
-	// All this iterations business is to resolve the case where resolution of
-	// one contact may produce or automatically reduce existing contacts
-	void Engine::resolve_contacts(f32 duration) {
-		u32 iterations_used{0};
-		while (iterations_used < mMaxIterations) {
-			f32 max_velocity = MAX_F32;
-			u32 max_index = mCollisions.size();
-			for (int i = 0; i < mCollisions.size(); ++i) {
-				const CollisionContact& contact = mCollisions[i];
-				f32 separation_velocity =
-					calculate_separating_velocity(contact);
-				if (separation_velocity < max_velocity &&
-					(separation_velocity < 0 || contact.distance > 0)) {
-					max_velocity = separation_velocity;
-					max_index = i;
-				}
+	void Engine::overlap_aabb(const BoundingBox& bounds,
+							  ArrayList<u32>& out) const {
+		mTree.query(bounds, [&](u32 object_index) {
+			if (mBounds[object_index].overlaps(bounds)) {
+				out.push_back(object_index);
 			}
-			// Nothing to resolve
-			if (max_index == mCollisions.size()) {
-				break;
+			return true;
+		});
+		for (u32 i : mPlaneOwners) {
+			const PhysicsObject& po = mPhysicsObjects[i];
+			if (plane_overlaps(mPlanes[po.collider_component_index], bounds)) {
+				out.push_back(i);
 			}
-			resolve_velocity(duration);
-			resolve_interpenetration(duration);
-			iterations_used++;
 		}
 	}
+
+	void Engine::handle_collisions() {}
 } // namespace physics
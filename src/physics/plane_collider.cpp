@@ -15,4 +15,19 @@ namespace physics {
 		f32 distance_from_sphere = distance_from_center - sphere.radius();
 		return IntersectData(distance_from_sphere < 0, distance_from_sphere);
 	}
+
+	bool PlaneCollider::raycast(const Ray& ray, RaycastHit& hit) const {
+		const f32 denominator = glm::dot(mNormal, ray.direction);
+		if (std::fabs(denominator) < 1e-6f) {
+			return false;
+		}
+		const f32 t =
+			(mDistance - glm::dot(mNormal, ray.origin)) / denominator;
+		if (t < 0.f || t > ray.max_distance) {
+			return false;
+		}
+		hit.distance = t;
+		hit.normal = denominator < 0.f ? mNormal : -mNormal;
+		return true;
+	}
 } // namespace physics
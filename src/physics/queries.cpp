@@ -0,0 +1,122 @@
+#include "physics/physics_engine.h"
+#include <cmath>
+#include <glm/geometric.hpp>
+#include "core/sapfire_engine.h"
+
+namespace physics {
+	// two sided plane pushed towards the ray origin by radius, a sphere
+	// starting closer than radius hits right away
+	static bool sweep_plane(const PlaneCollider& plane, f32 radius,
+							const Ray& ray, RaycastHit& hit) {
+		const f32 side = glm::dot(plane.normal(), ray.origin) -
+			plane.distance();
+		const glm::vec3 normal = side < 0.f ? -plane.normal() : plane.normal();
+		if (std::fabs(side) <= radius) {
+			hit.distance = 0.f;
+			hit.normal = normal;
+			return true;
+		}
+		const f32 approach = -glm::dot(normal, ray.direction);
+		if (approach < 1e-6f) {
+			return false;
+		}
+		const f32 t = (std::fabs(side) - radius) / approach;
+		if (t > ray.max_distance) {
+			return false;
+		}
+		hit.distance = t;
+		hit.normal = normal;
+		return true;
+	}
+
+	bool Engine::spherecast(const Ray& ray, f32 radius,
+							RaycastHit& hit) const {
+		cast_packet(&ray, 1, radius, &hit);
+		return hit.object_index != NO_HIT;
+	}
+
+	u32 Engine::raycast_batch(std::span<const Ray> rays,
+							  std::span<RaycastHit> hits) const {
+		return cast_batch(rays, 0.f, hits);
+	}
+
+	u32 Engine::spherecast_batch(std::span<const Ray> rays, f32 radius,
+								 std::span<RaycastHit> hits) const {
+		return cast_batch(rays, radius, hits);
+	}
+
+	u32 Engine::cast_batch(std::span<const Ray> rays, f32 radius,
+						   std::span<RaycastHit> hits) const {
+		// a short hits span casts only the rays it has room for
+		rays = rays.first(std::min(rays.size(), hits.size()));
+		static_assert(QUERY_CHUNK_SIZE % DynamicTree::PACKET_SIZE == 0);
+		// rays next to each other in the batch share a packet, callers get
+		// the most out of it by keeping coherent rays together
+		mCoreEngine->thread_pool().parallel_for(
+			rays.size(), QUERY_CHUNK_SIZE, [&](u32, u32 begin, u32 end) {
+				for (u32 i = begin; i < end; i += DynamicTree::PACKET_SIZE) {
+					const u32 count =
+						std::min(end - i, DynamicTree::PACKET_SIZE);
+					cast_packet(&rays[i], count, radius, &hits[i]);
+				}
+			});
+		u32 hit_count = 0;
+		for (u32 i = 0; i < rays.size(); ++i) {
+			hit_count += hits[i].object_index != NO_HIT;
+		}
+		return hit_count;
+	}
+
+	void Engine::cast_packet(const Ray* rays, u32 count, f32 radius,
+							 RaycastHit* hits) const {
+		for (u32 i = 0; i < count; ++i) {
+			hits[i] = {NO_HIT, rays[i].max_distance};
+		}
+		mTree.raycast_packet(
+			rays, count, radius,
+			[&](u32 lane, u32 object_index, f32 max_distance) {
+				const Ray& ray = rays[lane];
+				RaycastHit candidate{object_index};
+				if (!cast({ray.origin, ray.direction, max_distance}, radius,
+						  object_index, candidate)) {
+					return max_distance;
+				}
+				hits[lane] = candidate;
+				return candidate.distance;
+			});
+		// planes are unbounded and stay out of the tree
+		for (u32 object_index : mPlaneOwners) {
+			for (u32 i = 0; i < count; ++i) {
+				RaycastHit candidate{object_index};
+				const Ray clipped{rays[i].origin, rays[i].direction,
+								  hits[i].distance};
+				if (cast(clipped, radius, object_index, candidate)) {
+					hits[i] = candidate;
+				}
+			}
+		}
+	}
+
+	bool Engine::cast(const Ray& ray, f32 radius, u32 object_index,
+					  RaycastHit& hit) const {
+		const PhysicsObject& po = mPhysicsObjects[object_index];
+		const u32 component = po.collider_component_index;
+		switch (po.collider_type) {
+		case ColliderType::Sphere: {
+			const SphereCollider& sphere = mSpheres[component];
+			return raycast_sphere(sphere.center(), sphere.radius() + radius,
+								  ray, hit);
+		}
+		case ColliderType::AABB: {
+			const BoundingBox box = mAABBs[component].bounds();
+			return raycast_box({box.min - radius, box.max + radius}, ray, hit);
+		}
+		case ColliderType::Plane:
+			return radius == 0.f
+				? mPlanes[component].raycast(ray, hit)
+				: sweep_plane(mPlanes[component], radius, ray, hit);
+		default:
+			return false;
+		}
+	}
+} // namespace physics
@@ -0,0 +1,393 @@
+#include "physics/physics_engine.h"
+#include <cstring>
+#include <type_traits>
+#include "core/sapfire_engine.h"
+
+namespace physics {
+	constexpr u32 SNAPSHOT_MAGIC = 0x53504847; // "GHPS"
+	// bump whenever the layout below changes
+	constexpr u32 SNAPSHOT_VERSION = 1;
+
+	struct SnapshotHeader {
+		u32 magic;
+		u32 version;
+		u64 structure_version;
+	};
+
+	// colliders hold a pointer to the transform list, only their shape is
+	// stored and the rest is rebuilt from the owning object
+	struct SphereState {
+		f32 radius;
+	};
+
+	struct AABBState {
+		glm::vec3 size;
+	};
+
+	struct PlaneState {
+		glm::vec3 normal;
+		f32 distance;
+	};
+
+	struct TransformState {
+		glm::vec3 position;
+		glm::quat rotation;
+	};
+
+	template <typename T>
+	static void write(ArrayList<u8>& out, const T& value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		const u32 offset = out.size();
+		out.resize(offset + sizeof(T));
+		std::memcpy(out.data() + offset, &value, sizeof(T));
+	}
+
+	// count followed by the raw elements
+	template <typename T>
+	static void write(ArrayList<u8>& out, const T* data, u32 count) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		write(out, count);
+		const u32 offset = out.size();
+		out.resize(offset + count * sizeof(T));
+		if (count > 0) {
+			std::memcpy(out.data() + offset, data, count * sizeof(T));
+		}
+	}
+
+	template <typename T>
+	static void write(ArrayList<u8>& out, const ArrayList<T>& values) {
+		write(out, values.data(), values.size());
+	}
+
+	// count followed by element(i) for i in [0, count), sized up front
+	template <typename T, typename F>
+	static void write_each(ArrayList<u8>& out, u32 count, F&& element) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		write(out, count);
+		u32 offset = out.size();
+		out.resize(offset + count * sizeof(T));
+		for (u32 i = 0; i < count; ++i, offset += sizeof(T)) {
+			const T value = element(i);
+			std::memcpy(out.data() + offset, &value, sizeof(T));
+		}
+	}
+
+	// reads never go past the end, a short blob leaves offset past size
+	template <typename T>
+	static bool read(const ArrayList<u8>& in, u32& offset, T& value) {
+		if (offset + sizeof(T) > in.size()) {
+			offset = in.size() + 1;
+			return false;
+		}
+		std::memcpy(&value, in.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	template <typename T>
+	static bool read(const ArrayList<u8>& in, u32& offset,
+					 ArrayList<T>& values) {
+		u32 count = 0;
+		if (!read(in, offset, count) ||
+			offset + static_cast<u64>(count) * sizeof(T) > in.size()) {
+			offset = in.size() + 1;
+			return false;
+		}
+		values.resize(count);
+		if (count > 0) {
+			std::memcpy(values.data(), in.data() + offset, count * sizeof(T));
+		}
+		offset += count * sizeof(T);
+		return true;
+	}
+
+	// count elements at offset of a blob, read one at a time once the blob
+	// checked out instead of being copied out up front
+	template <typename T>
+	struct Section {
+		u32 offset;
+		u32 count;
+
+		inline u32 size() const { return count; }
+		inline T at(const ArrayList<u8>& in, u32 i) const {
+			T value;
+			std::memcpy(&value, in.data() + offset + i * sizeof(T), sizeof(T));
+			return value;
+		}
+	};
+
+	template <typename T>
+	static bool read(const ArrayList<u8>& in, u32& offset,
+					 Section<T>& section) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		u32 count = 0;
+		if (!read(in, offset, count) ||
+			offset + static_cast<u64>(count) * sizeof(T) > in.size()) {
+			offset = in.size() + 1;
+			return false;
+		}
+		section = {offset, count};
+		offset += count * sizeof(T);
+		return true;
+	}
+
+	void Engine::snapshot(ArrayList<u8>& out) const {
+		out.clear();
+		write(out, SnapshotHeader{SNAPSHOT_MAGIC, SNAPSHOT_VERSION,
+								  mStructureVersion});
+		write(out, mPhysicsObjects);
+		write(out, mMovementComponents);
+		write(out, mRigidBodies);
+		write(out, mAngularVelocities);
+		write(out, mInverseInertia);
+		write(out, mSphereOwners);
+		write(out, mAABBOwners);
+		write(out, mPlaneOwners);
+		write(out, mMovementOwners);
+		write(out, mRigidBodyOwners);
+		write(out, mSlotIndices);
+		write(out, mSlotGenerations);
+		write(out, mFreeSlots);
+		write(out, mObjectSlots);
+		write(out, mBounds);
+		write(out, mSleepTimes);
+		write(out, mContactCache);
+		write_each<SphereState>(out, mSpheres.size(), [&](u32 i) {
+			return SphereState{mSpheres[i].radius()};
+		});
+		write_each<AABBState>(out, mAABBs.size(), [&](u32 i) {
+			return AABBState{mAABBs[i].size()};
+		});
+		write_each<PlaneState>(out, mPlanes.size(), [&](u32 i) {
+			return PlaneState{mPlanes[i].normal(), mPlanes[i].distance()};
+		});
+		// one transform per physics object, left empty for planes
+		const auto& transforms = mCoreEngine->transforms();
+		write_each<TransformState>(
+			out, mPhysicsObjects.size(), [&](u32 i) {
+				const s32 index = mPhysicsObjects[i].transform_index;
+				if (index < 0) {
+					return TransformState{};
+				}
+				return TransformState{transforms[index].position(),
+									  transforms[index].rotation()};
+			});
+	}
+
+	// every index in indices is below size
+	static bool in_range(const ArrayList<u32>& indices, u64 size) {
+		for (u32 index : indices) {
+			if (index >= size) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// owners[i] is an object of type whose collider is component i
+	static bool owners_match(const ArrayList<u32>& owners,
+							 const ArrayList<PhysicsObject>& objects,
+							 ColliderType type) {
+		for (u32 i = 0; i < owners.size(); ++i) {
+			const PhysicsObject& po = objects[owners[i]];
+			if (po.collider_type != type ||
+				po.collider_component_index != static_cast<s32>(i)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Engine::restore(const ArrayList<u8>& snapshot) {
+		u32 offset = 0;
+		SnapshotHeader header{};
+		if (!read(snapshot, offset, header) ||
+			header.magic != SNAPSHOT_MAGIC ||
+			header.version != SNAPSHOT_VERSION) {
+			core::Logger::Error("Physics snapshot has an unknown layout");
+			return false;
+		}
+		// the whole blob is read and checked before anything is written, a
+		// bad one leaves the engine as it was
+		RestoreScratch& scratch = mRestoreScratch;
+		Section<SphereState> spheres{};
+		Section<AABBState> aabbs{};
+		Section<PlaneState> planes{};
+		Section<TransformState> states{};
+		read(snapshot, offset, scratch.objects);
+		read(snapshot, offset, scratch.movement_components);
+		read(snapshot, offset, scratch.rigid_bodies);
+		read(snapshot, offset, scratch.angular_velocities);
+		read(snapshot, offset, scratch.inverse_inertia);
+		read(snapshot, offset, scratch.sphere_owners);
+		read(snapshot, offset, scratch.aabb_owners);
+		read(snapshot, offset, scratch.plane_owners);
+		read(snapshot, offset, scratch.movement_owners);
+		read(snapshot, offset, scratch.rigid_body_owners);
+		read(snapshot, offset, scratch.slot_indices);
+		read(snapshot, offset, scratch.slot_generations);
+		read(snapshot, offset, scratch.free_slots);
+		read(snapshot, offset, scratch.object_slots);
+		read(snapshot, offset, scratch.bounds);
+		read(snapshot, offset, scratch.sleep_times);
+		read(snapshot, offset, scratch.contact_cache);
+		// the shapes are written as a count and elements like the arrays
+		read(snapshot, offset, spheres);
+		read(snapshot, offset, aabbs);
+		read(snapshot, offset, planes);
+		read(snapshot, offset, states);
+		if (offset != snapshot.size()) {
+			core::Logger::Error("Physics snapshot is truncated");
+			return false;
+		}
+		const u64 count = scratch.objects.size();
+		const u64 slot_count = scratch.slot_indices.size();
+		bool valid = scratch.object_slots.size() == count &&
+			scratch.bounds.size() == count &&
+			scratch.sleep_times.size() == count && states.size() == count &&
+			spheres.size() == scratch.sphere_owners.size() &&
+			aabbs.size() == scratch.aabb_owners.size() &&
+			planes.size() == scratch.plane_owners.size() &&
+			scratch.movement_owners.size() ==
+				scratch.movement_components.size() &&
+			scratch.rigid_body_owners.size() == scratch.rigid_bodies.size() &&
+			scratch.angular_velocities.size() == scratch.rigid_bodies.size() &&
+			scratch.inverse_inertia.size() == scratch.rigid_bodies.size() &&
+			scratch.slot_generations.size() == slot_count &&
+			in_range(scratch.sphere_owners, count) &&
+			in_range(scratch.aabb_owners, count) &&
+			in_range(scratch.plane_owners, count) &&
+			in_range(scratch.movement_owners, count) &&
+			in_range(scratch.rigid_body_owners, count) &&
+			in_range(scratch.object_slots, slot_count) &&
+			in_range(scratch.free_slots, slot_count);
+		const s64 transform_count = mCoreEngine->transforms().size();
+		for (u32 i = 0; valid && i < count; ++i) {
+			const PhysicsObject& po = scratch.objects[i];
+			const s64 collider = po.collider_component_index;
+			// shapes read their transform, the rest may have none
+			const bool shape = po.collider_type == ColliderType::Sphere ||
+				po.collider_type == ColliderType::AABB;
+			valid = po.transform_index < transform_count &&
+				(!shape || po.transform_index >= 0);
+			switch (po.collider_type) {
+			case ColliderType::Sphere:
+				valid = valid && collider >= 0 &&
+					collider < s64(spheres.size());
+				break;
+			case ColliderType::AABB:
+				valid = valid && collider >= 0 &&
+					collider < s64(aabbs.size());
+				break;
+			case ColliderType::Plane:
+				valid = valid && collider >= 0 &&
+					collider < s64(planes.size());
+				break;
+			default:
+				break;
+			}
+			valid = valid &&
+				po.movemevent_component_index <
+					s64(scratch.movement_components.size()) &&
+				po.rigidbody_component_index <
+					s64(scratch.rigid_bodies.size());
+		}
+		valid = valid &&
+			owners_match(scratch.sphere_owners, scratch.objects,
+						 ColliderType::Sphere) &&
+			owners_match(scratch.aabb_owners, scratch.objects,
+						 ColliderType::AABB) &&
+			owners_match(scratch.plane_owners, scratch.objects,
+						 ColliderType::Plane);
+		if (!valid) {
+			core::Logger::Error("Physics snapshot is inconsistent");
+			return false;
+		}
+		// the replaced state becomes the scratch of the next restore
+		mPhysicsObjects.swap(scratch.objects);
+		mMovementComponents.swap(scratch.movement_components);
+		mRigidBodies.swap(scratch.rigid_bodies);
+		mAngularVelocities.swap(scratch.angular_velocities);
+		mInverseInertia.swap(scratch.inverse_inertia);
+		mSphereOwners.swap(scratch.sphere_owners);
+		mAABBOwners.swap(scratch.aabb_owners);
+		mPlaneOwners.swap(scratch.plane_owners);
+		mMovementOwners.swap(scratch.movement_owners);
+		mRigidBodyOwners.swap(scratch.rigid_body_owners);
+		mSlotIndices.swap(scratch.slot_indices);
+		mSlotGenerations.swap(scratch.slot_generations);
+		mFreeSlots.swap(scratch.free_slots);
+		mObjectSlots.swap(scratch.object_slots);
+		mBounds.swap(scratch.bounds);
+		mSleepTimes.swap(scratch.sleep_times);
+		mContactCache.swap(scratch.contact_cache);
+		// colliders and proxies only change when objects are added or
+		// removed, so rolling back within the same structure skips them
+		const bool rebuild = header.structure_version != mStructureVersion;
+		if (rebuild) {
+			mSpheres.clear();
+			mSphereBatch.clear();
+			for (u32 i = 0; i < spheres.size(); ++i) {
+				mSpheres.emplace_back(
+					mCoreEngine->transforms(),
+					mPhysicsObjects[mSphereOwners[i]].transform_index,
+					spheres.at(snapshot, i).radius);
+				mSphereBatch.push({0, 0, 0}, spheres.at(snapshot, i).radius);
+			}
+			mAABBs.clear();
+			for (u32 i = 0; i < aabbs.size(); ++i) {
+				mAABBs.emplace_back(
+					mCoreEngine->transforms(),
+					mPhysicsObjects[mAABBOwners[i]].transform_index,
+					aabbs.at(snapshot, i).size);
+			}
+			mPlanes.clear();
+			for (u32 i = 0; i < planes.size(); ++i) {
+				const PlaneState plane = planes.at(snapshot, i);
+				mPlanes.emplace_back(plane.normal, plane.distance);
+			}
+		}
+		auto& transforms = mCoreEngine->transforms();
+		for (u32 i = 0; i < states.size(); ++i) {
+			const s32 index = mPhysicsObjects[i].transform_index;
+			if (index < 0 || static_cast<u64>(index) >= transforms.size()) {
+				continue;
+			}
+			const TransformState state = states.at(snapshot, i);
+			transforms.position(index, state.position);
+			transforms.rotation(index, state.rotation);
+		}
+		for (u32 i = 0; i < mSpheres.size(); ++i) {
+			mSphereBatch.set(i, mSpheres[i].center(), mSpheres[i].radius());
+		}
+		if (rebuild) {
+			mTree = DynamicTree{};
+			mSweepAndPrune = SweepAndPrune{};
+			bSweepStale = false;
+			mTreeProxies.assign(mPhysicsObjects.size(), NULL_NODE);
+			for (u32 i = 0; i < mPhysicsObjects.size(); ++i) {
+				const ColliderType type = mPhysicsObjects[i].collider_type;
+				if (type != ColliderType::Sphere &&
+					type != ColliderType::AABB) {
+					continue;
+				}
+				mTreeProxies[i] = mTree.create_proxy(mBounds[i], i);
+				if (mBroadphaseType == BroadphaseType::SweepAndPrune) {
+					mSweepAndPrune.add(mObjectSlots[i]);
+				}
+			}
+			mStructureVersion = header.structure_version;
+		} else {
+			for (u32 i = 0; i < mPhysicsObjects.size(); ++i) {
+				if (mTreeProxies[i] != NULL_NODE) {
+					mTree.move_proxy(mTreeProxies[i], mBounds[i], {0, 0, 0});
+				}
+			}
+		}
+		// per step results refer to the state that was rolled back
+		mPairs.clear();
+		mCollisions.clear();
+		mConstraints.clear();
+		return true;
+	}
+} // namespace physics
@@ -0,0 +1,214 @@
+#include "physics/physics_engine.h"
+#include <algorithm>
+#include "core/sapfire_engine.h"
+
+namespace physics {
+	// approach speeds below this don't bounce, so resting stacks settle
+	constexpr f32 RESTITUTION_VELOCITY = 1.f;
+	// penetration left alone so resting contacts persist between steps
+	constexpr f32 PENETRATION_SLOP = 0.005f;
+	// fraction of the remaining penetration removed per position pass
+	constexpr f32 POSITION_CORRECTION = 0.8f;
+	constexpr u32 POSITION_ITERATIONS = 3;
+
+	static inline u64 pair_key(u32 a, u32 b) {
+		return static_cast<u64>(std::min(a, b)) << 32 | std::max(a, b);
+	}
+
+	// world space inverse inertia of a body with the given body space
+	// diagonal applied to v
+	static inline glm::vec3 apply_inverse_inertia(const glm::quat& rotation,
+												  const glm::vec3& inertia,
+												  const glm::vec3& v) {
+		return rotation * (inertia * (glm::conjugate(rotation) * v));
+	}
+
+	void Engine::resolve_contacts() {
+		prepare_contacts();
+		for (u32 i = 0; i < mMaxIterations; ++i) {
+			solve_velocities();
+		}
+		store_impulses();
+		resolve_interpenetration();
+	}
+
+	void Engine::prepare_contacts() {
+		mConstraints.resize(mCollisions.size());
+		for (u32 i = 0; i < mCollisions.size(); ++i) {
+			const CollisionContact& contact = mCollisions[i];
+			ContactConstraint& constraint = mConstraints[i];
+			constraint.normal = contact.contact_normal;
+			f32 total_inverse_mass = 0.f;
+			for (u32 j = 0; j < 2; ++j) {
+				const PhysicsObject& po = mPhysicsObjects[contact.objects[j]];
+				constraint.movement[j] = po.movemevent_component_index;
+				constraint.inverse_mass[j] = 0.f;
+				constraint.rigidbody[j] = -1;
+				constraint.position[j] = po.transform_index >= 0
+					? mCoreEngine->transforms()[po.transform_index].position()
+					: glm::vec3{0, 0, 0};
+				constraint.offset[j] =
+					contact.contact_point - constraint.position[j];
+				constraint.angular_response[j] = {0, 0, 0};
+				if (po.movemevent_component_index >= 0 &&
+					po.rigidbody_component_index >= 0) {
+					constraint.inverse_mass[j] =
+						mRigidBodies[po.rigidbody_component_index]
+							.inverse_mass;
+					constraint.rigidbody[j] = po.rigidbody_component_index;
+					const glm::vec3 arm =
+						glm::cross(constraint.offset[j], constraint.normal);
+					constraint.angular_response[j] = apply_inverse_inertia(
+						mCoreEngine->transforms()[po.transform_index]
+							.rotation(),
+						mInverseInertia[po.rigidbody_component_index], arm);
+					total_inverse_mass +=
+						glm::dot(arm, constraint.angular_response[j]);
+				}
+				total_inverse_mass += constraint.inverse_mass[j];
+			}
+			constraint.normal_mass =
+				total_inverse_mass > 0.f ? 1.f / total_inverse_mass : 0.f;
+			const f32 approach =
+				glm::dot(contact_velocity(constraint, 0) -
+							 contact_velocity(constraint, 1),
+						 contact.contact_normal);
+			constraint.target_velocity = approach < -RESTITUTION_VELOCITY
+				? -approach * contact.restitution
+				: 0.f;
+			constraint.key = pair_key(mObjectSlots[contact.objects[0]],
+									  mObjectSlots[contact.objects[1]]);
+			const auto cached = std::lower_bound(
+				mContactCache.begin(), mContactCache.end(), constraint.key,
+				[](const CachedImpulse& cached, u64 key) {
+					return cached.key < key;
+				});
+			constraint.normal_impulse =
+				cached != mContactCache.end() && cached->key == constraint.key
+				? cached->impulse
+				: 0.f;
+		}
+		// warm start with the impulses the same pairs ended on last step
+		for (const ContactConstraint& constraint : mConstraints) {
+			apply_impulse(constraint, constraint.normal_impulse);
+		}
+	}
+
+	glm::vec3 Engine::contact_velocity(const ContactConstraint& constraint,
+									   u32 j) const {
+		glm::vec3 velocity{0, 0, 0};
+		if (constraint.movement[j] >= 0) {
+			velocity = mMovementComponents[constraint.movement[j]].velocity;
+		}
+		if (constraint.rigidbody[j] >= 0) {
+			velocity += glm::cross(mAngularVelocities[constraint.rigidbody[j]],
+								   constraint.offset[j]);
+		}
+		return velocity;
+	}
+
+	void Engine::apply_impulse(const ContactConstraint& constraint,
+							   f32 impulse) {
+		for (u32 j = 0; j < 2; ++j) {
+			if (constraint.inverse_mass[j] <= 0.f) {
+				continue;
+			}
+			const f32 signed_impulse = j == 0 ? impulse : -impulse;
+			mMovementComponents[constraint.movement[j]].velocity +=
+				constraint.normal *
+				(signed_impulse * constraint.inverse_mass[j]);
+			mAngularVelocities[constraint.rigidbody[j]] +=
+				constraint.angular_response[j] * signed_impulse;
+		}
+	}
+
+	void Engine::solve_velocities() {
+		for (ContactConstraint& constraint : mConstraints) {
+			if (constraint.normal_mass <= 0.f) {
+				continue;
+			}
+			const f32 separating_velocity =
+				glm::dot(contact_velocity(constraint, 0) -
+							 contact_velocity(constraint, 1),
+						 constraint.normal);
+			const f32 lambda = constraint.normal_mass *
+				(constraint.target_velocity - separating_velocity);
+			// contacts only push, clamp the total rather than the increment
+			// so later iterations can take back an overshoot
+			const f32 previous = constraint.normal_impulse;
+			constraint.normal_impulse = std::max(previous + lambda, 0.f);
+			apply_impulse(constraint, constraint.normal_impulse - previous);
+		}
+	}
+
+	void Engine::store_impulses() {
+		mContactCache.resize(mConstraints.size());
+		for (u32 i = 0; i < mConstraints.size(); ++i) {
+			mContactCache[i] = {mConstraints[i].key,
+								mConstraints[i].normal_impulse};
+		}
+		// sorted for the lookups in prepare_contacts, scenes without
+		// planes or removals already come in key order
+		const auto by_key = [](const CachedImpulse& a, const CachedImpulse& b) {
+			return a.key < b.key;
+		};
+		if (!std::is_sorted(mContactCache.begin(), mContactCache.end(),
+							by_key)) {
+			std::sort(mContactCache.begin(), mContactCache.end(), by_key);
+		}
+	}
+
+	void Engine::resolve_interpenetration() {
+		for (u32 iteration = 0; iteration < POSITION_ITERATIONS; ++iteration) {
+			for (u32 i = 0; i < mCollisions.size(); ++i) {
+				const CollisionContact& contact = mCollisions[i];
+				const ContactConstraint& constraint = mConstraints[i];
+				// positions are only translated, so the angular terms in
+				// normal_mass would leave off-centre contacts short
+				const f32 linear_inverse_mass =
+					constraint.inverse_mass[0] + constraint.inverse_mass[1];
+				if (linear_inverse_mass <= 0.f) {
+					continue;
+				}
+				// the narrowphase depth minus what earlier passes already
+				// moved the two objects apart
+				glm::vec3 displacement{0, 0, 0};
+				for (u32 j = 0; j < 2; ++j) {
+					const s32 transform_index =
+						mPhysicsObjects[contact.objects[j]].transform_index;
+					if (constraint.inverse_mass[j] > 0.f &&
+						transform_index >= 0) {
+						const glm::vec3 moved =
+							mCoreEngine->transforms()[transform_index]
+								.position() -
+							constraint.position[j];
+						displacement += j == 0 ? moved : -moved;
+					}
+				}
+				const f32 penetration = contact.distance -
+					glm::dot(displacement, contact.contact_normal);
+				if (penetration <= PENETRATION_SLOP) {
+					continue;
+				}
+				const glm::vec3 move_per_inverse_mass =
+					contact.contact_normal *
+					((penetration - PENETRATION_SLOP) * POSITION_CORRECTION /
+					 linear_inverse_mass);
+				for (u32 j = 0; j < 2; ++j) {
+					const s32 transform_index =
+						mPhysicsObjects[contact.objects[j]].transform_index;
+					if (constraint.inverse_mass[j] <= 0.f ||
+						transform_index < 0) {
+						continue;
+					}
+					gameplay::Transform transform =
+						mCoreEngine->transforms()[transform_index];
+					const glm::vec3 movement =
+						move_per_inverse_mass * constraint.inverse_mass[j];
+					transform.position(transform.position() +
+									   (j == 0 ? movement : -movement));
+				}
+			}
+		}
+	}
+} // namespace physics
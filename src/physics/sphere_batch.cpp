@@ -0,0 +1,117 @@
+#include "physics/sphere_batch.h"
+#include <cmath>
+#include "core/simd.h"
+
+namespace physics {
+	// Same arithmetic as SphereCollider::check_collision so both paths agree.
+	static inline IntersectData sphere_sphere(f32 ax, f32 ay, f32 az, f32 ar,
+											  f32 bx, f32 by, f32 bz,
+											  f32 br) {
+		const f32 dx = ax - bx;
+		const f32 dy = ay - by;
+		const f32 dz = az - bz;
+		const f32 center_distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+		const f32 radius_distance = ar + br;
+		return {center_distance < radius_distance,
+				center_distance - radius_distance};
+	}
+
+#ifdef CORE_SIMD
+	using namespace core::simd;
+
+	static inline void kernel(Lane ax, Lane ay, Lane az, Lane ar, Lane bx,
+							  Lane by, Lane bz, Lane br, IntersectData* out) {
+		const Lane dx = sub(ax, bx);
+		const Lane dy = sub(ay, by);
+		const Lane dz = sub(az, bz);
+		const Lane center_distance =
+			root(add(add(mul(dx, dx), mul(dy, dy)), mul(dz, dz)));
+		const Lane radius_distance = add(ar, br);
+		f32 distance[LANES];
+		store(distance, sub(center_distance, radius_distance));
+		const s32 hits = mask(less(center_distance, radius_distance));
+		for (u32 i = 0; i < LANES; ++i) {
+			out[i] = {((hits >> i) & 1) != 0, distance[i]};
+		}
+	}
+#endif
+
+	void SphereBatch::clear() {
+		mX.clear();
+		mY.clear();
+		mZ.clear();
+		mRadius.clear();
+	}
+
+	void SphereBatch::reserve(u32 count) {
+		mX.reserve(count);
+		mY.reserve(count);
+		mZ.reserve(count);
+		mRadius.reserve(count);
+	}
+
+	void SphereBatch::check_collision_range(u32 index, u32 first, u32 count,
+											IntersectData* out) const {
+		u32 i = 0;
+#ifdef CORE_SIMD
+		const Lane ax = broadcast(mX[index]);
+		const Lane ay = broadcast(mY[index]);
+		const Lane az = broadcast(mZ[index]);
+		const Lane ar = broadcast(mRadius[index]);
+		for (; i + LANES <= count; i += LANES) {
+			const u32 j = first + i;
+			kernel(ax, ay, az, ar, load(&mX[j]), load(&mY[j]), load(&mZ[j]),
+				   load(&mRadius[j]), out + i);
+		}
+#endif
+		for (; i < count; ++i) {
+			const u32 j = first + i;
+			out[i] = sphere_sphere(mX[index], mY[index], mZ[index],
+								   mRadius[index], mX[j], mY[j], mZ[j],
+								   mRadius[j]);
+		}
+	}
+
+	void SphereBatch::check_collision(u32 index, const u32* others, u32 count,
+									  IntersectData* out) const {
+		u32 i = 0;
+#ifdef CORE_SIMD
+		const Lane ax = broadcast(mX[index]);
+		const Lane ay = broadcast(mY[index]);
+		const Lane az = broadcast(mZ[index]);
+		const Lane ar = broadcast(mRadius[index]);
+		for (; i + LANES <= count; i += LANES) {
+			const u32* j = others + i;
+			kernel(ax, ay, az, ar, gather(mX.data(), j), gather(mY.data(), j),
+				   gather(mZ.data(), j), gather(mRadius.data(), j), out + i);
+		}
+#endif
+		for (; i < count; ++i) {
+			const u32 j = others[i];
+			out[i] = sphere_sphere(mX[index], mY[index], mZ[index],
+								   mRadius[index], mX[j], mY[j], mZ[j],
+								   mRadius[j]);
+		}
+	}
+
+	void SphereBatch::check_collision(const u32* first, const u32* second,
+									  u32 count, IntersectData* out) const {
+		u32 i = 0;
+#ifdef CORE_SIMD
+		for (; i + LANES <= count; i += LANES) {
+			const u32* a = first + i;
+			const u32* b = second + i;
+			kernel(gather(mX.data(), a), gather(mY.data(), a),
+				   gather(mZ.data(), a), gather(mRadius.data(), a),
+				   gather(mX.data(), b), gather(mY.data(), b),
+				   gather(mZ.data(), b), gather(mRadius.data(), b), out + i);
+		}
+#endif
+		for (; i < count; ++i) {
+			const u32 a = first[i];
+			const u32 b = second[i];
+			out[i] = sphere_sphere(mX[a], mY[a], mZ[a], mRadius[a], mX[b],
+								   mY[b], mZ[b], mRadius[b]);
+		}
+	}
+} // namespace physics
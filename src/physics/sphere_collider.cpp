@@ -1,13 +1,21 @@
 #include "physics/sphere_collider.h"
+#include <algorithm>
+#include <cmath>
 #include <glm/geometric.hpp>
 
 namespace physics {
 	SphereCollider::SphereCollider(
-		ArrayList<gameplay::Transform>& transform_list, s32 transform_index,
+		gameplay::TransformStore& transform_list, s32 transform_index,
 		float radius) :
-		mTransformList(transform_list),
+		mTransformList(&transform_list),
 		mTransformIndex(transform_index), mRadius(radius) {}
 
+	SphereCollider::SphereCollider(
+		ArrayList<gameplay::Transform>& transform_list, s32 transform_index,
+		float radius) :
+		SphereCollider(transform_list[transform_index].store(),
+					   transform_list[transform_index].index(), radius) {}
+
 	SphereCollider::SphereCollider(SphereCollider&& other) noexcept :
 		mTransformList(other.mTransformList) {
 		mRadius = other.mRadius;
@@ -28,10 +36,36 @@ namespace physics {
 	IntersectData
 	SphereCollider::check_collision(const SphereCollider& other) const {
 		float radius_distance = mRadius + other.mRadius;
-		float center_distance =
-			glm::distance(mTransformList[mTransformIndex].position(),
-						  other.mTransformList[other.mTransformIndex].position());
+		float center_distance = glm::distance(center(), other.center());
 		float distance = center_distance - radius_distance;
 		return IntersectData(center_distance < radius_distance, distance);
 	}
+
+	bool SphereCollider::raycast(const Ray& ray, RaycastHit& hit) const {
+		return raycast_sphere(center(), mRadius, ray, hit);
+	}
+
+	bool raycast_sphere(const glm::vec3& center, f32 radius, const Ray& ray,
+						RaycastHit& hit) {
+		const glm::vec3 m = ray.origin - center;
+		const f32 b = glm::dot(m, ray.direction);
+		const f32 c = glm::dot(m, m) - radius * radius;
+		// origin outside and pointing away
+		if (c > 0.f && b > 0.f) {
+			return false;
+		}
+		const f32 discriminant = b * b - c;
+		if (discriminant < 0.f) {
+			return false;
+		}
+		const f32 t = std::max(-b - std::sqrt(discriminant), 0.f);
+		if (t > ray.max_distance) {
+			return false;
+		}
+		hit.distance = t;
+		hit.normal = c > 0.f
+			? glm::normalize(ray.origin + ray.direction * t - center)
+			: -ray.direction;
+		return true;
+	}
 } // namespace physics
@@ -0,0 +1,260 @@
+#include "render/vulkan/depth_pyramid.h"
+#include "render/vulkan/builders.h"
+#include "render/vulkan/descriptor_set_builder.h"
+#include "render/vulkan/pipeline.h"
+#include "render/vulkan/renderer.h"
+
+namespace render::vulkan {
+	// rounded up so every texel of the level below has a parent
+	static VkExtent2D half(VkExtent2D extent) {
+		return {(extent.width + 1) / 2, (extent.height + 1) / 2};
+	}
+
+	static u32 group_count(u32 size) {
+		return (size + DepthPyramid::GROUP_SIZE - 1) / DepthPyramid::GROUP_SIZE;
+	}
+
+	DepthPyramid::DepthPyramid(VulkanRenderer* renderer, const Image& depth,
+							   VkExtent2D extent) :
+		mDevice(renderer->device().logical_device()),
+		mAllocator(renderer->device().allocator()), mExtent(extent) {
+		const VkExtent2D base = half(extent);
+		mLevelCount = 1;
+		for (VkExtent2D size = base; size.width > 1 || size.height > 1;
+			 size = half(size)) {
+			++mLevelCount;
+		}
+		VkImageCreateInfo image_ci = builder::image_ci(
+			VK_FORMAT_R32_SFLOAT,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			{base.width, base.height, 1}, mLevelCount);
+		VmaAllocationCreateInfo alloc_ci{};
+		alloc_ci.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		VK_CHECK(vmaCreateImage(mAllocator, &image_ci, &alloc_ci, &mImage,
+								&mMemory, nullptr));
+		VkImageViewCreateInfo view_ci = builder::imageview_ci(
+			VK_FORMAT_R32_SFLOAT, mImage, VK_IMAGE_ASPECT_COLOR_BIT,
+			mLevelCount);
+		VK_CHECK(vkCreateImageView(mDevice, &view_ci, nullptr, &mView));
+		mLevelViews.resize(mLevelCount);
+		for (u32 i = 0; i < mLevelCount; ++i) {
+			view_ci.subresourceRange.baseMipLevel = i;
+			view_ci.subresourceRange.levelCount = 1;
+			VK_CHECK(
+				vkCreateImageView(mDevice, &view_ci, nullptr, &mLevelViews[i]));
+		}
+		// only read through texelFetch, filtering doesn't matter
+		VkSamplerCreateInfo sampler_ci = builder::sampler_create_info(
+			VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			mLevelCount);
+		VK_CHECK(vkCreateSampler(mDevice, &sampler_ci, nullptr, &mSampler));
+		renderer->immediate_submit([&](VkCommandBuffer cmd) {
+			VkImageMemoryBarrier general{
+				VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				nullptr,
+				0,
+				VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_QUEUE_FAMILY_IGNORED,
+				VK_QUEUE_FAMILY_IGNORED,
+				mImage,
+				{VK_IMAGE_ASPECT_COLOR_BIT, 0, mLevelCount, 0, 1}};
+			vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+								 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
+								 nullptr, 0, nullptr, 1, &general);
+		});
+		// the sets live in a pool of their own, so rebuilding the pyramid
+		// on resize gives them back instead of growing the renderer's pool
+		VkDescriptorPoolSize pool_sizes[2]{
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, mLevelCount + 1},
+			{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, mLevelCount}};
+		VkDescriptorPoolCreateInfo pool_ci{
+			VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO, nullptr};
+		pool_ci.maxSets = mLevelCount + 1;
+		pool_ci.poolSizeCount = 2;
+		pool_ci.pPoolSizes = pool_sizes;
+		VK_CHECK(vkCreateDescriptorPool(mDevice, &pool_ci, nullptr,
+										&mDescriptorPool));
+		VkDescriptorSetLayoutBinding bindings[2]{
+			{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1,
+			 VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+			{1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1,
+			 VK_SHADER_STAGE_COMPUTE_BIT, nullptr}};
+		VkDescriptorSetLayoutCreateInfo layout_ci{
+			VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO, nullptr};
+		layout_ci.bindingCount = 2;
+		layout_ci.pBindings = bindings;
+		DescriptorLayoutCache& layout_cache =
+			renderer->descriptor_layout_cache();
+		const VkDescriptorSetLayout reduce_layout =
+			layout_cache.get_layout(layout_ci);
+		layout_ci.bindingCount = 1;
+		mReadLayout = layout_cache.get_layout(layout_ci);
+		// the read set goes last, after one reduce set per level
+		ArrayList<VkDescriptorSetLayout> layouts(mLevelCount, reduce_layout);
+		layouts.push_back(mReadLayout);
+		VkDescriptorSetAllocateInfo alloc_info{
+			VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, nullptr};
+		alloc_info.descriptorPool = mDescriptorPool;
+		alloc_info.descriptorSetCount = static_cast<u32>(layouts.size());
+		alloc_info.pSetLayouts = layouts.data();
+		ArrayList<VkDescriptorSet> sets(layouts.size());
+		VK_CHECK(vkAllocateDescriptorSets(mDevice, &alloc_info, sets.data()));
+		mReadSet = sets.back();
+		sets.pop_back();
+		mReduceSets = std::move(sets);
+		ArrayList<VkDescriptorImageInfo> images{};
+		images.reserve(mLevelCount * 2 + 1);
+		ArrayList<VkWriteDescriptorSet> writes{};
+		const auto write = [&](VkDescriptorSet set, u32 binding,
+							   VkDescriptorType type,
+							   VkDescriptorImageInfo image) {
+			images.push_back(image);
+			VkWriteDescriptorSet entry{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+									   nullptr};
+			entry.dstSet = set;
+			entry.dstBinding = binding;
+			entry.descriptorCount = 1;
+			entry.descriptorType = type;
+			entry.pImageInfo = &images.back();
+			writes.push_back(entry);
+		};
+		for (u32 i = 0; i < mLevelCount; ++i) {
+			write(mReduceSets[i], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				  {mSampler, i == 0 ? depth.view : mLevelViews[i - 1],
+				   i == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+						  : VK_IMAGE_LAYOUT_GENERAL});
+			write(mReduceSets[i], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				  {VK_NULL_HANDLE, mLevelViews[i], VK_IMAGE_LAYOUT_GENERAL});
+		}
+		write(mReadSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			  {mSampler, mView, VK_IMAGE_LAYOUT_GENERAL});
+		vkUpdateDescriptorSets(mDevice, static_cast<u32>(writes.size()),
+							   writes.data(), 0, nullptr);
+		builder::PipelineBuilder builder;
+		builder
+			.add_shader_module(renderer->shader_cache().get_shader(
+								   "assets/shaders/depth_reduce.comp.glsl.spv"),
+							   ShaderType::COMPUTE)
+			.add_descriptor_set_layout(reduce_layout);
+		mReduceLayout = builder.build_layout(mDevice);
+		mReducePipeline = builder.build_compute_pipeline(mDevice);
+	}
+
+	DepthPyramid::DepthPyramid(DepthPyramid&& other) noexcept {
+		*this = std::move(other);
+	}
+
+	DepthPyramid& DepthPyramid::operator=(DepthPyramid&& other) noexcept {
+		if (this == &other) {
+			return *this;
+		}
+		destroy();
+		mDevice = other.mDevice;
+		mAllocator = other.mAllocator;
+		mImage = other.mImage;
+		mMemory = other.mMemory;
+		mView = other.mView;
+		mLevelViews = std::move(other.mLevelViews);
+		mSampler = other.mSampler;
+		mDescriptorPool = other.mDescriptorPool;
+		mReduceSets = std::move(other.mReduceSets);
+		mReadSet = other.mReadSet;
+		mReadLayout = other.mReadLayout;
+		mReduceLayout = other.mReduceLayout;
+		mReducePipeline = other.mReducePipeline;
+		mExtent = other.mExtent;
+		mLevelCount = other.mLevelCount;
+		other.mDevice = nullptr;
+		return *this;
+	}
+
+	DepthPyramid::~DepthPyramid() { destroy(); }
+
+	void DepthPyramid::destroy() {
+		if (!mDevice) {
+			return;
+		}
+		// frees the reduce and read sets with it
+		vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+		vkDestroyPipeline(mDevice, mReducePipeline, nullptr);
+		vkDestroyPipelineLayout(mDevice, mReduceLayout, nullptr);
+		vkDestroySampler(mDevice, mSampler, nullptr);
+		for (VkImageView view : mLevelViews) {
+			vkDestroyImageView(mDevice, view, nullptr);
+		}
+		vkDestroyImageView(mDevice, mView, nullptr);
+		vmaDestroyImage(mAllocator, mImage, mMemory);
+		mLevelViews.clear();
+		mReduceSets.clear();
+		mDevice = nullptr;
+	}
+
+	void DepthPyramid::build(VkCommandBuffer buf, VkImage depth) {
+		const VkImageSubresourceRange depth_range{VK_IMAGE_ASPECT_DEPTH_BIT, 0,
+												  1, 0, 1};
+		// the draws so far finished writing depth and the last occlusion
+		// test finished reading the chain
+		VkImageMemoryBarrier ready[2]{
+			{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, nullptr,
+			 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			 VK_ACCESS_SHADER_READ_BIT,
+			 VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			 VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+			 VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, depth,
+			 depth_range},
+			{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, nullptr,
+			 VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			 VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+			 VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, mImage,
+			 {VK_IMAGE_ASPECT_COLOR_BIT, 0, mLevelCount, 0, 1}}};
+		vkCmdPipelineBarrier(buf,
+							 VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+								 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+							 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
+							 nullptr, 0, nullptr, 2, ready);
+		vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, mReducePipeline);
+		VkExtent2D size = mExtent;
+		for (u32 i = 0; i < mLevelCount; ++i) {
+			size = half(size);
+			vkCmdBindDescriptorSets(buf, VK_PIPELINE_BIND_POINT_COMPUTE,
+									mReduceLayout, 0, 1, &mReduceSets[i], 0,
+									nullptr);
+			vkCmdDispatch(buf, group_count(size.width),
+						  group_count(size.height), 1);
+			// read by the next level, or by the occlusion test after the
+			// last one
+			VkImageMemoryBarrier written{
+				VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				nullptr,
+				VK_ACCESS_SHADER_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_QUEUE_FAMILY_IGNORED,
+				VK_QUEUE_FAMILY_IGNORED,
+				mImage,
+				{VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1}};
+			vkCmdPipelineBarrier(buf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+								 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
+								 nullptr, 0, nullptr, 1, &written);
+		}
+		VkImageMemoryBarrier attachment{
+			VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			nullptr,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED,
+			depth,
+			depth_range};
+		vkCmdPipelineBarrier(buf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+							 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+								 VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+							 0, 0, nullptr, 0, nullptr, 1, &attachment);
+	}
+} // namespace render::vulkan
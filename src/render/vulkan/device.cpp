@@ -6,17 +6,36 @@
 namespace render::vulkan {
 	Device::Device(vkb::Instance vkb_inst, VkSurfaceKHR surface) :
 		mLifetime(ObjectLifetime::OWNED) {
+		// models are drawn with one multi draw indirect per material, the
+		// object index comes in as firstInstance
+		VkPhysicalDeviceFeatures features{};
+		features.multiDrawIndirect = VK_TRUE;
+		features.drawIndirectFirstInstance = VK_TRUE;
 		vkb::PhysicalDeviceSelector selector{vkb_inst};
-		vkb::PhysicalDevice vkb_phys_dev = selector.set_minimum_version(1, 1)
+		vkb::PhysicalDevice vkb_phys_dev = selector.set_minimum_version(1, 2)
+											   .set_required_features(features)
 											   .set_surface(surface)
 											   .select()
 											   .value();
+		// the GPU culling pass needs the draw count from a buffer, without
+		// it the renderer culls on the CPU
+		VkPhysicalDeviceVulkan12Features supported_12{
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+		VkPhysicalDeviceFeatures2 supported{
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, &supported_12};
+		vkGetPhysicalDeviceFeatures2(vkb_phys_dev.physical_device, &supported);
+		bDrawIndirectCount = supported_12.drawIndirectCount;
+		VkPhysicalDeviceVulkan12Features features_12{
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+		features_12.drawIndirectCount = supported_12.drawIndirectCount;
 		VkPhysicalDeviceShaderDrawParametersFeatures shader_dram_param_feat{
 			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES,
 			nullptr, VK_TRUE};
 		vkb::DeviceBuilder dev_builder{vkb_phys_dev};
-		vkb::Device vkb_dev =
-			dev_builder.add_pNext(&shader_dram_param_feat).build().value();
+		vkb::Device vkb_dev = dev_builder.add_pNext(&shader_dram_param_feat)
+								  .add_pNext(&features_12)
+								  .build()
+								  .value();
 		mDevice = vkb_dev.device;
 		mPhysicalDevice = vkb_phys_dev.physical_device;
 		mPhysicalDeviceProperties = vkb_dev.physical_device.properties;
@@ -37,6 +56,7 @@ namespace render::vulkan {
 		mPhysicalDeviceProperties = other.mPhysicalDeviceProperties;
 		mGraphicsQueue = other.mGraphicsQueue;
 		mGraphicsQueueFamily = other.mGraphicsQueueFamily;
+		bDrawIndirectCount = other.bDrawIndirectCount;
 		mLifetime = ObjectLifetime::OWNED;
 		mAllocator = other.mAllocator;
 		other.mLifetime = ObjectLifetime::TEMP;
@@ -48,6 +68,7 @@ namespace render::vulkan {
 		mPhysicalDeviceProperties = device.mPhysicalDeviceProperties;
 		mGraphicsQueue = device.mGraphicsQueue;
 		mGraphicsQueueFamily = device.mGraphicsQueueFamily;
+		bDrawIndirectCount = device.bDrawIndirectCount;
 		mAllocator = device.mAllocator;
 		mLifetime = ObjectLifetime::OWNED;
 		device.mLifetime = ObjectLifetime::TEMP;
@@ -59,6 +80,7 @@ namespace render::vulkan {
 		mPhysicalDeviceProperties = other.mPhysicalDeviceProperties;
 		mGraphicsQueue = other.mGraphicsQueue;
 		mGraphicsQueueFamily = other.mGraphicsQueueFamily;
+		bDrawIndirectCount = other.bDrawIndirectCount;
 		mLifetime = ObjectLifetime::OWNED;
 		mAllocator = other.mAllocator;
 		other.mLifetime = ObjectLifetime::TEMP;
@@ -71,6 +93,7 @@ namespace render::vulkan {
 		mPhysicalDeviceProperties = other.mPhysicalDeviceProperties;
 		mGraphicsQueue = other.mGraphicsQueue;
 		mGraphicsQueueFamily = other.mGraphicsQueueFamily;
+		bDrawIndirectCount = other.bDrawIndirectCount;
 		mLifetime = ObjectLifetime::OWNED;
 		mAllocator = other.mAllocator;
 		other.mLifetime = ObjectLifetime::TEMP;
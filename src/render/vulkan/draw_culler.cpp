@@ -0,0 +1,76 @@
+#include "render/vulkan/draw_culler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace render::vulkan {
+	void DrawCuller::assign(const ArrayList<DrawCommand>& commands,
+							const ArrayList<glm::vec4>& bounds,
+							const ArrayList<DrawBatch>& batches) {
+		mCommands = commands;
+		mBounds = bounds;
+		mBatches = batches;
+		mVisible.assign(commands.size(), 1);
+		// until the first cull everything is visible
+		mVisibleCommands = commands;
+		mVisibleBatches = batches;
+	}
+
+	void DrawCuller::cull(const gameplay::Frustum& frustum,
+						  std::span<const glm::mat4> world,
+						  core::ThreadPool& pool) {
+		pool.parallel_for(size(), CHUNK_SIZE, [&](u32, u32 begin, u32 end) {
+			test(frustum, world, begin, end);
+		});
+		// serial so the visible commands keep the order of their batch
+		mVisibleCommands.clear();
+		mVisibleBatches.clear();
+		for (const DrawBatch& batch : mBatches) {
+			const u32 first = mVisibleCommands.size();
+			const u32 end = batch.first_command + batch.command_count;
+			for (u32 i = batch.first_command; i < end; ++i) {
+				if (mVisible[i]) {
+					mVisibleCommands.push_back(mCommands[i]);
+				}
+			}
+			const u32 count = mVisibleCommands.size() - first;
+			if (count > 0) {
+				mVisibleBatches.push_back({batch.material_index, first, count});
+			}
+		}
+	}
+
+	void DrawCuller::test(const gameplay::Frustum& frustum,
+						  std::span<const glm::mat4> world, u32 begin,
+						  u32 end) {
+		f32 x[CHUNK_SIZE];
+		f32 y[CHUNK_SIZE];
+		f32 z[CHUNK_SIZE];
+		f32 radius[CHUNK_SIZE];
+		for (u32 i = begin; i < end; ++i) {
+			const glm::vec4& sphere = mBounds[i];
+			const u32 object = mCommands[i].first_instance;
+			const u32 lane = i - begin;
+			if (object >= world.size()) {
+				// a sphere around everything
+				x[lane] = y[lane] = z[lane] = 0.f;
+				radius[lane] = INFINITY;
+				continue;
+			}
+			const glm::mat4& m = world[object];
+			x[lane] = m[0][0] * sphere.x + m[1][0] * sphere.y +
+				m[2][0] * sphere.z + m[3][0];
+			y[lane] = m[0][1] * sphere.x + m[1][1] * sphere.y +
+				m[2][1] * sphere.z + m[3][1];
+			z[lane] = m[0][2] * sphere.x + m[1][2] * sphere.y +
+				m[2][2] * sphere.z + m[3][2];
+			// the longest axis bounds the scaled sphere
+			const f32 scale = std::max(
+				{m[0][0] * m[0][0] + m[0][1] * m[0][1] + m[0][2] * m[0][2],
+				 m[1][0] * m[1][0] + m[1][1] * m[1][1] + m[1][2] * m[1][2],
+				 m[2][0] * m[2][0] + m[2][1] * m[2][1] + m[2][2] * m[2][2]});
+			radius[lane] = sphere.w * std::sqrt(scale);
+		}
+		frustum.intersects(x, y, z, radius, end - begin,
+						   mVisible.data() + begin);
+	}
+} // namespace render::vulkan
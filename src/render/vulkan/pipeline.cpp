@@ -30,6 +30,7 @@ namespace render::vulkan::builder{
 				switch (type) {
 					PROCESS_VAL(ShaderType::VERTEX)
 					PROCESS_VAL(ShaderType::FRAGMENT)
+					PROCESS_VAL(ShaderType::COMPUTE)
 				}
 #undef PROCESS_VAL
 			}
@@ -276,4 +277,26 @@ namespace render::vulkan::builder{
 		return pipeline;
 	}
 
+	VkPipeline PipelineBuilder::build_compute_pipeline(VkDevice device) {
+		if (mShaderStages.size() != 1 ||
+			mShaderStages[0].stage != VK_SHADER_STAGE_COMPUTE_BIT) {
+			core::Logger::Error(
+				"Compute pipeline needs exactly one compute shader.");
+			return VK_NULL_HANDLE;
+		}
+		VkComputePipelineCreateInfo pipeline_ci{
+			VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			nullptr,
+			0,
+			mShaderStages[0],
+			mPipelineLayout,
+			nullptr,
+			-1};
+		VkPipeline pipeline;
+		VK_CHECK(vkCreateComputePipelines(device, nullptr, 1, &pipeline_ci,
+										  nullptr, &pipeline));
+		core::Logger::Trace("Compute pipeline successfully created.");
+		return pipeline;
+	}
+
 }
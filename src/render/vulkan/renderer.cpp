@@ -5,6 +5,7 @@
 #include <SDL_video.h>
 #include <SDL_vulkan.h>
 #include <algorithm>
+#include <cassert>
 #include <chrono>
 #include <ctime>
 #include <glm/ext/matrix_clip_space.hpp>
@@ -53,6 +54,7 @@ namespace render::vulkan {
 		mCamera.transform.position({0, 0, 3});
 		mImageCache = {mDevice, this};
 		mShaderCache = {mDevice};
+		mDepthPyramid = {this, mSwapchain.depth_attachment(), mWindowExtent};
 	}
 
     VulkanRenderer::VulkanRenderer(const asset::GLTFImporter& scene_asset){
@@ -84,6 +86,7 @@ namespace render::vulkan {
 		mCamera.transform.position({0, 0, 3});
 		mImageCache = {mDevice, this};
 		mShaderCache = {mDevice};
+		mDepthPyramid = {this, mSwapchain.depth_attachment(), mWindowExtent};
         mGltfScene = {scene_asset, &mDevice, this};
     }
 
@@ -95,6 +98,8 @@ namespace render::vulkan {
 		mSurface = std::move(other.mSurface);
 		mSwapchain = std::move(other.mSwapchain);
 		mRenderPass = std::move(other.mRenderPass);
+		mEarlyRenderPass = other.mEarlyRenderPass;
+		mLateRenderPass = other.mLateRenderPass;
 		mMaterialMap = std::move(other.mMaterialMap);
 		mMaterialBufferMap = std::move(other.mMaterialBufferMap);
 		for (auto i = 0; i < MAXIMUM_FRAMES_IN_FLIGHT; ++i) {
@@ -109,14 +114,20 @@ namespace render::vulkan {
 			std::move(other.mObjectsDescriptorSetLayout);
 		mTextureSamplerDescriptorSetLayout =
 			std::move(other.mTextureSamplerDescriptorSetLayout);
-		mScene = std::move(other.mScene);
+		mSceneData = other.mSceneData;
 		mGltfScene = std::move(other.mGltfScene);
 		mUploadContext = std::move(other.mUploadContext);
 		mCurrFrame = other.mCurrFrame;
 		mShouldResize = other.mShouldResize;
+		bCpuCulling = other.bCpuCulling;
+		bOcclusionCulling = other.bOcclusionCulling;
 		mShaderCache = std::move(other.mShaderCache);
 		mCamera = std::move(other.mCamera);
 		mImageCache = std::move(other.mImageCache);
+		mObjectUploads = std::move(other.mObjectUploads);
+		mTransientBuffer = std::move(other.mTransientBuffer);
+		mTransient = std::move(other.mTransient);
+		mDepthPyramid = std::move(other.mDepthPyramid);
 		other.mpWindow = nullptr;
 		other.mGlobalDescriptorSetLayout = nullptr;
 		other.mObjectsDescriptorSetLayout = nullptr;
@@ -131,6 +142,8 @@ namespace render::vulkan {
 		mSurface = std::move(other.mSurface);
 		mSwapchain = std::move(other.mSwapchain);
 		mRenderPass = std::move(other.mRenderPass);
+		mEarlyRenderPass = other.mEarlyRenderPass;
+		mLateRenderPass = other.mLateRenderPass;
 		mMaterialMap = std::move(other.mMaterialMap);
 		mMaterialBufferMap = std::move(other.mMaterialBufferMap);
 		for (auto i = 0; i < MAXIMUM_FRAMES_IN_FLIGHT; ++i) {
@@ -145,14 +158,20 @@ namespace render::vulkan {
 			std::move(other.mObjectsDescriptorSetLayout);
 		mTextureSamplerDescriptorSetLayout =
 			std::move(other.mTextureSamplerDescriptorSetLayout);
-		mScene = std::move(other.mScene);
+		mSceneData = other.mSceneData;
 		mGltfScene = std::move(other.mGltfScene);
 		mUploadContext = std::move(other.mUploadContext);
 		mCurrFrame = other.mCurrFrame;
 		mShouldResize = other.mShouldResize;
+		bCpuCulling = other.bCpuCulling;
+		bOcclusionCulling = other.bOcclusionCulling;
 		mShaderCache = std::move(other.mShaderCache);
 		mCamera = std::move(other.mCamera);
 		mImageCache = std::move(other.mImageCache);
+		mObjectUploads = std::move(other.mObjectUploads);
+		mTransientBuffer = std::move(other.mTransientBuffer);
+		mTransient = std::move(other.mTransient);
+		mDepthPyramid = std::move(other.mDepthPyramid);
 		other.mpWindow = nullptr;
 		other.mGlobalDescriptorSetLayout = nullptr;
 		other.mObjectsDescriptorSetLayout = nullptr;
@@ -181,9 +200,6 @@ namespace render::vulkan {
 				vkDestroySemaphore(mDevice.logical_device(),
 								   mFrames[i].render_semaphore, nullptr);
 			}
-			if (mFrames[i].camera_buffer.handle) {
-				mFrames[i].camera_buffer.destroy();
-			}
 			if (mFrames[i].object_buffer.handle) {
 				mFrames[i].object_buffer.destroy();
 			}
@@ -199,6 +215,14 @@ namespace render::vulkan {
 		if (mRenderPass) {
 			vkDestroyRenderPass(mDevice.logical_device(), mRenderPass, nullptr);
 		}
+		if (mEarlyRenderPass) {
+			vkDestroyRenderPass(mDevice.logical_device(), mEarlyRenderPass,
+								nullptr);
+		}
+		if (mLateRenderPass) {
+			vkDestroyRenderPass(mDevice.logical_device(), mLateRenderPass,
+								nullptr);
+		}
 		for (std::pair<const Material, ArrayList<Mesh>>& entry : mMaterialMap) {
 			vkDestroyPipelineLayout(mDevice.logical_device(),
 									entry.first.layout, nullptr);
@@ -210,13 +234,19 @@ namespace render::vulkan {
 				mesh.deinit(mDevice.allocator());
 			}
 		}
-		mScene.destroy();
+		if (mTransientBuffer.handle) {
+			mTransientBuffer.destroy();
+		}
 		if (mpWindow) {
 			SDL_DestroyWindow(mpWindow);
 		}
 	}
 
-	void VulkanRenderer::draw(const ArrayList<gameplay::Transform>& transforms) {
+	void VulkanRenderer::draw(const gameplay::TransformStore& transforms,
+							  core::ThreadPool& pool) {
+		// changes are only reported once, queue them even when not drawing
+		mObjectUploads.push(transforms.changed_ranges(),
+							std::min<u32>(transforms.size(), MAX_OBJECTS));
 		// Not rendering when minimized
 		if (SDL_GetWindowFlags(mpWindow) & SDL_WINDOW_MINIMIZED) {
 			return;
@@ -224,36 +254,60 @@ namespace render::vulkan {
 		FrameData& frame_data = get_current_frame();
 		u32 frame_index = mCurrFrame % MAXIMUM_FRAMES_IN_FLIGHT;
 		u32 image_index{};
-		begin_renderpass(frame_data, image_index);
+		begin_frame(frame_data, image_index);
 		VkCommandBuffer& buf = frame_data.command_buffer;
-		// insert actual commands
-		VkDeviceSize offset{0};
-		// model rotation
-		// calculate final mesh matrix
-		MeshPushConstant constants;
-		// make a model view matrix for rendering the object
+		// begin_frame waited on the fence, the GPU is done with whatever
+		// this frame allocated last time around
+		mTransient.begin_frame(frame_index);
 		CameraData cam_data = {};
 		cam_data.proj = mCamera.projection;
 		cam_data.view = mCamera.view();
 		cam_data.view_proj = mCamera.view_proj();
-		void* data; // classic approach
-		vmaMapMemory(mDevice.allocator(), frame_data.camera_buffer.memory,
-					 &data);
-		memcpy(data, &cam_data, sizeof(CameraData));
-		vmaUnmapMemory(mDevice.allocator(), frame_data.camera_buffer.memory);
-		void* object_data; // lil trick
-		vmaMapMemory(mDevice.allocator(), frame_data.object_buffer.memory,
-					 &object_data);
-		ObjectData* object_ssbo = static_cast<ObjectData*>(object_data);
-        u32 ssbo_index{0};
-        for(auto& transform : transforms){
-            object_ssbo[ssbo_index].model_matrix = transform.transform();
-            ssbo_index++;
-        }
-		vmaUnmapMemory(mDevice.allocator(), frame_data.object_buffer.memory);
-		u32 uniform_offset =
-			pad_uniform_buffer(sizeof(SceneData) * frame_index);
-		mScene.write_to_buffer(uniform_offset);
+		// padding a single byte gives the dynamic offset alignment
+		const u32 uniform_alignment = pad_uniform_buffer(1);
+		// reserve_transient sized the ring for the worst case of every frame
+		// in flight, these never run out
+		const UploadRing::Allocation camera =
+			mTransient.write(cam_data, uniform_alignment);
+		const UploadRing::Allocation scene =
+			mTransient.write(mSceneData, uniform_alignment);
+		assert(camera.data && scene.data);
+		frame_data.global_offsets[0] = camera.offset;
+		frame_data.global_offsets[1] = scene.offset;
+		UploadRing::Allocation visible{};
+		if (bCpuCulling) {
+			const gameplay::Frustum frustum{cam_data.view_proj};
+			mGltfScene.cull(frustum, transforms.world(), pool);
+			const ArrayList<DrawCommand>& commands =
+				mGltfScene.visible_commands();
+			const u32 size = commands.size() * sizeof(DrawCommand);
+			// indirect buffer offsets only have to be 4 byte aligned
+			visible = mTransient.allocate(size, 4);
+			assert(visible.data);
+			memcpy(visible.data, commands.data(), size);
+		}
+		u32 transient_offset = 0;
+		u32 transient_size = 0;
+		mTransient.frame_range(transient_offset, transient_size);
+		mTransientBuffer.flush(transient_offset, transient_size);
+		ObjectData* object_ssbo =
+			static_cast<ObjectData*>(frame_data.object_buffer.mapped);
+		// world matrices are contiguous and ObjectData is just the matrix,
+		// only the ones this frame's copy is missing are written
+		static_assert(sizeof(ObjectData) == sizeof(glm::mat4));
+		const ArrayList<gameplay::TransformRange>& uploads =
+			mObjectUploads.take(frame_index);
+		for (const gameplay::TransformRange& range : uploads) {
+			memcpy(object_ssbo + range.begin,
+				   transforms.world().data() + range.begin,
+				   (range.end - range.begin) * sizeof(ObjectData));
+		}
+		if (!uploads.empty()) {
+			frame_data.object_buffer.flush(
+				uploads.front().begin * sizeof(ObjectData),
+				(uploads.back().end - uploads.front().begin) *
+					sizeof(ObjectData));
+		}
 		VkViewport vp{};
 		vp.height = static_cast<f32>(mWindowExtent.height);
 		vp.width = static_cast<f32>(mWindowExtent.width);
@@ -266,7 +320,32 @@ namespace render::vulkan {
 		scissor.offset = {0, 0};
 		scissor.extent = mWindowExtent;
 		vkCmdSetScissor(buf, 0, 1, &scissor);
-		mGltfScene.draw(buf, object_ssbo, frame_data, uniform_offset);
+		const CullView view{cam_data.view, cam_data.proj, mCamera.near_plane,
+							mCamera.far_plane};
+		if (bCpuCulling) {
+			begin_renderpass(frame_data, image_index, mRenderPass);
+			mGltfScene.draw(buf, frame_data, mTransientBuffer.handle,
+							visible.offset);
+		} else if (!bOcclusionCulling) {
+			// compute work has to be recorded outside the render pass
+			mGltfScene.cull(buf, frame_data, frame_index, view, mDepthPyramid,
+							CullPhase::FRUSTUM);
+			begin_renderpass(frame_data, image_index, mRenderPass);
+			mGltfScene.draw(buf, frame_data, frame_index, CullPhase::FRUSTUM);
+		} else {
+			// what was visible last frame is drawn first, its depth then
+			// occludes the rest
+			mGltfScene.cull(buf, frame_data, frame_index, view, mDepthPyramid,
+							CullPhase::EARLY);
+			begin_renderpass(frame_data, image_index, mEarlyRenderPass);
+			mGltfScene.draw(buf, frame_data, frame_index, CullPhase::EARLY);
+			vkCmdEndRenderPass(buf);
+			mDepthPyramid.build(buf, mSwapchain.depth_attachment().handle);
+			mGltfScene.cull(buf, frame_data, frame_index, view, mDepthPyramid,
+							CullPhase::LATE);
+			begin_renderpass(frame_data, image_index, mLateRenderPass);
+			mGltfScene.draw(buf, frame_data, frame_index, CullPhase::LATE);
+		}
 		end_renderpass(buf);
 		mDevice.submit_queue(buf, frame_data.present_semaphore,
 							 frame_data.render_semaphore,
@@ -282,17 +361,22 @@ namespace render::vulkan {
 		SDL_GetWindowSize(mpWindow, &w, &h);
 		core::Logger::Warning("Resizing: {}, {}", w, h);
 		mWindowExtent = {static_cast<uint32_t>(w), static_cast<uint32_t>(h)};
-		mSwapchain.rebuild(w, h, mRenderPass);
+		rebuild_swapchain(w, h);
 		mShouldResize = false;
 	}
 
+	void VulkanRenderer::rebuild_swapchain(u32 width, u32 height) {
+		mSwapchain.rebuild(width, height, mRenderPass);
+		// the old pyramid samples the old depth attachment
+		mDepthPyramid = {this, mSwapchain.depth_attachment(), mWindowExtent};
+	}
+
 	void VulkanRenderer::end_renderpass(VkCommandBuffer buf) {
 		vkCmdEndRenderPass(buf);
 		VK_CHECK(vkEndCommandBuffer(buf));
 	}
 
-	void VulkanRenderer::begin_renderpass(FrameData& frame_data,
-										  u32& image_index) {
+	void VulkanRenderer::begin_frame(FrameData& frame_data, u32& image_index) {
 		// wait until last frame is rendered, timeout 1s
 		VK_CHECK(vkWaitForFences(mDevice.logical_device(), 1,
 								 &frame_data.render_fence, true, 1000000000));
@@ -302,7 +386,7 @@ namespace render::vulkan {
 			core::Logger::Warning("Resizing in get next imag {}, {}", w, h);
 			mWindowExtent = {static_cast<uint32_t>(w),
 							 static_cast<uint32_t>(h)};
-			mSwapchain.rebuild(w, h, mRenderPass);
+			rebuild_swapchain(w, h);
 			mCamera.aspect = w / (f32)h;
 			mCamera.build_projection();
 			mShouldResize = false;
@@ -320,7 +404,7 @@ namespace render::vulkan {
 			core::Logger::Warning("Resizing in get next image: {}, {}", w, h);
 			mWindowExtent = {static_cast<uint32_t>(w),
 							 static_cast<uint32_t>(h)};
-			mSwapchain.rebuild(w, h, mRenderPass);
+			rebuild_swapchain(w, h);
 			mCamera.aspect = w / (f32)h;
 			mCamera.build_projection();
 		} else if (res != VK_SUCCESS) {
@@ -333,11 +417,17 @@ namespace render::vulkan {
 			builder::command_buffer_begin_info(
 				VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 		VK_CHECK(vkBeginCommandBuffer(buf, &buf_begin_info));
+	}
+
+	void VulkanRenderer::begin_renderpass(FrameData& frame_data,
+										  u32 image_index,
+										  VkRenderPass renderpass) {
+		VkCommandBuffer buf = frame_data.command_buffer;
 		VkClearValue color_clear{};
 		VkClearValue depth_clear{};
 		depth_clear.depthStencil.depth = 1.f;
 		VkRenderPassBeginInfo renderpass_info = builder::renderpass_begin_info(
-			mRenderPass, mWindowExtent, mSwapchain.framebuffers()[image_index]);
+			renderpass, mWindowExtent, mSwapchain.framebuffers()[image_index]);
 		float flash = abs(sin(mCurrFrame / 1200.f));
 		color_clear.color = {{0.f, 0.f, flash, 1.f}};
 		VkClearValue clear_values[]{color_clear, depth_clear};
@@ -378,12 +468,13 @@ namespace render::vulkan {
 											pCallbackData->pMessage);
 						return VK_FALSE;
 					})
-				.require_api_version(1, 1, 0)
+				.require_api_version(1, 2, 0)
 				.build()
 				.value();
 		mInstance = {vkb_inst};
 		mSurface = {mpWindow, mInstance.handle()};
 		mDevice = {vkb_inst, mSurface.surface()};
+		bCpuCulling = !mDevice.draw_indirect_count();
 	}
 
 	void VulkanRenderer::init_swapchain() {
@@ -421,16 +512,27 @@ namespace render::vulkan {
 	}
 
 	void VulkanRenderer::init_default_renderpass() {
+		mRenderPass = create_renderpass(true, true);
+		mEarlyRenderPass = create_renderpass(true, false);
+		mLateRenderPass = create_renderpass(false, true);
+	}
 
+	VkRenderPass VulkanRenderer::create_renderpass(bool clear, bool present) {
+		const VkAttachmentLoadOp load_op =
+			clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
 		VkAttachmentDescription color_attachment{};
 		color_attachment.format = mSwapchain.image_format();
 		color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		color_attachment.loadOp = load_op;
 		color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		color_attachment.initialLayout =
+			clear ? VK_IMAGE_LAYOUT_UNDEFINED
+				  : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		color_attachment.finalLayout =
+			present ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+					: VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 		VkAttachmentReference color_attachment_ref = {};
 		color_attachment_ref.attachment = 0;
 		color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -439,11 +541,13 @@ namespace render::vulkan {
 		VkAttachmentDescription depth_attachment{};
 		depth_attachment.format = mSwapchain.depth_format();
 		depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depth_attachment.loadOp = load_op;
 		depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depth_attachment.stencilLoadOp = load_op;
 		depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		depth_attachment.initialLayout =
+			clear ? VK_IMAGE_LAYOUT_UNDEFINED
+				  : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 		depth_attachment.finalLayout =
 			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
@@ -458,15 +562,18 @@ namespace render::vulkan {
 		subpass.pColorAttachments = &color_attachment_ref;
 		subpass.pDepthStencilAttachment = &depth_attach_ref;
 
+		// a loading pass continues from the writes of the pass before it
 		VkSubpassDependency color_dependency = {};
 		color_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 		color_dependency.dstSubpass = 0;
 		color_dependency.srcStageMask =
 			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		color_dependency.srcAccessMask = 0;
+		color_dependency.srcAccessMask =
+			clear ? 0 : VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 		color_dependency.dstStageMask =
 			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		color_dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		color_dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+			(clear ? 0 : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
 
 		VkSubpassDependency depth_dependency = {};
 		depth_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
@@ -474,12 +581,14 @@ namespace render::vulkan {
 		depth_dependency.srcStageMask =
 			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
 			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-		depth_dependency.srcAccessMask = 0;
+		depth_dependency.srcAccessMask =
+			clear ? 0 : VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 		depth_dependency.dstStageMask =
 			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
 			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
 		depth_dependency.dstAccessMask =
-			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+			(clear ? 0 : VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT);
 
 		VkAttachmentDescription attachments[2]{color_attachment,
 											   depth_attachment};
@@ -493,8 +602,10 @@ namespace render::vulkan {
 		render_pass_info.pSubpasses = &subpass;
 		render_pass_info.dependencyCount = 2;
 		render_pass_info.pDependencies = &dependencies[0];
+		VkRenderPass renderpass{};
 		VK_CHECK(vkCreateRenderPass(mDevice.logical_device(), &render_pass_info,
-									nullptr, &mRenderPass));
+									nullptr, &renderpass));
+		return renderpass;
 	}
 
 	void VulkanRenderer::init_sync_objects() {
@@ -522,32 +633,77 @@ namespace render::vulkan {
 							   nullptr, &mUploadContext.upload_fence));
 	}
 
+	void VulkanRenderer::create_transient_buffer(u32 size) {
+		mTransientBuffer = {mDevice.allocator(), size,
+							VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+								VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+								VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+							VMA_MEMORY_USAGE_CPU_TO_GPU,
+							VMA_ALLOCATION_CREATE_MAPPED_BIT};
+		mTransient = {mTransientBuffer.mapped, size, MAXIMUM_FRAMES_IN_FLIGHT};
+	}
+
+	void VulkanRenderer::reserve_transient(u32 command_count) {
+		// per frame the camera and scene uniforms plus every command, with
+		// their alignment padding
+		const u64 alignment = pad_uniform_buffer(1);
+		const u64 frame_size = pad_uniform_buffer(sizeof(CameraData)) +
+			pad_uniform_buffer(sizeof(SceneData)) + 2 * alignment +
+			u64{command_count} * sizeof(DrawCommand) + 4;
+		// twice over, a frame may skip up to its size when it wraps around
+		u64 size = 2 * frame_size * MAXIMUM_FRAMES_IN_FLIGHT;
+		// a multiple of both the uniform and the indirect alignment
+		const u64 granularity = std::max<u64>(alignment, 4);
+		size = (size + granularity - 1) & ~(granularity - 1);
+		if (size <= mTransient.capacity()) {
+			return;
+		}
+		// the frames in flight may still read the old buffer
+		mDevice.wait_idle();
+		mTransientBuffer.destroy();
+		create_transient_buffer(
+			std::max<u32>(static_cast<u32>(size), TRANSIENT_RING_SIZE));
+		// the global descriptors point at the buffer, not into it
+		VkDescriptorBufferInfo camera_buffer_info{mTransientBuffer.handle, 0,
+												  sizeof(CameraData)};
+		VkDescriptorBufferInfo scene_buffer_info{mTransientBuffer.handle, 0,
+												 sizeof(SceneData)};
+		ArrayList<VkWriteDescriptorSet> writes{};
+		for (FrameData& frame : mFrames) {
+			writes.push_back(builder::write_descriptor_buffer(
+				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				frame.global_descriptor, &camera_buffer_info, 0));
+			writes.push_back(builder::write_descriptor_buffer(
+				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				frame.global_descriptor, &scene_buffer_info, 1));
+		}
+		vkUpdateDescriptorSets(mDevice.logical_device(), writes.size(),
+							   writes.data(), 0, nullptr);
+	}
+
 	void VulkanRenderer::init_descriptors() {
 		mDescriptorAllocatorPool = {mDevice};
 		mDescriptorLayoutCache = {mDevice};
 		mMainDescriptorAllocator = mDescriptorAllocatorPool.get_allocator(0);
-		const size_t scene_param_buffer_size =
-			MAXIMUM_FRAMES_IN_FLIGHT * pad_uniform_buffer(sizeof(SceneData));
-		mScene = {mDevice.allocator(), scene_param_buffer_size, {}};
+		create_transient_buffer(TRANSIENT_RING_SIZE);
 		{
 			for (int i = 0; i < MAXIMUM_FRAMES_IN_FLIGHT; ++i) {
 				{
-					mFrames[i].camera_buffer = {
-						mDevice.allocator(), sizeof(CameraData),
-						VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-						VMA_MEMORY_USAGE_CPU_TO_GPU};
+					// camera and scene data move around inside the ring,
+					// they are found through the dynamic offsets
 					VkDescriptorBufferInfo camera_buffer_info{
-						mFrames[i].camera_buffer.handle, 0, sizeof(CameraData)};
-					VkDescriptorBufferInfo scene_buffer_info =
-						mScene.buffer_info(0);
+						mTransientBuffer.handle, 0, sizeof(CameraData)};
+					VkDescriptorBufferInfo scene_buffer_info{
+						mTransientBuffer.handle, 0, sizeof(SceneData)};
 					builder::DescriptorSetBuilder builder{
 						mDevice, &mDescriptorLayoutCache,
 						&mMainDescriptorAllocator};
 					mFrames[i].global_descriptor = std::move(
 						builder
-							.add_buffer(0, &camera_buffer_info,
-										VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-										VK_SHADER_STAGE_VERTEX_BIT)
+							.add_buffer(
+								0, &camera_buffer_info,
+								VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+								VK_SHADER_STAGE_VERTEX_BIT)
 							.add_buffer(
 								1, &scene_buffer_info,
 								VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
@@ -561,18 +717,21 @@ namespace render::vulkan {
 					mFrames[i].object_buffer = {
 						mDevice.allocator(), sizeof(ObjectData) * MAX_OBJECTS,
 						VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-						VMA_MEMORY_USAGE_CPU_TO_GPU};
+						VMA_MEMORY_USAGE_CPU_TO_GPU,
+						VMA_ALLOCATION_CREATE_MAPPED_BIT};
 					VkDescriptorBufferInfo object_buffer_info{
 						mFrames[i].object_buffer.handle, 0,
 						sizeof(ObjectData) * MAX_OBJECTS};
 					builder::DescriptorSetBuilder builder{
 						mDevice, &mDescriptorLayoutCache,
 						&mMainDescriptorAllocator};
+					// the culling pass reads the matrices too
 					mFrames[i].object_descriptor = std::move(
 						builder
 							.add_buffer(0, &object_buffer_info,
 										VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-										VK_SHADER_STAGE_VERTEX_BIT)
+										VK_SHADER_STAGE_VERTEX_BIT |
+											VK_SHADER_STAGE_COMPUTE_BIT)
 							.build()
 							.value());
 					mObjectsDescriptorSetLayout = builder.layout();
@@ -753,7 +912,7 @@ namespace render::vulkan {
 			upload_mesh(skybox);
 			add_material_to_mesh(material, skybox);
 		}
-		mScene.scene_data.ambient_color = {0.7f, 0.4f, 0.1f, 0.f};
+		mSceneData.ambient_color = {0.7f, 0.4f, 0.1f, 0.f};
 	}
 
 	void VulkanRenderer::add_material_to_mesh(const Material& material,
@@ -1,5 +1,9 @@
 #include "render/vulkan/scene.h"
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
+#include "core/radix_sort.h"
+#include "render/vulkan/depth_pyramid.h"
 #include "render/vulkan/pipeline.h"
 #include "render/vulkan/renderer.h"
 #include "render/vulkan/types.h"
@@ -7,40 +11,16 @@
 #include <tiny_gltf.h>
 
 namespace render::vulkan {
-
-	Scene::Scene(VmaAllocator allocator, size_t buffer_size, SceneData data) :
-		mBufferSize(buffer_size), scene_data(data), mAllocator(allocator) {
-		mSceneDataBuffer =
-			Buffer(allocator, buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				   VMA_MEMORY_USAGE_CPU_TO_GPU);
-	}
-
-	void Scene::destroy() { mSceneDataBuffer.destroy(); }
-
-	void Scene::write_to_buffer(size_t offset) {
-
-		char* p_scene_data;
-		vmaMapMemory(mAllocator, mSceneDataBuffer.memory,
-					 (void**)&p_scene_data);
-		p_scene_data += offset;
-		memcpy(p_scene_data, &scene_data, sizeof(SceneData));
-		vmaUnmapMemory(mAllocator, mSceneDataBuffer.memory);
-	}
-
-	void Scene::write_to_buffer(size_t offset, SceneData data) {
-		char* p_scene_data;
-		vmaMapMemory(mAllocator, mSceneDataBuffer.memory,
-					 (void**)&p_scene_data);
-		p_scene_data += offset;
-		memcpy(p_scene_data, &data, sizeof(SceneData));
-		vmaUnmapMemory(mAllocator, mSceneDataBuffer.memory);
-	}
-
-	VkDescriptorBufferInfo Scene::buffer_info(size_t offset) {
-		return {mSceneDataBuffer.handle, offset, sizeof(SceneData)};
-	}
+	// draw lists are copied into indirect buffers as they are
+	static_assert(sizeof(DrawCommand) == sizeof(VkDrawIndexedIndirectCommand));
 
 	static u32 transform_index{0};
+	// local_size_x of frustum_cull.comp.glsl
+	constexpr u32 CULL_GROUP_SIZE = 64;
+	// bit offsets of the draw sort key's fields, the first index fills the
+	// bits below the texture set
+	constexpr u32 SORT_PIPELINE_SHIFT = 56;
+	constexpr u32 SORT_TEXTURE_SHIFT = 32;
 	//GLTFModel::GLTFModel(std::filesystem::path file, Device* device,
 	//					 VulkanRenderer* renderer) :
 	//	renderer(renderer),
@@ -115,40 +95,13 @@ namespace render::vulkan {
 			const tinygltf::Node node = scene.input->nodes[node_id];
 			load_node(&node, scene.input, nullptr, index_buffer, vertex_buffer);
 		}
-		const size_t vertex_buf_size = vertex_buffer.size() * sizeof(Vertex);
-		const size_t index_buf_size = index_buffer.size() * sizeof(u32);
-		Buffer vertex_staging{mDevice->allocator(), vertex_buf_size,
-							  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-							  VMA_MEMORY_USAGE_CPU_ONLY};
-		void* vertex_data;
-		vmaMapMemory(mDevice->allocator(), vertex_staging.memory, &vertex_data);
-		memcpy(vertex_data, vertex_buffer.data(), vertex_buf_size);
-		vmaUnmapMemory(mDevice->allocator(), vertex_staging.memory);
-		mVertexBuffer = {mDevice->allocator(), vertex_buf_size,
-						 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-							 VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-						 VMA_MEMORY_USAGE_GPU_ONLY};
-		Buffer index_staging{mDevice->allocator(), index_buf_size,
-							 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-							 VMA_MEMORY_USAGE_CPU_ONLY};
-		void* index_data;
-		vmaMapMemory(mDevice->allocator(), index_staging.memory, &index_data);
-		memcpy(index_data, index_buffer.data(), index_buf_size);
-		vmaUnmapMemory(mDevice->allocator(), index_staging.memory);
-		mIndexBuffer = {mDevice->allocator(), index_buf_size,
-						VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
-							VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-						VMA_MEMORY_USAGE_GPU_ONLY};
-		renderer->immediate_submit([=, this](VkCommandBuffer cmd) {
-			VkBufferCopy vertex_copy{0, 0, vertex_buf_size};
-			vkCmdCopyBuffer(cmd, vertex_staging.handle, mVertexBuffer.handle, 1,
-							&vertex_copy);
-			VkBufferCopy index_copy{0, 0, index_buf_size};
-			vkCmdCopyBuffer(cmd, index_staging.handle, mIndexBuffer.handle, 1,
-							&index_copy);
-		});
-		vertex_staging.destroy();
-		index_staging.destroy();
+		mVertexBuffer = upload_buffer(vertex_buffer.data(),
+									  vertex_buffer.size() * sizeof(Vertex),
+									  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		mIndexBuffer = upload_buffer(index_buffer.data(),
+									 index_buffer.size() * sizeof(u32),
+									 VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+		build_draw_commands();
 	}
 
 	GLTFModel::GLTFModel(GLTFModel&& other) noexcept :
@@ -160,7 +113,15 @@ namespace render::vulkan {
 		images = std::move(other.images);
 		mVertexBuffer = std::move(other.mVertexBuffer);
 		mIndexBuffer = std::move(other.mIndexBuffer);
+		mDrawCommands = std::move(other.mDrawCommands);
+		mCullBuffer = std::move(other.mCullBuffer);
+		mVisibility = std::move(other.mVisibility);
+		mCuller = std::move(other.mCuller);
+		mCullFrames = std::move(other.mCullFrames);
+		mCullLayout = other.mCullLayout;
+		mCullPipeline = other.mCullPipeline;
 		mDefaultMaterial = std::move(other.mDefaultMaterial);
+		mTexturedMaterial = std::move(other.mTexturedMaterial);
 		other.mDevice = nullptr;
 		other.mLifetime = ObjectLifetime::TEMP;
 		other.renderer = nullptr;
@@ -177,7 +138,15 @@ namespace render::vulkan {
 		images = std::move(other.images);
 		mVertexBuffer = std::move(other.mVertexBuffer);
 		mIndexBuffer = std::move(other.mIndexBuffer);
+		mDrawCommands = std::move(other.mDrawCommands);
+		mCullBuffer = std::move(other.mCullBuffer);
+		mVisibility = std::move(other.mVisibility);
+		mCuller = std::move(other.mCuller);
+		mCullFrames = std::move(other.mCullFrames);
+		mCullLayout = other.mCullLayout;
+		mCullPipeline = other.mCullPipeline;
 		mDefaultMaterial = std::move(other.mDefaultMaterial);
+		mTexturedMaterial = std::move(other.mTexturedMaterial);
 		other.mDevice = nullptr;
 		other.mLifetime = ObjectLifetime::TEMP;
 		other.renderer = nullptr;
@@ -187,123 +156,362 @@ namespace render::vulkan {
 	GLTFModel::~GLTFModel() {
 		if (mLifetime == ObjectLifetime::TEMP)
 			return;
-		for (auto& material : materials) {
-			vkDestroyPipelineLayout(mDevice->logical_device(), material.layout,
-									nullptr);
-			vkDestroyPipeline(mDevice->logical_device(), material.pipeline,
+		// the materials only hold copies of these two
+		for (Material* material : {&mDefaultMaterial, &mTexturedMaterial}) {
+			vkDestroyPipelineLayout(mDevice->logical_device(),
+									material->layout, nullptr);
+			vkDestroyPipeline(mDevice->logical_device(), material->pipeline,
 							  nullptr);
 		}
-		vkDestroyPipelineLayout(mDevice->logical_device(),
-								mDefaultMaterial.layout, nullptr);
-		vkDestroyPipeline(mDevice->logical_device(), mDefaultMaterial.pipeline,
-						  nullptr);
 		mVertexBuffer.destroy();
 		mIndexBuffer.destroy();
+		destroy_culling();
+		if (mCullPipeline) {
+			vkDestroyPipeline(mDevice->logical_device(), mCullPipeline,
+							  nullptr);
+			vkDestroyPipelineLayout(mDevice->logical_device(), mCullLayout,
+									nullptr);
+		}
 	}
 
-	void GLTFModel::update(ObjectData* object_ssbo) {
-		int ssbo_index{0};
-		for (Node* node : nodes) {
-			update_node(object_ssbo, ssbo_index, node);
+	void GLTFModel::cull(VkCommandBuffer buf, const FrameData& frame_data,
+						 u32 frame, const CullView& view,
+						 const DepthPyramid& pyramid, CullPhase phase) {
+		if (mCullFrames.empty()) {
+			return;
+		}
+		const CullFrame& cull = mCullFrames[frame];
+		if (phase != CullPhase::LATE) {
+			// the late phase adds to the counts of the early one
+			vkCmdFillBuffer(buf, cull.counts.handle, 0, VK_WHOLE_SIZE, 0);
 		}
+		// the counts are cleared and the last pass is done with the
+		// visibility
+		VkMemoryBarrier cleared{
+			VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr,
+			VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+		vkCmdPipelineBarrier(buf,
+							 VK_PIPELINE_STAGE_TRANSFER_BIT |
+								 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+							 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+							 &cleared, 0, nullptr, 0, nullptr);
+		vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, mCullPipeline);
+		VkDescriptorSet sets[]{cull.set, frame_data.object_descriptor,
+							   pyramid.read_set()};
+		vkCmdBindDescriptorSets(buf, VK_PIPELINE_BIND_POINT_COMPUTE,
+								mCullLayout, 0, 3, sets, 0, nullptr);
+		// the side planes of a symmetric frustum mirror each other, the
+		// shader tests against the absolute view space x and y
+		const f32 p00 = view.projection[0][0];
+		const f32 p11 = std::abs(view.projection[1][1]);
+		const f32 x_length = std::sqrt(p00 * p00 + 1.f);
+		const f32 y_length = std::sqrt(p11 * p11 + 1.f);
+		// the most push constants every device has to take
+		static_assert(sizeof(CullConstants) <= 128);
+		CullConstants constants{};
+		constants.view = view.view;
+		constants.frustum = {p00 / x_length, 1.f / x_length, p11 / y_length,
+							 1.f / y_length};
+		constants.projection = {view.projection[0][0], view.projection[1][1],
+								view.projection[2][2], view.projection[3][2]};
+		constants.depth_size = {pyramid.extent().width,
+								pyramid.extent().height};
+		constants.near_plane = view.near_plane;
+		constants.far_plane = view.far_plane;
+		constants.command_count = mCuller.size();
+		constants.batch_count = mCuller.batches().size();
+		constants.phase = static_cast<u32>(phase);
+		vkCmdPushConstants(buf, mCullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+						   sizeof(CullConstants), &constants);
+		vkCmdDispatch(buf, (mCuller.size() + CULL_GROUP_SIZE - 1) /
+							   CULL_GROUP_SIZE,
+					  1, 1);
+		VkMemoryBarrier culled{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr,
+							   VK_ACCESS_SHADER_WRITE_BIT,
+							   VK_ACCESS_INDIRECT_COMMAND_READ_BIT};
+		vkCmdPipelineBarrier(buf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+							 VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1,
+							 &culled, 0, nullptr, 0, nullptr);
 	}
 
-	void GLTFModel::update_node(ObjectData* ssbo, int& ssbo_index, Node* node) {
-		if (!node->visible) {
-			// TODO: move it way behind camera so that it's culled
+	void GLTFModel::draw(VkCommandBuffer buf, FrameData& frame_data,
+						 u32 frame, CullPhase phase) {
+		if (mCullFrames.empty()) {
 			return;
 		}
-		if (node->mesh.primitives.size() > 0) {
-			glm::mat4 node_matrix = node->matrix;
-			Node* current_parent = node->parent;
-			// Traverse up to find final matrix
-			while (current_parent) {
-				node_matrix = current_parent->matrix * node_matrix;
-				current_parent = current_parent->parent;
-			}
-			// NOTE: this is potentially wrong, gl_InstanceIndex might be off
-			ssbo[ssbo_index].model_matrix = node->matrix;
-			ssbo_index++;
-		}
-		for (Node* child : node->children) {
-			update_node(ssbo, ssbo_index, child);
+		const CullFrame& cull = mCullFrames[frame];
+		const bool late = phase == CullPhase::LATE;
+		const u32 first_command = late ? mCuller.size() : 0;
+		const u32 first_count = late ? mCuller.batches().size() : 0;
+		VkDeviceSize offsets[1] = {};
+		vkCmdBindVertexBuffers(buf, 0, 1, &mVertexBuffer.handle, offsets);
+		vkCmdBindIndexBuffer(buf, mIndexBuffer.handle, 0, VK_INDEX_TYPE_UINT32);
+		// one multi draw per bind state, however many primitives
+		const ArrayList<DrawBatch>& batches = mCuller.batches();
+		BindState bound{};
+		for (u32 i = 0; i < batches.size(); ++i) {
+			const DrawBatch& batch = batches[i];
+			bind_material(buf, frame_data, batch.material_index, bound);
+			// the culling pass packed the batch's visible draws at its start
+			vkCmdDrawIndexedIndirectCount(
+				buf, cull.commands.handle,
+				(first_command + batch.first_command) * sizeof(DrawCommand),
+				cull.counts.handle, (first_count + i) * sizeof(u32),
+				batch.command_count, sizeof(DrawCommand));
 		}
 	}
 
-	void GLTFModel::draw(VkCommandBuffer buf, ObjectData* object_ssbo,
-						 FrameData& frame_data, u32 uniform_offset) {
+	void GLTFModel::cull(const gameplay::Frustum& frustum,
+						 std::span<const glm::mat4> world,
+						 core::ThreadPool& pool) {
+		mCuller.cull(frustum, world, pool);
+	}
+
+	void GLTFModel::draw(VkCommandBuffer buf, FrameData& frame_data,
+						 VkBuffer commands, VkDeviceSize offset) {
+		if (mCuller.visible_batches().empty()) {
+			return;
+		}
 		VkDeviceSize offsets[1] = {};
 		vkCmdBindVertexBuffers(buf, 0, 1, &mVertexBuffer.handle, offsets);
 		vkCmdBindIndexBuffer(buf, mIndexBuffer.handle, 0, VK_INDEX_TYPE_UINT32);
-		int ssbo_index{0};
-		for (auto& node : nodes) {
-			draw_node(buf, object_ssbo, ssbo_index, node, frame_data,
-					  uniform_offset);
+		// batches without a visible draw were already dropped
+		BindState bound{};
+		for (const DrawBatch& batch : mCuller.visible_batches()) {
+			bind_material(buf, frame_data, batch.material_index, bound);
+			vkCmdDrawIndexedIndirect(
+				buf, commands,
+				offset + batch.first_command * sizeof(DrawCommand),
+				batch.command_count, sizeof(DrawCommand));
 		}
 	}
 
-	void GLTFModel::draw_node(VkCommandBuffer buf, ObjectData* ssbo,
-							  int& ssbo_index, Node* node,
-							  FrameData& frame_data, u32 uniform_offset) {
-		if (!node->visible) {
-			// TODO: move it way behind camera so that it's culled
-			return;
+	void GLTFModel::bind_material(VkCommandBuffer buf, FrameData& frame_data,
+								  s32 material_index, BindState& bound) {
+		const Material& material =
+			material_index >= 0 ? materials[material_index] : mDefaultMaterial;
+		if (bound.pipeline == VK_NULL_HANDLE) {
+			// both pipeline layouts start with the same global and object
+			// sets, they stay bound across pipeline changes
+			VkDescriptorSet sets[]{frame_data.global_descriptor,
+								   frame_data.object_descriptor};
+			vkCmdBindDescriptorSets(buf, VK_PIPELINE_BIND_POINT_GRAPHICS,
+									material.layout, 0, 2, sets,
+									GLOBAL_DYNAMIC_OFFSETS,
+									frame_data.global_offsets);
 		}
-		if (node->mesh.primitives.size() > 0) {
-			Material* current_material{nullptr};
-			for (Primitive& primitive : node->mesh.primitives) {
-				if (primitive.index_count > 0) {
-					if (primitive.material_index >= 0) {
-						Material& material =
-							materials[primitive.material_index];
-						if (current_material != &material) {
-							current_material = &material;
-							vkCmdBindPipeline(buf,
-											  VK_PIPELINE_BIND_POINT_GRAPHICS,
-											  material.pipeline);
-							vkCmdBindDescriptorSets(
-								buf, VK_PIPELINE_BIND_POINT_GRAPHICS,
-								material.layout, 0, 1,
-								&frame_data.global_descriptor, 1,
-								&uniform_offset);
-							vkCmdBindDescriptorSets(
-								buf, VK_PIPELINE_BIND_POINT_GRAPHICS,
-								material.layout, 1, 1,
-								&frame_data.object_descriptor, 0, nullptr);
-							if (material.texture_set != nullptr) {
-								vkCmdBindDescriptorSets(
-									buf, VK_PIPELINE_BIND_POINT_GRAPHICS,
+		if (material.pipeline != bound.pipeline) {
+			vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_GRAPHICS,
+							  material.pipeline);
+			bound.pipeline = material.pipeline;
+			// the texture set was bound with the other layout
+			bound.texture_set = VK_NULL_HANDLE;
+		}
+		if (material.texture_set != VK_NULL_HANDLE &&
+			material.texture_set != bound.texture_set) {
+			vkCmdBindDescriptorSets(buf, VK_PIPELINE_BIND_POINT_GRAPHICS,
 									material.layout, 2, 1,
 									&material.texture_set, 0, nullptr);
-							}
-						}
-					} else {
-						current_material = &mDefaultMaterial;
-						vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_GRAPHICS,
-										  mDefaultMaterial.pipeline);
-						vkCmdBindDescriptorSets(
-							buf, VK_PIPELINE_BIND_POINT_GRAPHICS,
-							mDefaultMaterial.layout, 0, 1,
-							&frame_data.global_descriptor, 1, &uniform_offset);
-						vkCmdBindDescriptorSets(
-							buf, VK_PIPELINE_BIND_POINT_GRAPHICS,
-							mDefaultMaterial.layout, 1, 1,
-							&frame_data.object_descriptor, 0, nullptr);
-					}
-					MeshPushConstant constant;
-					constant.id = ssbo_index;
-					ssbo_index++;
-					vkCmdPushConstants(buf, current_material->layout,
-									   VK_SHADER_STAGE_VERTEX_BIT, 0,
-									   sizeof(MeshPushConstant), &constant);
-					vkCmdDrawIndexed(buf, primitive.index_count, 1,
-									 primitive.first_index, 0, 0);
+			bound.texture_set = material.texture_set;
+		}
+	}
+
+	void GLTFModel::build_draw_commands() {
+		ArrayList<IndirectDraw> draws{};
+		for (Node* node : nodes) {
+			collect_draws(node, draws);
+		}
+		// only rebuilt when the visible nodes change, the draws stay sorted
+		// by bind state in between
+		ArrayList<u64> keys(draws.size());
+		ArrayList<u32> order(draws.size());
+		for (u32 i = 0; i < draws.size(); ++i) {
+			keys[i] = sort_key(draws[i]);
+			order[i] = i;
+		}
+		core::radix_sort(keys, order);
+		ArrayList<DrawCommand> commands(draws.size());
+		ArrayList<glm::vec4> bounds(draws.size());
+		ArrayList<CullData> cull_data(draws.size());
+		ArrayList<DrawBatch> batches{};
+		u64 batch_state{};
+		for (u32 i = 0; i < draws.size(); ++i) {
+			const IndirectDraw& draw = draws[order[i]];
+			commands[i] = draw.command;
+			bounds[i] = draw.bounds;
+			const u64 state = keys[i] >> SORT_TEXTURE_SHIFT;
+			if (batches.empty() || state != batch_state) {
+				batches.push_back({draw.material_index, i, 0});
+				batch_state = state;
+			}
+			++batches.back().command_count;
+			cull_data[i] = {draw.bounds, static_cast<u32>(batches.size() - 1),
+							batches.back().first_command};
+		}
+		if (mCuller.size() > 0) {
+			// the frames in flight may still draw from the old buffers
+			mDevice->wait_idle();
+		}
+		destroy_culling();
+		mCuller.assign(commands, bounds, batches);
+		// the CPU path copies up to every command into the transient ring
+		renderer->reserve_transient(mCuller.size());
+		// without drawIndirectCount only the CPU path can draw
+		if (!commands.empty() && mDevice->draw_indirect_count()) {
+			init_culling(commands, cull_data);
+		}
+	}
+
+	void GLTFModel::init_culling(const ArrayList<DrawCommand>& commands,
+								 ArrayList<CullData>& cull_data) {
+		const size_t commands_size = commands.size() * sizeof(DrawCommand);
+		mDrawCommands = upload_buffer(commands.data(), commands_size,
+									  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		mCullBuffer = upload_buffer(cull_data.data(),
+									cull_data.size() * sizeof(CullData),
+									VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		// nothing was visible last frame, the first late phase tests all
+		const ArrayList<u32> hidden(commands.size(), 0);
+		const size_t visibility_size = hidden.size() * sizeof(u32);
+		mVisibility = upload_buffer(hidden.data(), visibility_size,
+									VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		const size_t counts_size = mCuller.batches().size() * sizeof(u32);
+		VkDescriptorSetLayout set_layout{};
+		mCullFrames.resize(MAXIMUM_FRAMES_IN_FLIGHT);
+		for (CullFrame& frame : mCullFrames) {
+			// room for both the early and the late phase
+			frame.commands = {mDevice->allocator(), commands_size * 2,
+							  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+								  VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+							  VMA_MEMORY_USAGE_GPU_ONLY};
+			frame.counts = {mDevice->allocator(), counts_size * 2,
+							VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+								VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+								VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+							VMA_MEMORY_USAGE_GPU_ONLY};
+			VkDescriptorBufferInfo commands_info{mDrawCommands.handle, 0,
+												 commands_size};
+			VkDescriptorBufferInfo cull_info{
+				mCullBuffer.handle, 0, cull_data.size() * sizeof(CullData)};
+			VkDescriptorBufferInfo visible_info{frame.commands.handle, 0,
+												commands_size * 2};
+			VkDescriptorBufferInfo counts_info{frame.counts.handle, 0,
+											   counts_size * 2};
+			VkDescriptorBufferInfo visibility_info{mVisibility.handle, 0,
+												   visibility_size};
+			builder::DescriptorSetBuilder builder{
+				renderer->device(), &renderer->descriptor_layout_cache(),
+				&renderer->main_descriptor_allocator()};
+			frame.set = std::move(
+				builder
+					.add_buffer(0, &commands_info,
+								VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+								VK_SHADER_STAGE_COMPUTE_BIT)
+					.add_buffer(1, &cull_info,
+								VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+								VK_SHADER_STAGE_COMPUTE_BIT)
+					.add_buffer(2, &visible_info,
+								VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+								VK_SHADER_STAGE_COMPUTE_BIT)
+					.add_buffer(3, &counts_info,
+								VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+								VK_SHADER_STAGE_COMPUTE_BIT)
+					.add_buffer(4, &visibility_info,
+								VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+								VK_SHADER_STAGE_COMPUTE_BIT)
+					.build()
+					.value());
+			set_layout = builder.layout();
+		}
+		if (mCullPipeline) {
+			return;
+		}
+		builder::PipelineBuilder builder;
+		builder
+			.add_shader_module(renderer->shader_cache().get_shader(
+								   "assets/shaders/"
+								   "frustum_cull.comp.glsl.spv"),
+							   ShaderType::COMPUTE)
+			.add_push_constant(sizeof(CullConstants),
+							   VK_SHADER_STAGE_COMPUTE_BIT)
+			.add_descriptor_set_layout(set_layout)
+			.add_descriptor_set_layout(renderer->objects_descriptor_layout())
+			.add_descriptor_set_layout(renderer->depth_pyramid().read_layout());
+		mCullLayout = builder.build_layout(mDevice->logical_device());
+		mCullPipeline =
+			builder.build_compute_pipeline(mDevice->logical_device());
+	}
+
+	void GLTFModel::destroy_culling() {
+		for (CullFrame& frame : mCullFrames) {
+			frame.commands.destroy();
+			frame.counts.destroy();
+		}
+		mCullFrames.clear();
+		mCullBuffer.destroy();
+		mVisibility.destroy();
+		mDrawCommands.destroy();
+	}
+
+	void GLTFModel::collect_draws(Node* node, ArrayList<IndirectDraw>& draws) {
+		if (!node->visible) {
+			// hidden nodes drop out when the draw list is rebuilt
+			return;
+		}
+		// the object buffer only holds the first MAX_OBJECTS transforms
+		if (node->transform_index < MAX_OBJECTS) {
+			for (const Primitive& primitive : node->mesh.primitives) {
+				if (primitive.index_count == 0) {
+					continue;
 				}
+				// firstInstance is the node's transform, the shaders read
+				// their matrix through gl_InstanceIndex
+				draws.push_back({primitive.material_index,
+								 {primitive.index_count, 1,
+								  primitive.first_index, 0,
+								  node->transform_index},
+								 primitive.bounds});
 			}
 		}
-		for (auto& child : node->children) {
-			draw_node(buf, ssbo, ssbo_index, child, frame_data, uniform_offset);
+		for (Node* child : node->children) {
+			collect_draws(child, draws);
+		}
+	}
+
+	u64 GLTFModel::sort_key(const IndirectDraw& draw) const {
+		// draws of the same primitive end up next to each other
+		const u64 key = draw.command.first_index;
+		if (draw.material_index < 0 ||
+			materials[draw.material_index].texture_set == VK_NULL_HANDLE) {
+			// the default pipeline sorts first
+			return key;
 		}
+		const Material& material = materials[draw.material_index];
+		const u64 image =
+			textures[material.base_color_texture_index].image_index;
+		return key | (1ull << SORT_PIPELINE_SHIFT) |
+			((image + 1) << SORT_TEXTURE_SHIFT);
+	}
+
+	Buffer GLTFModel::upload_buffer(const void* data, size_t size,
+									VkBufferUsageFlags usage) {
+		Buffer staging{mDevice->allocator(), size,
+					   VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+					   VMA_MEMORY_USAGE_CPU_ONLY};
+		void* staging_data;
+		vmaMapMemory(mDevice->allocator(), staging.memory, &staging_data);
+		memcpy(staging_data, data, size);
+		vmaUnmapMemory(mDevice->allocator(), staging.memory);
+		Buffer buffer{mDevice->allocator(), size,
+					  usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+					  VMA_MEMORY_USAGE_GPU_ONLY};
+		renderer->immediate_submit([=](VkCommandBuffer cmd) {
+			VkBufferCopy copy{0, 0, size};
+			vkCmdCopyBuffer(cmd, staging.handle, buffer.handle, 1, &copy);
+		});
+		staging.destroy();
+		return buffer;
 	}
 
 	void GLTFModel::load_images(tinygltf::Model* in) {
@@ -342,43 +550,9 @@ namespace render::vulkan {
 	}
 
 	void GLTFModel::load_materials(tinygltf::Model* in) {
-		{ // default material
-			builder::PipelineBuilder builder;
-			builder.set_vertex_input_description(Vertex::get_description())
-				.add_shader_module(renderer->shader_cache().get_shader(
-									   "assets/shaders/"
-									   "default_shader.vert.glsl.spv"),
-								   ShaderType::VERTEX)
-				.add_shader_module(renderer->shader_cache().get_shader(
-									   "assets/shaders/"
-									   "default_shader.frag.glsl.spv"),
-								   ShaderType::FRAGMENT)
-				.set_input_assembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, false)
-				.set_polygon_mode(VK_POLYGON_MODE_FILL)
-				.set_cull_mode(VK_CULL_MODE_BACK_BIT,
-							   VK_FRONT_FACE_COUNTER_CLOCKWISE)
-				.set_multisampling_enabled(false)
-				.add_default_color_blend_attachment()
-				.set_color_blending_enabled(false)
-				.add_push_constant(sizeof(MeshPushConstant),
-								   VK_SHADER_STAGE_VERTEX_BIT)
-				.add_descriptor_set_layout(renderer->global_descriptor_layout())
-				.add_descriptor_set_layout(
-					renderer->objects_descriptor_layout())
-				.set_depth_testing(true, true, VK_COMPARE_OP_LESS_OR_EQUAL)
-				.add_dynamic_state(VK_DYNAMIC_STATE_VIEWPORT)
-				.add_dynamic_state(VK_DYNAMIC_STATE_SCISSOR)
-				// .add_dynamic_state(VK_DYNAMIC_STATE_LINE_WIDTH)
-				.add_viewport(
-					{0, 0, static_cast<float>(renderer->window_extent().width),
-					 static_cast<float>(renderer->window_extent().height), 0.f,
-					 1.f})
-				.add_scissor({{0, 0}, renderer->window_extent()});
-			mDefaultMaterial.layout =
-				builder.build_layout(mDevice->logical_device());
-			mDefaultMaterial.pipeline = builder.build_pipeline(
-				mDevice->logical_device(), renderer->render_pass());
-		}
+		// materials only differ in their texture set, sharing two pipelines
+		// lets sorted draws skip most binds
+		mDefaultMaterial = create_material(VK_NULL_HANDLE);
 		tinygltf::Model& input = *in;
 		materials.resize(input.materials.size());
 		for (int i = 0; i < input.materials.size(); ++i) {
@@ -387,67 +561,67 @@ namespace render::vulkan {
 				materials[i].base_color_factor = glm::make_vec4(
 					mat.values["baseColorFactor"].ColorFactor().data());
 			}
-			builder::PipelineBuilder builder;
-			builder.set_vertex_input_description(Vertex::get_description())
-				.set_input_assembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, false)
-				.set_polygon_mode(VK_POLYGON_MODE_FILL)
-				.set_cull_mode(VK_CULL_MODE_BACK_BIT,
-							   VK_FRONT_FACE_COUNTER_CLOCKWISE)
-				.set_multisampling_enabled(false)
-				.add_default_color_blend_attachment()
-				.set_color_blending_enabled(false)
-				.add_push_constant(sizeof(MeshPushConstant),
-								   VK_SHADER_STAGE_VERTEX_BIT)
-				.add_descriptor_set_layout(renderer->global_descriptor_layout())
-				.add_descriptor_set_layout(
-					renderer->objects_descriptor_layout())
-				.set_depth_testing(true, true, VK_COMPARE_OP_LESS_OR_EQUAL)
-				.add_dynamic_state(VK_DYNAMIC_STATE_VIEWPORT)
-				.add_dynamic_state(VK_DYNAMIC_STATE_SCISSOR)
-				// .add_dynamic_state(VK_DYNAMIC_STATE_LINE_WIDTH)
-				.add_viewport(
-					{0, 0, static_cast<float>(renderer->window_extent().width),
-					 static_cast<float>(renderer->window_extent().height), 0.f,
-					 1.f})
-				.add_scissor({{0, 0}, renderer->window_extent()});
 			if (mat.values.find("baseColorTexture") != mat.values.end()) {
 				s32 base_color_texture_index =
 					mat.values["baseColorTexture"].TextureIndex();
+				const gltfImage& image =
+					images[textures[base_color_texture_index].image_index];
+				// the layout cache hands every image the same set layout
+				if (!mTexturedMaterial.pipeline) {
+					mTexturedMaterial = create_material(image.layout);
+				}
 				materials[i].base_color_texture_index =
 					base_color_texture_index;
-				materials[i].texture_set =
-					images[textures[base_color_texture_index].image_index].set;
-				VkDescriptorSetLayout set_layout =
-					images[textures[base_color_texture_index].image_index]
-						.layout;
-				builder
-					.add_shader_module(renderer->shader_cache().get_shader(
-										   "assets/shaders/"
-										   "textured_mesh.vert.glsl.spv"),
-									   ShaderType::VERTEX)
-					.add_shader_module(renderer->shader_cache().get_shader(
-										   "assets/shaders/"
-										   "textured_mesh.frag.glsl.spv"),
-									   ShaderType::FRAGMENT)
-					.add_descriptor_set_layout(set_layout);
+				materials[i].texture_set = image.set;
+				materials[i].layout = mTexturedMaterial.layout;
+				materials[i].pipeline = mTexturedMaterial.pipeline;
 			} else {
-				builder
-					.add_shader_module(renderer->shader_cache().get_shader(
-										   "assets/shaders/"
-										   "default_shader.vert.glsl.spv"),
-									   ShaderType::VERTEX)
-					.add_shader_module(renderer->shader_cache().get_shader(
-										   "assets/shaders/"
-										   "default_shader.frag.glsl.spv"),
-									   ShaderType::FRAGMENT);
+				materials[i].layout = mDefaultMaterial.layout;
+				materials[i].pipeline = mDefaultMaterial.pipeline;
 			}
-			materials[i].layout =
-				builder.build_layout(mDevice->logical_device());
-			materials[i].pipeline = builder.build_pipeline(
-				mDevice->logical_device(), renderer->render_pass());
 		}
 	}
 
+	Material GLTFModel::create_material(VkDescriptorSetLayout texture_layout) {
+		const bool textured = texture_layout != VK_NULL_HANDLE;
+		const std::string shader = textured ? "assets/shaders/textured_mesh"
+											: "assets/shaders/default_shader";
+		builder::PipelineBuilder builder;
+		builder.set_vertex_input_description(Vertex::get_description())
+			.add_shader_module(
+				renderer->shader_cache().get_shader(shader + ".vert.glsl.spv"),
+				ShaderType::VERTEX)
+			.add_shader_module(
+				renderer->shader_cache().get_shader(shader + ".frag.glsl.spv"),
+				ShaderType::FRAGMENT)
+			.set_input_assembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, false)
+			.set_polygon_mode(VK_POLYGON_MODE_FILL)
+			.set_cull_mode(VK_CULL_MODE_BACK_BIT,
+						   VK_FRONT_FACE_COUNTER_CLOCKWISE)
+			.set_multisampling_enabled(false)
+			.add_default_color_blend_attachment()
+			.set_color_blending_enabled(false)
+			.add_descriptor_set_layout(renderer->global_descriptor_layout())
+			.add_descriptor_set_layout(renderer->objects_descriptor_layout())
+			.set_depth_testing(true, true, VK_COMPARE_OP_LESS_OR_EQUAL)
+			.add_dynamic_state(VK_DYNAMIC_STATE_VIEWPORT)
+			.add_dynamic_state(VK_DYNAMIC_STATE_SCISSOR)
+			// .add_dynamic_state(VK_DYNAMIC_STATE_LINE_WIDTH)
+			.add_viewport(
+				{0, 0, static_cast<float>(renderer->window_extent().width),
+				 static_cast<float>(renderer->window_extent().height), 0.f,
+				 1.f})
+			.add_scissor({{0, 0}, renderer->window_extent()});
+		if (textured) {
+			builder.add_descriptor_set_layout(texture_layout);
+		}
+		Material material{};
+		material.layout = builder.build_layout(mDevice->logical_device());
+		material.pipeline = builder.build_pipeline(mDevice->logical_device(),
+												   renderer->render_pass());
+		return material;
+	}
+
 	void GLTFModel::load_node(const tinygltf::Node* inNode,
 							  const tinygltf::Model* in, Node* parent,
 							  std::vector<uint32_t>& indexBuffer,
@@ -457,6 +631,8 @@ namespace render::vulkan {
 		Node* node = new Node{};
 		node->name = inputNode.name;
 		node->parent = parent;
+		// nodes are numbered in the same order core::Engine loads transforms
+		node->transform_index = transform_index++;
 
 		// Get the local node matrix
 		// It's either made up from translation, rotation, scale or a 4x4
@@ -583,6 +759,24 @@ namespace render::vulkan {
 						vertexBuffer.push_back(vert);
 					}
 				}
+				// bounding sphere around the middle of the vertices' box
+				glm::vec4 bounds{0.f};
+				if (vertexBuffer.size() > vertexStart) {
+					glm::vec3 min = vertexBuffer[vertexStart].position;
+					glm::vec3 max = min;
+					for (size_t v = vertexStart; v < vertexBuffer.size(); v++) {
+						min = glm::min(min, vertexBuffer[v].position);
+						max = glm::max(max, vertexBuffer[v].position);
+					}
+					const glm::vec3 center = (min + max) * 0.5f;
+					f32 radius = 0.f;
+					for (size_t v = vertexStart; v < vertexBuffer.size(); v++) {
+						const f32 distance =
+							glm::length(vertexBuffer[v].position - center);
+						radius = std::max(radius, distance);
+					}
+					bounds = glm::vec4{center, radius};
+				}
 				// Indices
 				{
 					const tinygltf::Accessor& accessor =
@@ -643,6 +837,7 @@ namespace render::vulkan {
 				primitive.first_index = firstIndex;
 				primitive.index_count = indexCount;
 				primitive.material_index = glTFPrimitive.material;
+				primitive.bounds = bounds;
 				node->mesh.primitives.push_back(primitive);
 			}
 		}
@@ -70,8 +70,10 @@ namespace render::vulkan {
 			VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 		mDepthAttachment = {
 			allocator, device.logical_device(),
+			// sampled by the depth pyramid downsample
 			builder::image_ci(mDepthFormat,
-							  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+							  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+								  VK_IMAGE_USAGE_SAMPLED_BIT,
 							  depthImageExtent),
 			imgAllocCi, VK_IMAGE_ASPECT_DEPTH_BIT};
 		VkFramebufferCreateInfo fb_ci =
@@ -151,7 +153,8 @@ namespace render::vulkan {
 		mDepthAttachment = {
 			allocator, device.logical_device(),
 			builder::image_ci(mDepthFormat,
-							  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+							  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+								  VK_IMAGE_USAGE_SAMPLED_BIT,
 							  depthImageExtent),
 			imgAllocCi, VK_IMAGE_ASPECT_DEPTH_BIT};
 	}
@@ -330,7 +333,8 @@ namespace render::vulkan {
 		mDepthAttachment = {
 			mAllocator, mDevice,
 			builder::image_ci(mDepthFormat,
-							  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+							  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+								  VK_IMAGE_USAGE_SAMPLED_BIT,
 							  depthImageExtent),
 			imgAllocCi, VK_IMAGE_ASPECT_DEPTH_BIT};
 		VkFramebufferCreateInfo fb_ci =
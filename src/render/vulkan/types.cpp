@@ -4,47 +4,67 @@
 namespace render::vulkan {
 
 	Buffer::Buffer(VmaAllocator alloc, size_t allocation_size,
-				   VkBufferUsageFlags usage, VmaMemoryUsage mem_usage) :
+				   VkBufferUsageFlags usage, VmaMemoryUsage mem_usage,
+				   VmaAllocationCreateFlags flags) :
 		mAlloc(alloc) {
 		VkBufferCreateInfo buffer_ci{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
 									 nullptr, 0, allocation_size, usage};
 		VmaAllocationCreateInfo vma_alloc_ci{};
 		vma_alloc_ci.usage = mem_usage;
+		vma_alloc_ci.flags = flags;
+		VmaAllocationInfo info{};
 		VK_CHECK(vmaCreateBuffer(mAlloc, &buffer_ci, &vma_alloc_ci, &handle,
-								 &memory, nullptr));
+								 &memory, &info));
+		mapped = info.pMappedData;
 	}
 
 	void Buffer::destroy() {
 		if (mAlloc && handle && memory) {
 			vmaDestroyBuffer(mAlloc, handle, memory);
 		}
+		// safe to destroy again, buffers are torn down on rebuilds too
+		handle = VK_NULL_HANDLE;
+		memory = nullptr;
+		mapped = nullptr;
+	}
+
+	void Buffer::flush(VkDeviceSize offset, VkDeviceSize size) const {
+		if (mAlloc && memory && size > 0) {
+			vmaFlushAllocation(mAlloc, memory, offset, size);
+		}
 	}
 
 	Buffer::Buffer(const Buffer& other) :
-		mAlloc(other.mAlloc), memory(other.memory), handle(other.handle) {}
+		mAlloc(other.mAlloc), memory(other.memory), handle(other.handle),
+		mapped(other.mapped) {}
 
 	Buffer& Buffer::operator=(const Buffer& other) {
 		mAlloc = other.mAlloc;
 		memory = other.memory;
 		handle = other.handle;
+		mapped = other.mapped;
 		return *this;
 	}
 	Buffer::Buffer(Buffer&& other) noexcept {
 		mAlloc = other.mAlloc;
 		memory = other.memory;
 		handle = other.handle;
+		mapped = other.mapped;
 		other.mAlloc = nullptr;
 		other.handle = nullptr;
 		other.memory = nullptr;
+		other.mapped = nullptr;
 	}
 
 	Buffer& Buffer::operator=(Buffer&& other) noexcept {
 		mAlloc = other.mAlloc;
 		memory = other.memory;
 		handle = other.handle;
+		mapped = other.mapped;
 		other.mAlloc = nullptr;
 		other.handle = nullptr;
 		other.memory = nullptr;
+		other.mapped = nullptr;
 		return *this;
 	}
 
@@ -0,0 +1,48 @@
+#include "render/vulkan/upload_ring.h"
+#include <algorithm>
+
+namespace render::vulkan {
+	UploadRing::UploadRing(void* mapped, u32 size, u32 frame_count) :
+		mData(static_cast<u8*>(mapped)), mSize(mapped ? size : 0),
+		mFrameEnds(frame_count, 0) {}
+
+	void UploadRing::begin_frame(u32 frame) {
+		// frames are recorded in order, so this was the oldest one in flight
+		// and everything up to its end is free again
+		mTail = std::max(mTail, mFrameEnds[frame]);
+		mCurrentFrame = frame;
+		mFrameStart = mHead;
+		mFrameEnds[frame] = mHead;
+	}
+
+	UploadRing::Allocation UploadRing::allocate(u32 size, u32 alignment) {
+		if (mSize == 0) {
+			return {};
+		}
+		u64 head = (mHead + alignment - 1) & ~(u64{alignment} - 1);
+		u64 position = head % mSize;
+		// allocations never straddle the end, skip to the start instead
+		if (position + size > mSize) {
+			head += mSize - position;
+			position = 0;
+		}
+		if (head + size - mTail > mSize) {
+			return {};
+		}
+		mHead = head + size;
+		mFrameEnds[mCurrentFrame] = mHead;
+		return {mData + position, static_cast<u32>(position)};
+	}
+
+	void UploadRing::frame_range(u32& offset, u32& size) const {
+		const u64 start = mFrameStart % (mSize ? mSize : 1);
+		const u64 length = mHead - mFrameStart;
+		if (start + length <= mSize) {
+			offset = static_cast<u32>(start);
+			size = static_cast<u32>(length);
+		} else {
+			offset = 0;
+			size = mSize;
+		}
+	}
+} // namespace render::vulkan
@@ -0,0 +1,47 @@
+#include "render/vulkan/upload_tracker.h"
+#include <algorithm>
+
+namespace render::vulkan {
+	UploadTracker::UploadTracker(u32 frame_count) : mQueues(frame_count) {}
+
+	void UploadTracker::push(std::span<const gameplay::TransformRange> changed,
+							 u32 object_count) {
+		if (object_count != mObjectCount) {
+			mObjectCount = object_count;
+			for (auto& queue : mQueues) {
+				queue.assign(1, {0, object_count});
+			}
+			return;
+		}
+		for (auto& queue : mQueues) {
+			if (queue.size() + changed.size() > MAX_QUEUED_RANGES) {
+				queue.assign(1, {0, object_count});
+			} else {
+				queue.insert(queue.end(), changed.begin(), changed.end());
+			}
+		}
+	}
+
+	const ArrayList<gameplay::TransformRange>& UploadTracker::take(u32 frame) {
+		ArrayList<gameplay::TransformRange>& queue = mQueues[frame];
+		// ranges of one push are sorted already, several pushes interleave
+		std::sort(queue.begin(), queue.end(), [](const auto& a, const auto& b) {
+			return a.begin < b.begin;
+		});
+		mMerged.clear();
+		for (const gameplay::TransformRange& range : queue) {
+			const u32 end = std::min(range.end, mObjectCount);
+			if (range.begin >= end) {
+				continue;
+			}
+			if (!mMerged.empty() &&
+				range.begin <= mMerged.back().end + MERGE_GAP) {
+				mMerged.back().end = std::max(mMerged.back().end, end);
+			} else {
+				mMerged.push_back({range.begin, end});
+			}
+		}
+		queue.clear();
+		return mMerged;
+	}
+} // namespace render::vulkan
@@ -0,0 +1,102 @@
+#include "physics/broadphase.h"
+#include <gtest/gtest.h>
+#include <numeric>
+#include <random>
+
+using namespace physics;
+
+TEST(Guccigedon_Broadphase, SweepAndPrune_pairs) {
+	ArrayList<BoundingBox> bounds{
+		{{0, 0, 0}, {1, 1, 1}},
+		{{0.5, 0.5, 0.5}, {1.5, 1.5, 1.5}},
+		{{3, 0, 0}, {4, 1, 1}},
+		// overlaps 0 on x but not on y
+		{{0, 2.5, 0}, {1, 3.5, 1}},
+	};
+	SweepAndPrune sap{};
+	for (u32 i = 0; i < bounds.size(); ++i) {
+		sap.add(i);
+	}
+	sap.update(bounds);
+	ASSERT_EQ(sap.pairs().size(), 1);
+	EXPECT_EQ(sap.pairs()[0].first, 0);
+	EXPECT_EQ(sap.pairs()[0].second, 1);
+	// move 2 onto 1, pairs come out sorted by object index
+	bounds[2] = {{1, 1, 1}, {2, 2, 2}};
+	sap.update(bounds);
+	ASSERT_EQ(sap.pairs().size(), 3);
+	EXPECT_EQ(sap.pairs()[0].first, 0);
+	EXPECT_EQ(sap.pairs()[0].second, 1);
+	EXPECT_EQ(sap.pairs()[1].first, 0);
+	EXPECT_EQ(sap.pairs()[1].second, 2);
+	EXPECT_EQ(sap.pairs()[2].first, 1);
+	EXPECT_EQ(sap.pairs()[2].second, 2);
+}
+
+TEST(Guccigedon_Broadphase, SweepAndPrune_axis_selection) {
+	ArrayList<BoundingBox> bounds{};
+	SweepAndPrune sap{};
+	for (u32 i = 0; i < 16; ++i) {
+		const f32 z = static_cast<f32>(i) * 10.f;
+		bounds.push_back({{0, 0, z}, {1, 1, z + 1}});
+		sap.add(i);
+	}
+	sap.update(bounds);
+	EXPECT_EQ(sap.pairs().size(), 0);
+	EXPECT_EQ(sap.axis(), 2);
+	// the order is kept after switching axes
+	sap.update(bounds);
+	EXPECT_EQ(sap.pairs().size(), 0);
+	EXPECT_EQ(sap.axis(), 2);
+}
+
+TEST(Guccigedon_Broadphase, SpatialHashGrid_matches_sweep_and_prune) {
+	std::mt19937 rng{5};
+	std::uniform_real_distribution<f32> position{-20.f, 20.f};
+	ArrayList<BoundingBox> bounds{};
+	for (u32 i = 0; i < 2000; ++i) {
+		const glm::vec3 min{position(rng), position(rng), position(rng)};
+		bounds.push_back({min, min + 1.f});
+	}
+	// a floor much larger than the rest stays out of the grid
+	bounds.push_back({{-30, -21, -30}, {30, -19, 30}});
+	ArrayList<u32> objects(bounds.size());
+	std::iota(objects.begin(), objects.end(), 0);
+	SpatialHashGrid grid{};
+	grid.update(bounds, objects);
+	// max - min of a unit box rounds to within a few ulps of 20
+	EXPECT_NEAR(grid.cell_size(), 1.f, 1e-5f);
+	EXPECT_EQ(grid.large_count(), 1);
+	SweepAndPrune sap{};
+	for (u32 i = 0; i < bounds.size(); ++i) {
+		sap.add(i);
+	}
+	sap.update(bounds);
+	ASSERT_GT(sap.pairs().size(), 0);
+	ASSERT_EQ(grid.pairs().size(), sap.pairs().size());
+	for (u32 i = 0; i < sap.pairs().size(); ++i) {
+		EXPECT_EQ(grid.pairs()[i].first, sap.pairs()[i].first);
+		EXPECT_EQ(grid.pairs()[i].second, sap.pairs()[i].second);
+	}
+}
+
+TEST(Guccigedon_Broadphase, SpatialHashGrid_wide_scene) {
+	// a row of touching pairs far wider than 1024 cells, each pair has to be
+	// found and nothing else
+	ArrayList<BoundingBox> bounds{};
+	for (u32 i = 0; i < 1000; ++i) {
+		const f32 x = static_cast<f32>(i) * 2000.f;
+		bounds.push_back({{x, 0, 0}, {x + 1, 1, 1}});
+		bounds.push_back({{x + 0.5f, 0.5f, 0.5f}, {x + 1.5f, 1.5f, 1.5f}});
+	}
+	ArrayList<u32> objects(bounds.size());
+	std::iota(objects.begin(), objects.end(), 0);
+	SpatialHashGrid grid{};
+	grid.update(bounds, objects);
+	EXPECT_EQ(grid.large_count(), 0);
+	ASSERT_EQ(grid.pairs().size(), 1000);
+	for (u32 i = 0; i < grid.pairs().size(); ++i) {
+		EXPECT_EQ(grid.pairs()[i].first, 2 * i);
+		EXPECT_EQ(grid.pairs()[i].second, 2 * i + 1);
+	}
+}
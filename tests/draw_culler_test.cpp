@@ -0,0 +1,81 @@
+#include "render/vulkan/draw_culler.h"
+#include <gtest/gtest.h>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <random>
+
+using namespace render::vulkan;
+
+TEST(Guccigedon_DrawCuller, keeps_visible_commands_in_batch_order) {
+	// enough commands for a few chunks and a partial one
+	constexpr u32 count = 1000;
+	const gameplay::Frustum frustum{
+		glm::perspective(glm::radians(70.f), 1.5f, 0.1f, 50.f)};
+	std::mt19937 rng{9};
+	std::uniform_real_distribution<f32> position{-40.f, 40.f};
+	std::uniform_real_distribution<f32> scale{0.5f, 3.f};
+	std::uniform_real_distribution<f32> radius{0.f, 2.f};
+	ArrayList<glm::mat4> world(count);
+	ArrayList<DrawCommand> commands(count + 1);
+	ArrayList<glm::vec4> bounds(count + 1);
+	for (u32 i = 0; i < count; ++i) {
+		world[i] = glm::scale(
+			glm::translate(glm::mat4{1.f},
+						   {position(rng), position(rng), position(rng)}),
+			glm::vec3{scale(rng)});
+		commands[i] = {i + 1, 1, i, 0, i};
+		bounds[i] = {radius(rng), radius(rng), radius(rng), radius(rng)};
+	}
+	// a transform the world matrices don't cover is always drawn
+	commands[count] = {1, 1, 0, 0, count};
+	bounds[count] = {1000.f, 1000.f, 1000.f, 1.f};
+	const ArrayList<DrawBatch> batches{
+		{-1, 0, 300}, {0, 300, 1}, {2, 301, count - 300}};
+	DrawCuller culler{};
+	culler.assign(commands, bounds, batches);
+	EXPECT_EQ(culler.visible_commands().size(), count + 1);
+	core::ThreadPool pool{2};
+	culler.cull(frustum, world, pool);
+	ArrayList<DrawBatch> expected_batches{};
+	ArrayList<u32> expected{};
+	for (const DrawBatch& batch : batches) {
+		const u32 first = expected.size();
+		for (u32 i = batch.first_command;
+			 i < batch.first_command + batch.command_count; ++i) {
+			const u32 object = commands[i].first_instance;
+			if (object < count) {
+				const glm::vec4 center =
+					world[object] * glm::vec4{glm::vec3{bounds[i]}, 1.f};
+				const f32 r = bounds[i].w * glm::length(world[object][0]);
+				if (!frustum.intersects(glm::vec3{center}, r)) {
+					continue;
+				}
+			}
+			expected.push_back(i);
+		}
+		if (expected.size() > first) {
+			expected_batches.push_back(
+				{batch.material_index, first,
+				 static_cast<u32>(expected.size()) - first});
+		}
+	}
+	// both outcomes are covered
+	EXPECT_GT(expected.size(), 1);
+	EXPECT_LT(expected.size(), count);
+	const ArrayList<DrawCommand>& visible = culler.visible_commands();
+	ASSERT_EQ(visible.size(), expected.size());
+	for (u32 i = 0; i < expected.size(); ++i) {
+		EXPECT_EQ(visible[i].first_index, commands[expected[i]].first_index);
+	}
+	EXPECT_EQ(visible.back().first_instance, count);
+	const ArrayList<DrawBatch>& visible_batches = culler.visible_batches();
+	ASSERT_EQ(visible_batches.size(), expected_batches.size());
+	for (u32 i = 0; i < expected_batches.size(); ++i) {
+		EXPECT_EQ(visible_batches[i].material_index,
+				  expected_batches[i].material_index);
+		EXPECT_EQ(visible_batches[i].first_command,
+				  expected_batches[i].first_command);
+		EXPECT_EQ(visible_batches[i].command_count,
+				  expected_batches[i].command_count);
+	}
+}
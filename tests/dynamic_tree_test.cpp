@@ -0,0 +1,97 @@
+#include "physics/dynamic_tree.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace physics;
+
+static ArrayList<BoundingBox> random_boxes(u32 count, u32 seed) {
+	std::mt19937 rng{seed};
+	std::uniform_real_distribution<f32> position{-50.f, 50.f};
+	std::uniform_real_distribution<f32> size{0.1f, 2.f};
+	ArrayList<BoundingBox> boxes{};
+	for (u32 i = 0; i < count; ++i) {
+		const glm::vec3 min{position(rng), position(rng), position(rng)};
+		const glm::vec3 extent{size(rng), size(rng), size(rng)};
+		boxes.push_back({min, min + extent});
+	}
+	return boxes;
+}
+
+TEST(Guccigedon_DynamicTree, insert_move_remove) {
+	ArrayList<BoundingBox> boxes = random_boxes(1000, 1);
+	DynamicTree tree{};
+	ArrayList<s32> proxies{};
+	for (u32 i = 0; i < boxes.size(); ++i) {
+		proxies.push_back(tree.create_proxy(boxes[i], i));
+	}
+	EXPECT_TRUE(tree.validate());
+	EXPECT_EQ(tree.proxy_count(), 1000);
+	// a balanced tree over 1000 leaves is far below this
+	EXPECT_LT(tree.height(), 24);
+	// small moves stay inside the fat bounds
+	BoundingBox nudged{boxes[0].min + 0.05f, boxes[0].max + 0.05f};
+	EXPECT_FALSE(tree.move_proxy(proxies[0], nudged, {0, 0, 0}));
+	for (u32 i = 0; i < boxes.size(); ++i) {
+		boxes[i].min += glm::vec3{5, 0, 0};
+		boxes[i].max += glm::vec3{5, 0, 0};
+		EXPECT_TRUE(tree.move_proxy(proxies[i], boxes[i], {1, 0, 0}));
+	}
+	EXPECT_TRUE(tree.validate());
+	for (u32 i = 0; i < boxes.size(); i += 2) {
+		tree.destroy_proxy(proxies[i]);
+	}
+	EXPECT_TRUE(tree.validate());
+	EXPECT_EQ(tree.proxy_count(), 500);
+}
+
+TEST(Guccigedon_DynamicTree, overlap_matches_brute_force) {
+	const ArrayList<BoundingBox> boxes = random_boxes(500, 2);
+	DynamicTree tree{};
+	for (u32 i = 0; i < boxes.size(); ++i) {
+		tree.create_proxy(boxes[i], i);
+	}
+	const BoundingBox query{{-10, -10, -10}, {10, 10, 10}};
+	ArrayList<u32> found{};
+	tree.overlap_aabb(query, found);
+	std::sort(found.begin(), found.end());
+	ArrayList<u32> expected{};
+	for (u32 i = 0; i < boxes.size(); ++i) {
+		// the tree reports against fat bounds
+		const BoundingBox fat{boxes[i].min - DynamicTree::MARGIN,
+							  boxes[i].max + DynamicTree::MARGIN};
+		if (fat.overlaps(query)) {
+			expected.push_back(i);
+		}
+	}
+	EXPECT_EQ(found, expected);
+	found.clear();
+	tree.overlap_sphere({0, 0, 0}, 10.f, found);
+	for (u32 index : found) {
+		EXPECT_TRUE(std::binary_search(expected.begin(), expected.end(),
+									   index));
+	}
+}
+
+TEST(Guccigedon_DynamicTree, raycast) {
+	DynamicTree tree{};
+	tree.create_proxy({{-1, -1, 4}, {1, 1, 6}}, 0);
+	tree.create_proxy({{-1, -1, 9}, {1, 1, 11}}, 1);
+	tree.create_proxy({{5, 5, 5}, {6, 6, 6}}, 2);
+	ArrayList<u32> hits{};
+	tree.raycast(Ray{{0, 0, 0}, {0, 0, 1}, 100.f},
+				 [&](u32 object_index, f32 max_distance) {
+					 hits.push_back(object_index);
+					 return max_distance;
+				 });
+	std::sort(hits.begin(), hits.end());
+	EXPECT_EQ(hits, (ArrayList<u32>{0, 1}));
+	// clipping the ray at the first hit skips the second box
+	hits.clear();
+	tree.raycast(Ray{{0, 0, 0}, {0, 0, 1}, 7.f},
+				 [&](u32 object_index, f32 max_distance) {
+					 hits.push_back(object_index);
+					 return max_distance;
+				 });
+	EXPECT_EQ(hits, (ArrayList<u32>{0}));
+}
@@ -0,0 +1,39 @@
+#include "core/fixed_timestep.h"
+#include <gtest/gtest.h>
+#include "core/sapfire_engine.h"
+
+TEST(Guccigedon_FixedTimestep, advance) {
+	core::FixedTimestep timestep{0.01f, 4};
+	// 144 Hz frames against 100 Hz physics
+	EXPECT_EQ(timestep.advance(1.f / 144.f), 0);
+	EXPECT_NEAR(timestep.alpha(), 0.694f, 1e-3f);
+	EXPECT_EQ(timestep.advance(1.f / 144.f), 1);
+	EXPECT_NEAR(timestep.alpha(), 0.389f, 1e-3f);
+	// a long hitch runs at most max_substeps and drops the rest
+	EXPECT_EQ(timestep.advance(1.f), 4);
+	EXPECT_EQ(timestep.alpha(), 0.f);
+	EXPECT_EQ(timestep.advance(0.025f), 2);
+	EXPECT_NEAR(timestep.alpha(), 0.5f, 1e-3f);
+}
+
+TEST(Guccigedon_FixedTimestep, interpolate_transforms) {
+	ArrayList<core::Entity> entities{{0, -1, 0}};
+	gameplay::TransformStore transforms{};
+	gameplay::Transform t1 = transforms.add();
+	t1.position({0, 0, 0});
+	gameplay::Transform t2 = transforms.add();
+	t2.position({4, 0, 0});
+	core::Engine engine{entities, transforms, 0};
+	// before any step the current state is rendered as is
+	engine.update_world_transforms(0.5f);
+	EXPECT_EQ(engine.transforms().world(0)[3].x, 0.f);
+	engine.store_previous_state();
+	engine.transforms()[0].position({2, 0, 0});
+	engine.transforms()[1].position({4, 8, 0});
+	engine.update_world_transforms(0.25f);
+	EXPECT_FLOAT_EQ(engine.transforms().world(0)[3].x, 0.5f);
+	EXPECT_FLOAT_EQ(engine.transforms().world(1)[3].x, 4.f);
+	EXPECT_FLOAT_EQ(engine.transforms().world(1)[3].y, 2.f);
+	// the simulated state is left alone
+	EXPECT_EQ(engine.transforms()[0].position().x, 2.f);
+}
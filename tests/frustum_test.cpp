@@ -0,0 +1,53 @@
+#include "gameplay/frustum.h"
+#include <gtest/gtest.h>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <random>
+
+TEST(Guccigedon_Frustum, sphere_against_planes) {
+	// looking down -z from the origin, 90 degrees wide, near 1 and far 100
+	const glm::mat4 proj =
+		glm::perspective(glm::radians(90.f), 1.f, 1.f, 100.f);
+	const gameplay::Frustum frustum{proj};
+	EXPECT_TRUE(frustum.intersects({0, 0, -10}, 1.f));
+	// behind the camera and past the far plane
+	EXPECT_FALSE(frustum.intersects({0, 0, 10}, 1.f));
+	EXPECT_FALSE(frustum.intersects({0, 0, -110}, 5.f));
+	EXPECT_TRUE(frustum.intersects({0, 0, -104}, 5.f));
+	// the side planes are at 45 degrees, a point at x = 20, z = -10 is
+	// 10 / sqrt(2) away from the right one
+	EXPECT_FALSE(frustum.intersects({20, 0, -10}, 7.f));
+	EXPECT_TRUE(frustum.intersects({20, 0, -10}, 7.1f));
+	EXPECT_FALSE(frustum.intersects({0, -20, -10}, 7.f));
+	// planes are normalized, the near plane is 1 in front of the camera
+	EXPECT_NEAR(frustum.planes[4].z * -3.f + frustum.planes[4].w, 2.f, 1e-4f);
+}
+
+TEST(Guccigedon_Frustum, batch_matches_single) {
+	// 37 spheres so the lanes run full and leave a scalar tail
+	constexpr u32 count = 37;
+	const glm::mat4 proj =
+		glm::perspective(glm::radians(70.f), 1.5f, 0.1f, 50.f);
+	const gameplay::Frustum frustum{proj};
+	std::mt19937 rng{5};
+	std::uniform_real_distribution<f32> position{-40.f, 40.f};
+	std::uniform_real_distribution<f32> radius{0.f, 8.f};
+	f32 x[count], y[count], z[count], r[count];
+	for (u32 i = 0; i < count; ++i) {
+		x[i] = position(rng);
+		y[i] = position(rng);
+		z[i] = position(rng);
+		r[i] = radius(rng);
+	}
+	u8 visible[count];
+	frustum.intersects(x, y, z, r, count, visible);
+	u32 inside = 0;
+	for (u32 i = 0; i < count; ++i) {
+		EXPECT_EQ(visible[i] != 0,
+				  frustum.intersects({x[i], y[i], z[i]}, r[i]));
+		inside += visible[i];
+	}
+	// both outcomes are covered
+	EXPECT_GT(inside, 0);
+	EXPECT_LT(inside, count);
+}
@@ -1,6 +1,8 @@
 #include "physics/physics_engine.h"
+#include <glm/geometric.hpp>
 #include <glm/vec3.hpp>
 #include <gtest/gtest.h>
+#include <random>
 #include "core/sapfire_engine.h"
 #include "gameplay/movement_component.h"
 #include "gameplay/transform.h"
@@ -10,15 +12,15 @@ using namespace physics;
 TEST(Guccigedon_PhysicsEngine, add_physics_object) {
 	ArrayList<core::Entity> entities{
 		{0, -1, 0}, {1, -1, 1}, {2, -1, 2}, {3, -1, 3}};
-	gameplay::Transform t1;
+	gameplay::TransformStore transforms{};
+	gameplay::Transform t1 = transforms.add();
 	t1.position({0, 0, 0});
-	gameplay::Transform t2;
+	gameplay::Transform t2 = transforms.add();
 	t2.position({0, 3, 0});
-	gameplay::Transform t3;
+	gameplay::Transform t3 = transforms.add();
 	t3.position({2, 0, 0});
-	gameplay::Transform t4;
+	gameplay::Transform t4 = transforms.add();
 	t4.position({0, 0, 1});
-	ArrayList<gameplay::Transform> transforms{t1, t2, t3, t4};
 	core::Engine engine{entities, transforms};
 	EXPECT_EQ(engine.transforms().size(), 4);
 	EXPECT_EQ(engine.entity_count(), 4);
@@ -26,37 +28,42 @@ TEST(Guccigedon_PhysicsEngine, add_physics_object) {
 	physics::ColliderSettings settings;
 	settings.radius = 1.f;
 	gameplay::MovementComponent m1{{0, 0, 0}, {0, 0, 0}};
-	auto index = physics.add_physics_object(0, physics::ColliderType::Sphere,
-											settings, m1);
-	const physics::PhysicsObject& po = physics.physics_object()[index];
-	EXPECT_EQ(index, 0);
+	auto handle = physics.add_physics_object(0, physics::ColliderType::Sphere,
+											 settings, m1);
+	EXPECT_TRUE(physics.valid(handle));
+	const physics::PhysicsObject& po =
+		physics.physics_object()[physics.index(handle)];
+	EXPECT_EQ(physics.index(handle), 0);
 	EXPECT_EQ(po.movemevent_component_index, 0);
 	EXPECT_EQ(po.transform_index, 0);
 	EXPECT_EQ(po.rigidbody_component_index, -1);
 	EXPECT_FALSE(po.has_input);
-	index = physics.add_physics_object(
+	handle = physics.add_physics_object(
 		1, physics::ColliderType::Sphere, settings,
 		gameplay::MovementComponent{{1, 1, 1}, {0, 0, 0}});
-	EXPECT_EQ(index, 1);
-	const physics::PhysicsObject& po1 = physics.physics_object()[index];
+	EXPECT_EQ(physics.index(handle), 1);
+	const physics::PhysicsObject& po1 =
+		physics.physics_object()[physics.index(handle)];
 	EXPECT_EQ(po1.transform_index, 1);
 	EXPECT_EQ(po1.movemevent_component_index, 1);
 	EXPECT_EQ(po1.rigidbody_component_index, -1);
 	EXPECT_FALSE(po1.has_input);
-	index = physics.add_physics_object(
+	handle = physics.add_physics_object(
 		2, physics::ColliderType::Sphere, settings,
 		gameplay::MovementComponent{{1, 1, 1}, {0, 0, 0}},
 		physics::RigidBody{});
-	const physics::PhysicsObject& po2 = physics.physics_object()[index];
-	EXPECT_EQ(index, 2);
+	const physics::PhysicsObject& po2 =
+		physics.physics_object()[physics.index(handle)];
+	EXPECT_EQ(physics.index(handle), 2);
 	EXPECT_EQ(po2.transform_index, 2);
 	EXPECT_EQ(po2.movemevent_component_index, 2);
 	EXPECT_EQ(po2.rigidbody_component_index, 0);
 	EXPECT_FALSE(po2.has_input);
-	index = physics.add_physics_object(3, physics::ColliderType::Sphere,
-									   settings, {}, physics::RigidBody{});
-	const physics::PhysicsObject& po3 = physics.physics_object()[index];
-	EXPECT_EQ(index, 3);
+	handle = physics.add_physics_object(3, physics::ColliderType::Sphere,
+										settings, {}, physics::RigidBody{});
+	const physics::PhysicsObject& po3 =
+		physics.physics_object()[physics.index(handle)];
+	EXPECT_EQ(physics.index(handle), 3);
 	EXPECT_EQ(po3.transform_index, 3);
 	EXPECT_EQ(po3.movemevent_component_index, -1);
 	EXPECT_EQ(po3.rigidbody_component_index, 1);
@@ -65,10 +72,10 @@ TEST(Guccigedon_PhysicsEngine, add_physics_object) {
 
 TEST(Guccigedon_PhysicsEngine, simulate_uniform_motion) {
 	ArrayList<core::Entity> entities{{0, -1, 0}};
-	gameplay::Transform t1;
-	gameplay::Transform t2;
-	gameplay::Transform t3;
-	ArrayList<gameplay::Transform> transforms{t1, t2, t3};
+	gameplay::TransformStore transforms{};
+	gameplay::Transform t1 = transforms.add();
+	gameplay::Transform t2 = transforms.add();
+	gameplay::Transform t3 = transforms.add();
 	core::Engine engine{entities, transforms};
 	physics::Engine physics{&engine};
 	gameplay::MovementComponent m1{{0, 0, 0}, {0, 0, 1}};
@@ -91,10 +98,10 @@ TEST(Guccigedon_PhysicsEngine, simulate_uniform_motion) {
 
 TEST(Guccigedon_PhysicsEngine, simulate_non_uniform_motion) {
 	ArrayList<core::Entity> entities{{0, -1, 0}};
-	gameplay::Transform t1;
-	gameplay::Transform t2;
-	gameplay::Transform t3;
-	ArrayList<gameplay::Transform> transforms{t1, t2, t3};
+	gameplay::TransformStore transforms{};
+	gameplay::Transform t1 = transforms.add();
+	gameplay::Transform t2 = transforms.add();
+	gameplay::Transform t3 = transforms.add();
 	core::Engine engine{entities, transforms};
 	physics::Engine physics{&engine};
 	gameplay::MovementComponent m1{{0, 0, 1}, {0, 0, 1}};
@@ -117,8 +124,8 @@ TEST(Guccigedon_PhysicsEngine, simulate_non_uniform_motion) {
 
 TEST(Guccigedon_PhysicsEngine, simulate_gravity) {
 	ArrayList<core::Entity> entities{{0, -1, 0}};
-	gameplay::Transform t1;
-	ArrayList<gameplay::Transform> transforms{t1};
+	gameplay::TransformStore transforms{};
+	gameplay::Transform t1 = transforms.add();
 	core::Engine engine{entities, transforms};
 	physics::Engine physics{&engine};
 	gameplay::MovementComponent m1{{0, 0, 0}, {0, 0, 0}};
@@ -132,3 +139,687 @@ TEST(Guccigedon_PhysicsEngine, simulate_gravity) {
 	EXPECT_EQ(engine.transforms()[0].position().y, -29.43f);
 	EXPECT_EQ(engine.transforms()[0].position().z, 0);
 }
+
+TEST(Guccigedon_PhysicsEngine, broadphase_collisions) {
+	ArrayList<core::Entity> entities{{0, -1, 0}};
+	gameplay::TransformStore transforms{};
+	gameplay::Transform t1 = transforms.add();
+	t1.position({0, 0, 0});
+	gameplay::Transform t2 = transforms.add();
+	t2.position({1.5, 0, 0});
+	gameplay::Transform t3 = transforms.add();
+	t3.position({10, 0, 0});
+	gameplay::Transform t4 = transforms.add();
+	t4.position({0, -1, 0});
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	physics::ColliderSettings settings;
+	settings.radius = 1.f;
+	physics.add_physics_object(0, physics::ColliderType::Sphere, settings,
+							   gameplay::MovementComponent{});
+	physics.add_physics_object(1, physics::ColliderType::Sphere, settings,
+							   gameplay::MovementComponent{});
+	physics.add_physics_object(2, physics::ColliderType::Sphere, settings,
+							   gameplay::MovementComponent{});
+	physics::ColliderSettings aabb_settings;
+	aabb_settings.size = {4, 1, 4};
+	physics.add_physics_object(3, physics::ColliderType::AABB, aabb_settings);
+	physics.simulate(0.f);
+	// 0-1 overlap, 0-3 overlap, 1-3 overlap on bounds, 2 is far away
+	ASSERT_EQ(physics.broadphase_pairs().size(), 3);
+	EXPECT_EQ(physics.broadphase_pairs()[0].first, 0);
+	EXPECT_EQ(physics.broadphase_pairs()[0].second, 1);
+	EXPECT_EQ(physics.broadphase_pairs()[1].first, 0);
+	EXPECT_EQ(physics.broadphase_pairs()[1].second, 3);
+	EXPECT_EQ(physics.broadphase_pairs()[2].first, 1);
+	EXPECT_EQ(physics.broadphase_pairs()[2].second, 3);
+	ASSERT_GE(physics.collisions().size(), 1);
+	const physics::CollisionContact& contact = physics.collisions()[0];
+	EXPECT_EQ(contact.objects[0], 0);
+	EXPECT_EQ(contact.objects[1], 1);
+	EXPECT_EQ(contact.contact_normal.x, -1);
+	EXPECT_EQ(contact.distance, 0.5f);
+}
+
+TEST(Guccigedon_PhysicsEngine, tree_broadphase_and_queries) {
+	ArrayList<core::Entity> entities{{0, -1, 0}};
+	gameplay::TransformStore transforms{};
+	gameplay::Transform t1 = transforms.add();
+	t1.position({0, 0, 0});
+	gameplay::Transform t2 = transforms.add();
+	t2.position({1.5, 0, 0});
+	gameplay::Transform t3 = transforms.add();
+	t3.position({10, 0, 0});
+	gameplay::Transform t4 = transforms.add();
+	t4.position({0, -1, 0});
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine, physics::BroadphaseType::DynamicTree};
+	physics::ColliderSettings settings;
+	settings.radius = 1.f;
+	for (s32 i = 0; i < 3; ++i) {
+		physics.add_physics_object(i, physics::ColliderType::Sphere, settings,
+								   gameplay::MovementComponent{});
+	}
+	physics::ColliderSettings aabb_settings;
+	aabb_settings.size = {4, 1, 4};
+	physics.add_physics_object(3, physics::ColliderType::AABB, aabb_settings);
+	physics.simulate(0.f);
+	// same pairs as the sweep and prune path
+	ASSERT_EQ(physics.broadphase_pairs().size(), 3);
+	EXPECT_EQ(physics.broadphase_pairs()[0].first, 0);
+	EXPECT_EQ(physics.broadphase_pairs()[0].second, 1);
+	EXPECT_EQ(physics.broadphase_pairs()[1].first, 0);
+	EXPECT_EQ(physics.broadphase_pairs()[1].second, 3);
+	EXPECT_EQ(physics.broadphase_pairs()[2].first, 1);
+	EXPECT_EQ(physics.broadphase_pairs()[2].second, 3);
+	physics::RaycastHit hit{};
+	ASSERT_TRUE(physics.raycast({{10, 5, 0}, {0, -1, 0}, 100.f}, hit));
+	EXPECT_EQ(hit.object_index, 2);
+	EXPECT_FLOAT_EQ(hit.distance, 4.f);
+	EXPECT_FLOAT_EQ(hit.normal.y, 1.f);
+	ASSERT_TRUE(physics.raycast({{0, -5, 0}, {0, 1, 0}, 100.f}, hit));
+	EXPECT_EQ(hit.object_index, 3);
+	EXPECT_FLOAT_EQ(hit.distance, 3.5f);
+	EXPECT_FALSE(physics.raycast({{0, 5, 0}, {1, 0, 0}, 100.f}, hit));
+	ArrayList<u32> overlaps{};
+	physics.overlap_sphere({10, 2.5, 0}, 1.f, overlaps);
+	ASSERT_EQ(overlaps.size(), 0);
+	physics.overlap_sphere({10, 1.5, 0}, 1.f, overlaps);
+	ASSERT_EQ(overlaps.size(), 1);
+	EXPECT_EQ(overlaps[0], 2);
+	overlaps.clear();
+	physics.overlap_aabb({{-3, -2, -3}, {-1.5, -1, 3}}, overlaps);
+	ASSERT_EQ(overlaps.size(), 1);
+	EXPECT_EQ(overlaps[0], 3);
+}
+
+TEST(Guccigedon_PhysicsEngine, narrowphase_contacts) {
+	ArrayList<core::Entity> entities{{0, -1, 0}};
+	gameplay::TransformStore transforms{};
+	gameplay::Transform t1 = transforms.add();
+	t1.position({0, 1.25, 0});
+	gameplay::Transform t2 = transforms.add();
+	t2.position({0, 0, 0});
+	gameplay::Transform t3 = transforms.add();
+	t3.position({5, 0.25, 0});
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	physics::ColliderSettings settings;
+	settings.radius = 1.f;
+	physics::RigidBody rb{};
+	rb.restitution = 0.8f;
+	physics.add_physics_object(0, physics::ColliderType::Sphere, settings,
+							   gameplay::MovementComponent{}, rb);
+	physics::ColliderSettings aabb_settings;
+	aabb_settings.size = {4, 1, 4};
+	physics.add_physics_object(1, physics::ColliderType::AABB, aabb_settings);
+	aabb_settings.size = {1, 1, 1};
+	physics.add_physics_object(2, physics::ColliderType::AABB, aabb_settings,
+							   gameplay::MovementComponent{});
+	physics::ColliderSettings plane_settings;
+	plane_settings.normal = {0, 1, 0};
+	physics.add_physics_object(-1, physics::ColliderType::Plane,
+							   plane_settings);
+	physics.simulate(0.f);
+	ASSERT_EQ(physics.collisions().size(), 2);
+	const physics::CollisionContact& sphere_box = physics.collisions()[0];
+	EXPECT_EQ(sphere_box.objects[0], 0);
+	EXPECT_EQ(sphere_box.objects[1], 1);
+	EXPECT_FLOAT_EQ(sphere_box.contact_normal.y, 1.f);
+	EXPECT_FLOAT_EQ(sphere_box.distance, 0.25f);
+	EXPECT_FLOAT_EQ(sphere_box.contact_point.y, 0.25f);
+	EXPECT_FLOAT_EQ(sphere_box.restitution, 0.8f);
+	const physics::CollisionContact& box_plane = physics.collisions()[1];
+	EXPECT_EQ(box_plane.objects[0], 2);
+	EXPECT_EQ(box_plane.objects[1], 3);
+	EXPECT_FLOAT_EQ(box_plane.contact_normal.y, 1.f);
+	EXPECT_FLOAT_EQ(box_plane.distance, 0.25f);
+	EXPECT_FLOAT_EQ(box_plane.contact_point.y, -0.25f);
+	EXPECT_FLOAT_EQ(box_plane.restitution, 0.5f);
+}
+
+TEST(Guccigedon_PhysicsEngine, contacts_independent_of_thread_count) {
+	// a pile of spheres dense enough to span many narrowphase chunks
+	gameplay::TransformStore transforms(2000);
+	for (u32 i = 0; i < transforms.size(); ++i) {
+		transforms[i].position({static_cast<f32>(i % 20) * 1.5f,
+								static_cast<f32>(i / 400) * 1.5f,
+								static_cast<f32>((i / 20) % 20) * 1.5f});
+	}
+	ArrayList<core::Entity> entities{{0, -1, 0}};
+	ArrayList<ArrayList<physics::CollisionContact>> results{};
+	ArrayList<ArrayList<u32>> objects{};
+	ArrayList<ArrayList<glm::vec3>> positions{};
+	for (u32 worker_count : {0u, 3u, 7u}) {
+		core::Engine engine{entities, transforms, worker_count};
+		physics::Engine physics{&engine};
+		physics::ColliderSettings settings;
+		settings.radius = 1.f;
+		for (u32 i = 0; i < transforms.size(); ++i) {
+			physics.add_physics_object(i, physics::ColliderType::Sphere,
+									   settings,
+									   gameplay::MovementComponent{},
+									   physics::RigidBody{});
+		}
+		physics.simulate(0.016f);
+		ASSERT_GT(physics.collisions().size(), 1000);
+		results.push_back(physics.collisions());
+		objects.emplace_back();
+		for (const auto& contact : physics.collisions()) {
+			objects.back().push_back(contact.objects[0]);
+			objects.back().push_back(contact.objects[1]);
+		}
+		positions.emplace_back();
+		for (u32 i = 0; i < engine.transforms().size(); ++i) {
+			positions.back().push_back(engine.transforms()[i].position());
+		}
+	}
+	for (u32 run = 1; run < results.size(); ++run) {
+		ASSERT_EQ(results[run].size(), results[0].size());
+		EXPECT_EQ(objects[run], objects[0]);
+		for (u32 i = 0; i < results[0].size(); ++i) {
+			const auto& expected = results[0][i];
+			const auto& contact = results[run][i];
+			EXPECT_EQ(contact.distance, expected.distance);
+			EXPECT_EQ(contact.contact_normal.x, expected.contact_normal.x);
+			EXPECT_EQ(contact.contact_normal.y, expected.contact_normal.y);
+			EXPECT_EQ(contact.contact_normal.z, expected.contact_normal.z);
+		}
+		for (u32 i = 0; i < positions[0].size(); ++i) {
+			EXPECT_EQ(positions[run][i].x, positions[0][i].x);
+			EXPECT_EQ(positions[run][i].y, positions[0][i].y);
+			EXPECT_EQ(positions[run][i].z, positions[0][i].z);
+		}
+	}
+}
+
+TEST(Guccigedon_PhysicsEngine, islands_sleep_and_wake) {
+	ArrayList<core::Entity> entities{{0, -1, 0}};
+	gameplay::TransformStore transforms{};
+	gameplay::Transform resting = transforms.add();
+	resting.position({0, 0.99f, 0});
+	gameplay::Transform falling = transforms.add();
+	falling.position({0, 9, 0});
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	physics::ColliderSettings settings;
+	settings.radius = 1.f;
+	for (s32 i = 0; i < 2; ++i) {
+		physics.add_physics_object(i, physics::ColliderType::Sphere, settings,
+								   gameplay::MovementComponent{},
+								   physics::RigidBody{});
+	}
+	physics::ColliderSettings plane_settings;
+	plane_settings.normal = {0, 1, 0};
+	physics.add_physics_object(-1, physics::ColliderType::Plane,
+							   plane_settings);
+	for (u32 step = 0; step < 50; ++step) {
+		physics.simulate(1.f / 60.f);
+	}
+	EXPECT_TRUE(physics.physics_object()[0].sleeping);
+	EXPECT_FALSE(physics.physics_object()[1].sleeping);
+	// a sleeping body is not integrated
+	const glm::vec3 rest_position = engine.transforms()[0].position();
+	physics.simulate(1.f / 60.f);
+	EXPECT_EQ(engine.transforms()[0].position().y, rest_position.y);
+	// the falling sphere joins its island on impact and wakes it
+	bool hit = false;
+	for (u32 step = 0; step < 120 && !hit; ++step) {
+		physics.simulate(1.f / 60.f);
+		for (const auto& contact : physics.collisions()) {
+			hit |= contact.objects[0] == 0 && contact.objects[1] == 1;
+		}
+	}
+	ASSERT_TRUE(hit);
+	EXPECT_FALSE(physics.physics_object()[0].sleeping);
+	EXPECT_FALSE(physics.physics_object()[1].sleeping);
+}
+
+TEST(Guccigedon_PhysicsEngine, stack_settles) {
+	ArrayList<core::Entity> entities{{0, -1, 0}};
+	gameplay::TransformStore transforms(6);
+	for (u32 i = 0; i < transforms.size(); ++i) {
+		// each box starts sunk into the one below
+		transforms[i].position({0, 0.5f + i * 0.99f, 0});
+	}
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	physics.iterations(4);
+	physics::ColliderSettings settings;
+	settings.size = {1, 1, 1};
+	for (u32 i = 0; i < transforms.size(); ++i) {
+		physics.add_physics_object(static_cast<s32>(i),
+								   physics::ColliderType::AABB, settings,
+								   gameplay::MovementComponent{},
+								   physics::RigidBody{});
+	}
+	physics::ColliderSettings plane_settings;
+	plane_settings.normal = {0, 1, 0};
+	physics.add_physics_object(-1, physics::ColliderType::Plane,
+							   plane_settings);
+	for (u32 step = 0; step < 60; ++step) {
+		physics.simulate(1.f / 60.f);
+	}
+	EXPECT_GT(engine.transforms()[0].position().y, 0.48f);
+	for (u32 i = 0; i < transforms.size(); ++i) {
+		EXPECT_TRUE(physics.physics_object()[i].sleeping);
+		if (i > 0) {
+			const f32 gap = engine.transforms()[i].position().y -
+				engine.transforms()[i - 1].position().y;
+			EXPECT_GT(gap, 0.98f);
+			EXPECT_LT(gap, 1.f);
+		}
+	}
+}
+
+TEST(Guccigedon_PhysicsEngine, bullets_do_not_tunnel) {
+	ArrayList<core::Entity> entities{{0, -1, 0}};
+	gameplay::TransformStore transforms{};
+	gameplay::Transform wall = transforms.add();
+	wall.position({0, 5, 0});
+	gameplay::Transform bullet = transforms.add();
+	bullet.position({-1, 5, 0});
+	gameplay::Transform regular = transforms.add();
+	regular.position({-1, 5, 2});
+	gameplay::Transform falling = transforms.add();
+	falling.position({3, 1, 0});
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	physics::ColliderSettings wall_settings;
+	wall_settings.size = {0.05f, 8, 8};
+	physics.add_physics_object(0, physics::ColliderType::AABB, wall_settings);
+	physics::ColliderSettings settings;
+	settings.radius = 0.1f;
+	physics::RigidBody rb{};
+	rb.gravity_factor = 0.f;
+	rb.bullet = true;
+	// 100 units per second covers more than a unit per step
+	physics.add_physics_object(
+		1, physics::ColliderType::Sphere, settings,
+		gameplay::MovementComponent{{0, 0, 0}, {100, 0, 0}}, rb);
+	physics.add_physics_object(
+		3, physics::ColliderType::Sphere, settings,
+		gameplay::MovementComponent{{0, 0, 0}, {0, -100, 0}}, rb);
+	rb.bullet = false;
+	physics.add_physics_object(
+		2, physics::ColliderType::Sphere, settings,
+		gameplay::MovementComponent{{0, 0, 0}, {100, 0, 0}}, rb);
+	physics::ColliderSettings plane_settings;
+	plane_settings.normal = {0, 1, 0};
+	physics.add_physics_object(-1, physics::ColliderType::Plane,
+							   plane_settings);
+	physics.simulate(1.f / 60.f);
+	// the regular sphere skips straight past the wall
+	EXPECT_GT(engine.transforms()[2].position().x, 0.5f);
+	// the bullets are stopped at the surfaces and bounce off
+	EXPECT_LT(engine.transforms()[1].position().x, -0.1f);
+	EXPECT_LT(physics.movement_components()[0].velocity.x, 0.f);
+	EXPECT_GT(engine.transforms()[3].position().y, 0.f);
+	EXPECT_GT(physics.movement_components()[1].velocity.y, 0.f);
+}
+
+TEST(Guccigedon_PhysicsEngine, remove_physics_object) {
+	ArrayList<core::Entity> entities{};
+	gameplay::TransformStore transforms(6);
+	for (u32 i = 0; i < transforms.size(); ++i) {
+		entities.push_back({static_cast<s32>(i), -1, static_cast<s32>(i)});
+		transforms[i].position({i * 3.f, 0, 0});
+	}
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	physics::ColliderSettings settings;
+	settings.radius = 1.f;
+	physics::ColliderSettings aabb_settings;
+	aabb_settings.size = {1, 1, 1};
+	ArrayList<physics::PhysicsObjectSettings> objects{};
+	for (s32 i = 0; i < 4; ++i) {
+		objects.push_back({i, physics::ColliderType::Sphere, settings,
+						   gameplay::MovementComponent{{0, 0, 0}, {0, 0, 0}},
+						   physics::RigidBody{}});
+	}
+	objects.push_back({4, physics::ColliderType::AABB, aabb_settings});
+	ArrayList<physics::PhysicsHandle> handles{};
+	physics.add_physics_objects(objects, handles);
+	ASSERT_EQ(handles.size(), 5);
+	EXPECT_TRUE(physics.remove_physics_object(handles[1]));
+	EXPECT_FALSE(physics.valid(handles[1]));
+	EXPECT_FALSE(physics.remove_physics_object(handles[1]));
+	// the box was last and now fills index 1
+	EXPECT_EQ(physics.index(handles[4]), 1);
+	EXPECT_EQ(physics.physics_object()[1].transform_index, 4);
+	EXPECT_EQ(physics.physics_object()[1].collider_type,
+			  physics::ColliderType::AABB);
+	EXPECT_TRUE(physics.remove_physics_object(handles[0]));
+	EXPECT_EQ(physics.physics_object().size(), 3);
+	EXPECT_EQ(physics.sphere_colliders().size(), 2);
+	EXPECT_EQ(physics.sphere_batch().size(), 2);
+	EXPECT_EQ(physics.movement_components().size(), 2);
+	// every remaining object still reaches its own components
+	for (physics::PhysicsHandle handle : {handles[2], handles[3], handles[4]}) {
+		ASSERT_TRUE(physics.valid(handle));
+		const physics::PhysicsObject& po =
+			physics.physics_object()[physics.index(handle)];
+		EXPECT_EQ(physics.handle(physics.index(handle)), handle);
+		if (po.collider_type == physics::ColliderType::Sphere) {
+			const auto& sphere =
+				physics.sphere_colliders()[po.collider_component_index];
+			EXPECT_EQ(sphere.center(),
+					  engine.transforms()[po.transform_index].position());
+			EXPECT_GE(po.movemevent_component_index, 0);
+		}
+	}
+	// a reused slot gets a new generation
+	const physics::PhysicsHandle reused = physics.add_physics_object(
+		5, physics::ColliderType::Sphere, settings,
+		gameplay::MovementComponent{{0, 0, 0}, {0, 0, 0}});
+	EXPECT_EQ(reused.slot, handles[0].slot);
+	EXPECT_NE(reused.generation, handles[0].generation);
+	EXPECT_FALSE(physics.valid(handles[0]));
+	// the remaining rigid bodies still fall, the box stays put
+	physics.simulate(1.f / 60.f);
+	EXPECT_LT(engine.transforms()[2].position().y, 0.f);
+	EXPECT_EQ(engine.transforms()[4].position().y, 0.f);
+}
+
+TEST(Guccigedon_PhysicsEngine, remove_then_add_within_a_step) {
+	ArrayList<core::Entity> entities{{0, -1, 0}};
+	gameplay::TransformStore transforms(3);
+	transforms[1].position({1.5f, 0, 0});
+	transforms[2].position({1.5f, 0, 0});
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	physics::ColliderSettings settings;
+	settings.radius = 1.f;
+	physics.add_physics_object(0, physics::ColliderType::Sphere, settings,
+							   gameplay::MovementComponent{});
+	const physics::PhysicsHandle removed = physics.add_physics_object(
+		1, physics::ColliderType::Sphere, settings,
+		gameplay::MovementComponent{});
+	physics.simulate(0.f);
+	ASSERT_EQ(physics.broadphase_pairs().size(), 1);
+	// the new object takes the slot before the sweep saw the removal
+	ASSERT_TRUE(physics.remove_physics_object(removed));
+	const physics::PhysicsHandle added = physics.add_physics_object(
+		2, physics::ColliderType::Sphere, settings,
+		gameplay::MovementComponent{});
+	EXPECT_EQ(added.slot, removed.slot);
+	physics.simulate(0.f);
+	ASSERT_EQ(physics.broadphase_pairs().size(), 1);
+	EXPECT_EQ(physics.broadphase_pairs()[0].first, 0);
+	EXPECT_EQ(physics.broadphase_pairs()[0].second, 1);
+}
+
+TEST(Guccigedon_PhysicsEngine, removal_wakes_resting_bodies) {
+	ArrayList<core::Entity> entities{{0, -1, 0}};
+	gameplay::TransformStore transforms(2);
+	transforms[0].position({0, 0.5f, 0});
+	transforms[1].position({0, 1.49f, 0});
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	physics::ColliderSettings settings;
+	settings.size = {1, 1, 1};
+	const physics::PhysicsHandle support = physics.add_physics_object(
+		0, physics::ColliderType::AABB, settings,
+		gameplay::MovementComponent{}, physics::RigidBody{});
+	const physics::PhysicsHandle top = physics.add_physics_object(
+		1, physics::ColliderType::AABB, settings,
+		gameplay::MovementComponent{}, physics::RigidBody{});
+	physics::ColliderSettings plane_settings;
+	plane_settings.normal = {0, 1, 0};
+	physics.add_physics_object(-1, physics::ColliderType::Plane,
+							   plane_settings);
+	for (u32 step = 0; step < 60; ++step) {
+		physics.simulate(1.f / 60.f);
+	}
+	ASSERT_TRUE(physics.physics_object()[physics.index(top)].sleeping);
+	const f32 rest_height = engine.transforms()[1].position().y;
+	ASSERT_TRUE(physics.remove_physics_object(support));
+	EXPECT_FALSE(physics.physics_object()[physics.index(top)].sleeping);
+	for (u32 step = 0; step < 60; ++step) {
+		physics.simulate(1.f / 60.f);
+	}
+	// down onto the plane
+	EXPECT_LT(engine.transforms()[1].position().y, rest_height - 0.9f);
+}
+
+TEST(Guccigedon_PhysicsEngine, rotational_dynamics) {
+	ArrayList<core::Entity> entities{{0, -1, 0}, {1, -1, 1}, {2, -1, 2}};
+	gameplay::TransformStore transforms{};
+	gameplay::Transform spinner = transforms.add();
+	spinner.position({10, 0, 0});
+	gameplay::Transform falling = transforms.add();
+	falling.position({0.8f, 1.55f, 0});
+	gameplay::Transform ledge = transforms.add();
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	physics::ColliderSettings settings;
+	settings.radius = 1.f;
+	physics::RigidBody rb{};
+	rb.gravity_factor = 0.f;
+	physics.add_physics_object(0, physics::ColliderType::Sphere, settings,
+							   gameplay::MovementComponent{}, rb);
+	physics::ColliderSettings box_settings;
+	box_settings.size = {1, 2, 3};
+	rb.gravity_factor = 1.f;
+	physics.add_physics_object(1, physics::ColliderType::AABB, box_settings,
+							   gameplay::MovementComponent{}, rb);
+	box_settings.size = {1, 1, 1};
+	physics.add_physics_object(2, physics::ColliderType::AABB, box_settings);
+	// solid sphere 2/5 m r^2, boxes collide axis aligned and don't rotate
+	EXPECT_FLOAT_EQ(physics.inverse_inertia()[0].x, 2.5f);
+	EXPECT_EQ(physics.inverse_inertia()[1], glm::vec3(0, 0, 0));
+	// half a turn per second around z
+	physics.angular_velocity(0, {0, 0, 3.14159265f});
+	bool hit = false;
+	for (u32 step = 0; step < 60; ++step) {
+		physics.simulate(1.f / 60.f);
+		hit |= !physics.collisions().empty();
+	}
+	const glm::quat rotation = engine.transforms()[0].rotation();
+	EXPECT_NEAR(std::fabs(rotation.z), 1.f, 1e-3f);
+	EXPECT_NEAR(rotation.w, 0.f, 1e-2f);
+	// the box lands with its center past the ledge but stays upright
+	ASSERT_TRUE(hit);
+	EXPECT_EQ(physics.angular_velocity(1), glm::vec3(0, 0, 0));
+	EXPECT_EQ(engine.transforms()[1].rotation(), glm::quat(1, 0, 0, 0));
+}
+
+TEST(Guccigedon_PhysicsEngine, degenerate_shapes_do_not_rotate) {
+	ArrayList<core::Entity> entities{{0, -1, 0}};
+	gameplay::TransformStore transforms(1);
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	physics::ColliderSettings settings;
+	settings.radius = 0.f;
+	physics.add_physics_object(0, physics::ColliderType::Sphere, settings,
+							   gameplay::MovementComponent{},
+							   physics::RigidBody{});
+	EXPECT_EQ(physics.inverse_inertia()[0], glm::vec3(0, 0, 0));
+	physics.angular_velocity(0, {0, 0, 1});
+	physics.simulate(1.f / 60.f);
+	EXPECT_EQ(physics.angular_velocity(0), glm::vec3(0, 0, 0));
+	const glm::quat rotation = engine.transforms()[0].rotation();
+	EXPECT_FALSE(std::isnan(rotation.w));
+}
+
+TEST(Guccigedon_PhysicsEngine, snapshot_restore_replays) {
+	ArrayList<core::Entity> entities{};
+	gameplay::TransformStore transforms(13);
+	for (u32 i = 0; i < transforms.size(); ++i) {
+		entities.push_back({static_cast<s32>(i), -1, static_cast<s32>(i)});
+		transforms[i].position({(i % 4) * 0.9f, 1.f + i * 0.6f, 0});
+	}
+	transforms[12].position({0, -5, 0});
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	physics::ColliderSettings settings;
+	settings.radius = 0.5f;
+	ArrayList<physics::PhysicsHandle> handles{};
+	for (s32 i = 0; i < 12; ++i) {
+		handles.push_back(physics.add_physics_object(
+			i, physics::ColliderType::Sphere, settings,
+			gameplay::MovementComponent{}, physics::RigidBody{}));
+	}
+	physics::ColliderSettings plane_settings;
+	plane_settings.normal = {0, 1, 0};
+	physics.add_physics_object(-1, physics::ColliderType::Plane,
+							   plane_settings);
+	for (u32 step = 0; step < 30; ++step) {
+		physics.simulate(1.f / 60.f);
+	}
+	ArrayList<u8> snapshot{};
+	physics.snapshot(snapshot);
+	const auto replay = [&]() {
+		ArrayList<glm::vec3> positions{};
+		for (u32 step = 0; step < 8; ++step) {
+			physics.simulate(1.f / 60.f);
+			for (u32 i = 0; i < 12; ++i) {
+				positions.push_back(engine.transforms()[i].position());
+			}
+		}
+		return positions;
+	};
+	const ArrayList<glm::vec3> expected = replay();
+	ASSERT_TRUE(physics.restore(snapshot));
+	ArrayList<glm::vec3> replayed = replay();
+	ASSERT_EQ(replayed.size(), expected.size());
+	for (u32 i = 0; i < expected.size(); ++i) {
+		EXPECT_EQ(replayed[i].x, expected[i].x);
+		EXPECT_EQ(replayed[i].y, expected[i].y);
+	}
+	// objects added and removed since the snapshot are rolled back too
+	ASSERT_TRUE(physics.remove_physics_object(handles[3]));
+	physics.add_physics_object(12, physics::ColliderType::AABB,
+							   physics::ColliderSettings{{20, 1, 20}});
+	physics.simulate(1.f / 60.f);
+	ASSERT_TRUE(physics.restore(snapshot));
+	EXPECT_TRUE(physics.valid(handles[3]));
+	EXPECT_EQ(physics.physics_object().size(), 13);
+	EXPECT_EQ(physics.aabb_colliders().size(), 0);
+	replayed = replay();
+	for (u32 i = 0; i < expected.size(); ++i) {
+		EXPECT_EQ(replayed[i].x, expected[i].x);
+		EXPECT_EQ(replayed[i].y, expected[i].y);
+	}
+	// a truncated blob is rejected before anything is overwritten
+	ASSERT_TRUE(physics.remove_physics_object(handles[3]));
+	const glm::vec3 position = engine.transforms()[0].position();
+	snapshot.resize(snapshot.size() / 2);
+	EXPECT_FALSE(physics.restore(snapshot));
+	EXPECT_FALSE(physics.valid(handles[3]));
+	EXPECT_EQ(physics.physics_object().size(), 12);
+	EXPECT_EQ(engine.transforms()[0].position(), position);
+}
+
+TEST(Guccigedon_PhysicsEngine, snapshot_rejects_foreign_transforms) {
+	ArrayList<core::Entity> entities{};
+	gameplay::TransformStore transforms(8);
+	for (u32 i = 0; i < transforms.size(); ++i) {
+		entities.push_back({static_cast<s32>(i), -1, static_cast<s32>(i)});
+		transforms[i].position({i * 2.f, 0, 0});
+	}
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	physics::ColliderSettings settings;
+	settings.radius = 0.5f;
+	for (s32 i = 0; i < 8; ++i) {
+		physics.add_physics_object(i, physics::ColliderType::Sphere,
+								   settings);
+	}
+	ArrayList<u8> snapshot{};
+	physics.snapshot(snapshot);
+	// same layout, but its spheres sit on transforms the small engine lacks
+	ArrayList<core::Entity> small_entities(entities.begin(),
+										   entities.begin() + 2);
+	gameplay::TransformStore small_transforms(2);
+	core::Engine small_engine{small_entities, small_transforms};
+	physics::Engine small{&small_engine};
+	small.add_physics_object(0, physics::ColliderType::Sphere, settings);
+	EXPECT_FALSE(small.restore(snapshot));
+	EXPECT_EQ(small.physics_object().size(), 1);
+	EXPECT_TRUE(physics.restore(snapshot));
+}
+
+TEST(Guccigedon_PhysicsEngine, batched_queries) {
+	// 40 spheres and boxes over a plane, 103 rays so the last packet is
+	// partially filled
+	constexpr u32 count = 40;
+	std::mt19937 rng{5};
+	std::uniform_real_distribution<f32> position{-6.f, 6.f};
+	ArrayList<core::Entity> entities{};
+	gameplay::TransformStore transforms(count);
+	for (u32 i = 0; i < count; ++i) {
+		entities.push_back({static_cast<s32>(i), -1, static_cast<s32>(i)});
+		transforms[i].position({position(rng), position(rng) + 7.f,
+								position(rng)});
+	}
+	core::Engine engine{entities, transforms};
+	physics::Engine physics{&engine};
+	for (u32 i = 0; i < count; ++i) {
+		physics::ColliderSettings settings;
+		settings.radius = 0.7f;
+		settings.size = {1.f, 0.5f, 2.f};
+		physics.add_physics_object(i, i % 2 == 0
+								   ? physics::ColliderType::Sphere
+								   : physics::ColliderType::AABB,
+								   settings);
+	}
+	physics::ColliderSettings plane_settings;
+	plane_settings.normal = {0, 1, 0};
+	const u32 plane = physics.index(physics.add_physics_object(
+		-1, physics::ColliderType::Plane, plane_settings));
+	physics.simulate(0.f);
+	ArrayList<physics::Ray> rays(103);
+	for (physics::Ray& ray : rays) {
+		const glm::vec3 target{position(rng), position(rng) + 6.f,
+							   position(rng)};
+		ray.origin = {position(rng) * 3.f, 20.f, position(rng) * 3.f};
+		ray.direction = glm::normalize(target - ray.origin);
+		ray.max_distance = 40.f;
+	}
+	ArrayList<physics::RaycastHit> hits(rays.size());
+	u32 expected_hits = 0;
+	ASSERT_GT(physics.raycast_batch(rays, hits), 0);
+	for (u32 i = 0; i < rays.size(); ++i) {
+		physics::RaycastHit expected{NO_HIT};
+		expected_hits += physics.raycast(rays[i], expected);
+		EXPECT_EQ(hits[i].object_index, expected.object_index);
+		EXPECT_FLOAT_EQ(hits[i].distance, expected.distance);
+	}
+	EXPECT_EQ(physics.raycast_batch(rays, hits), expected_hits);
+	// a short hits span only gets the rays it has room for
+	const std::span<physics::RaycastHit> head{hits.data(), 10};
+	hits[10] = {plane, 0.f};
+	u32 head_hits = 0;
+	for (u32 i = 0; i < head.size(); ++i) {
+		head_hits += head[i].object_index != NO_HIT;
+	}
+	EXPECT_EQ(physics.raycast_batch(rays, head), head_hits);
+	EXPECT_EQ(hits[10].object_index, plane);
+	ASSERT_GT(physics.spherecast_batch(rays, 0.3f, hits), 0);
+	for (u32 i = 0; i < rays.size(); ++i) {
+		physics::RaycastHit expected{};
+		physics.spherecast(rays[i], 0.3f, expected);
+		EXPECT_EQ(hits[i].object_index, expected.object_index);
+		EXPECT_FLOAT_EQ(hits[i].distance, expected.distance);
+		// a sphere hits no later than its center ray
+		physics::RaycastHit center{};
+		if (physics.raycast(rays[i], center)) {
+			EXPECT_LE(hits[i].distance, center.distance);
+		}
+	}
+	// a center ray 1.2 beside a sphere of radius 0.7 grazes it with a
+	// radius of 1, at the latest 30 - sqrt(1.7^2 - 1.2^2) down
+	physics::RaycastHit hit{};
+	const glm::vec3 beside = engine.transforms()[0].position() +
+		glm::vec3{1.2f, 30.f, 0};
+	ASSERT_TRUE(physics.spherecast({beside, {0, -1, 0}, 100.f}, 1.f, hit));
+	EXPECT_LE(hit.distance, 30.f - std::sqrt(1.7f * 1.7f - 1.2f * 1.2f));
+	ASSERT_TRUE(physics.spherecast({{0, -3, 50}, {0, 1, 0}, 100.f}, 0.5f,
+								   hit));
+	EXPECT_EQ(hit.object_index, plane);
+	EXPECT_FLOAT_EQ(hit.distance, 2.5f);
+	EXPECT_FALSE(physics.spherecast({{0, 3, 50}, {0, 1, 0}, 100.f}, 0.5f,
+									hit));
+	EXPECT_EQ(hit.object_index, NO_HIT);
+}
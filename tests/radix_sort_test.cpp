@@ -0,0 +1,51 @@
+#include "core/radix_sort.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+
+TEST(Guccigedon_RadixSort, matches_stable_sort) {
+	std::mt19937_64 rng{17};
+	ArrayList<u64> keys(5000);
+	ArrayList<u32> values(keys.size());
+	for (u32 i = 0; i < keys.size(); ++i) {
+		// few distinct keys spread over every byte, so equal keys are common
+		keys[i] = (rng() % 64) * 0x0101010101010101ull;
+		values[i] = i;
+	}
+	ArrayList<std::pair<u64, u32>> expected(keys.size());
+	for (u32 i = 0; i < keys.size(); ++i) {
+		expected[i] = {keys[i], values[i]};
+	}
+	std::stable_sort(expected.begin(), expected.end(),
+					 [](const auto& a, const auto& b) {
+						 return a.first < b.first;
+					 });
+	core::radix_sort(keys, values);
+	for (u32 i = 0; i < keys.size(); ++i) {
+		EXPECT_EQ(keys[i], expected[i].first);
+		EXPECT_EQ(values[i], expected[i].second);
+	}
+}
+
+TEST(Guccigedon_RadixSort, narrow_and_empty_keys) {
+	ArrayList<u64> keys{};
+	ArrayList<u32> values{};
+	core::radix_sort(keys, values);
+	EXPECT_TRUE(keys.empty());
+	// only the top and bottom byte differ
+	keys = {0x0100000000000002ull, 0x0000000000000001ull,
+			0x0100000000000001ull, 0x0000000000000002ull,
+			0x0000000000000001ull};
+	values = {0, 1, 2, 3, 4};
+	core::radix_sort(keys, values);
+	const ArrayList<u64> sorted{0x0000000000000001ull, 0x0000000000000001ull,
+								0x0000000000000002ull, 0x0100000000000001ull,
+								0x0100000000000002ull};
+	EXPECT_EQ(keys, sorted);
+	EXPECT_EQ(values, (ArrayList<u32>{1, 4, 3, 2, 0}));
+	keys = {0x0100000000000002ull, 0x0000000000000001ull,
+			0x0100000000000001ull, 0x0000000000000002ull,
+			0x0000000000000001ull};
+	core::radix_sort(keys);
+	EXPECT_EQ(keys, sorted);
+}
@@ -0,0 +1,46 @@
+#include "physics/sphere_batch.h"
+#include <gtest/gtest.h>
+#include <numeric>
+#include <random>
+#include "gameplay/transform.h"
+#include "physics/sphere_collider.h"
+
+using namespace physics;
+
+TEST(Guccigedon_SphereBatch, matches_sphere_collider) {
+	// 37 spheres so every kernel runs full lanes and a scalar tail
+	constexpr u32 count = 37;
+	std::mt19937 rng{3};
+	std::uniform_real_distribution<f32> position{-4.f, 4.f};
+	std::uniform_real_distribution<f32> radius{0.1f, 2.f};
+	gameplay::TransformStore transforms(count);
+	ArrayList<SphereCollider> spheres{};
+	SphereBatch batch{};
+	for (u32 i = 0; i < count; ++i) {
+		transforms[i].position({position(rng), position(rng), position(rng)});
+		const f32 r = radius(rng);
+		spheres.emplace_back(transforms, i, r);
+		batch.push(transforms[i].position(), r);
+	}
+	ArrayList<IntersectData> contiguous(count);
+	batch.check_collision_range(5, 0, count, contiguous.data());
+	ArrayList<u32> others(count);
+	std::iota(others.rbegin(), others.rend(), 0);
+	ArrayList<IntersectData> gathered(count);
+	batch.check_collision(5, others.data(), count, gathered.data());
+	ArrayList<u32> first(count, 5);
+	ArrayList<IntersectData> pairwise(count);
+	batch.check_collision(first.data(), others.data(), count,
+						  pairwise.data());
+	for (u32 i = 0; i < count; ++i) {
+		const IntersectData expected = spheres[5].check_collision(spheres[i]);
+		EXPECT_EQ(contiguous[i].intersect, expected.intersect);
+		EXPECT_FLOAT_EQ(contiguous[i].distance, expected.distance);
+		const IntersectData reversed =
+			spheres[5].check_collision(spheres[others[i]]);
+		EXPECT_EQ(gathered[i].intersect, reversed.intersect);
+		EXPECT_FLOAT_EQ(gathered[i].distance, reversed.distance);
+		EXPECT_EQ(pairwise[i].intersect, reversed.intersect);
+		EXPECT_FLOAT_EQ(pairwise[i].distance, reversed.distance);
+	}
+}
@@ -0,0 +1,63 @@
+#include "core/thread_pool.h"
+#include <gtest/gtest.h>
+#include <numeric>
+
+TEST(Guccigedon_ThreadPool, parallel_for_covers_range) {
+	for (u32 worker_count : {0u, 1u, 4u}) {
+		core::ThreadPool pool{worker_count};
+		EXPECT_EQ(pool.worker_count(), worker_count);
+		ArrayList<u32> visits(1000, 0);
+		ArrayList<u32> chunk_sums(core::ThreadPool::chunk_count(1000, 64), 0);
+		// run repeatedly to catch jobs leaking into each other
+		for (u32 run = 0; run < 50; ++run) {
+			pool.parallel_for(1000, 64, [&](u32 chunk, u32 begin, u32 end) {
+				EXPECT_EQ(begin, chunk * 64);
+				for (u32 i = begin; i < end; ++i) {
+					++visits[i];
+					chunk_sums[chunk] += i;
+				}
+			});
+		}
+		for (u32 count : visits) {
+			EXPECT_EQ(count, 50);
+		}
+		EXPECT_EQ(std::accumulate(chunk_sums.begin(), chunk_sums.end(), 0u),
+				  50 * (999 * 1000 / 2));
+		pool.parallel_for(0, 64, [&](u32, u32, u32) { FAIL(); });
+	}
+}
+
+TEST(Guccigedon_ThreadPool, back_to_back_jobs_stay_apart) {
+	core::ThreadPool pool{3};
+	// two lambda types and a chunk count that changes every job, a worker
+	// running a chunk with the wrong job's lambda shows up as a miscount
+	constexpr u32 jobs = 4000;
+	ArrayList<u32> visits{};
+	ArrayList<u32> foreign(2, 0);
+	for (u32 job = 0; job < jobs; ++job) {
+		const u32 chunks = 2 + job % 5;
+		visits.assign(chunks, 0);
+		if (job % 2 == 0) {
+			pool.parallel_for(chunks, 1, [&, job](u32 chunk, u32, u32) {
+				if (job % 2 != 0 || chunk >= visits.size()) {
+					++foreign[0];
+					return;
+				}
+				++visits[chunk];
+			});
+		} else {
+			pool.parallel_for(chunks * 8, 8, [&](u32 chunk, u32 begin, u32) {
+				if (begin != chunk * 8 || chunk >= visits.size()) {
+					++foreign[1];
+					return;
+				}
+				++visits[chunk];
+			});
+		}
+		for (u32 count : visits) {
+			ASSERT_EQ(count, 1) << "job " << job;
+		}
+	}
+	EXPECT_EQ(foreign[0], 0);
+	EXPECT_EQ(foreign[1], 0);
+}
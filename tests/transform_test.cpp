@@ -1,19 +1,22 @@
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/transform.hpp>
 #include <gtest/gtest.h>
+#include <random>
 #include "gameplay/transform.h"
+#include "gameplay/transform_hierarchy.h"
 
 TEST(Guccigedon_Transform_Tests, Relative_Position) {
-	gameplay::Transform t1;
+	gameplay::TransformStore transforms{};
+	gameplay::Transform t1 = transforms.add();
 	t1.position({0, 0, 0});
-	gameplay::Transform t2;
+	gameplay::Transform t2 = transforms.add();
 	t2.position({0, 3, 0});
     t2.parent_index(0);
-	gameplay::Transform t3;
+	gameplay::Transform t3 = transforms.add();
 	t3.position({2, 0, 0});
     t3.parent_index(1);
-	ArrayList<gameplay::Transform> transforms  {t1, t2, t3};
-    for(auto& t : transforms){
-        t.calculate_transform(transforms);
-    }
+    core::ThreadPool pool{0};
+    transforms.update(pool);
     auto& trans = transforms[2].transform();
     EXPECT_EQ(transforms[0].transform()[0].x, 1.f);
     EXPECT_EQ(transforms[0].transform()[0].y, 0.f);
@@ -66,18 +69,17 @@ TEST(Guccigedon_Transform_Tests, Relative_Position) {
 }
 
 TEST(Guccigedon_Transform_Tests, Relative_Scale) {
-	gameplay::Transform t1;
+	gameplay::TransformStore transforms{};
+	gameplay::Transform t1 = transforms.add();
 	t1.scale({1, 1, 1});
-	gameplay::Transform t2;
+	gameplay::Transform t2 = transforms.add();
 	t2.scale({1, 3, 1});
     t2.parent_index(0);
-	gameplay::Transform t3;
+	gameplay::Transform t3 = transforms.add();
 	t3.scale({2, 0, 0});
     t3.parent_index(1);
-	ArrayList<gameplay::Transform> transforms  {t1, t2, t3};
-    for(auto& t : transforms){
-        t.calculate_transform(transforms);
-    }
+    core::ThreadPool pool{0};
+    transforms.update(pool);
     auto& trans = transforms[2].transform();
     EXPECT_EQ(transforms[0].transform()[0].x, 1.f);
     EXPECT_EQ(transforms[0].transform()[0].y, 0.f);
@@ -128,3 +130,200 @@ TEST(Guccigedon_Transform_Tests, Relative_Scale) {
     EXPECT_EQ(transforms[2].transform()[3].z, 0.f);
     EXPECT_EQ(transforms[2].transform()[3].w, 1.f);
 }
+
+// parent world * translation * rotation * scale, walking up the parents
+static glm::mat4 reference_world(const gameplay::TransformStore& transforms,
+								 s32 index) {
+	const gameplay::TransformView t = transforms[index];
+	const glm::mat4 local = glm::translate(glm::mat4{1}, t.position()) *
+		glm::toMat4(t.rotation()) * glm::scale(t.scale());
+	if (t.parent_index() < 0) {
+		return local;
+	}
+	return reference_world(transforms, t.parent_index()) * local;
+}
+
+TEST(Guccigedon_Transform_Tests, Hierarchy_Update) {
+	// chain 3 -> 1 -> 0 -> 2 with parents stored after their children,
+	// and 4 on its own
+	gameplay::TransformStore transforms(5);
+	transforms[3].position({1, 0, 0});
+	transforms[1].position({0, 2, 0}).parent_index(3);
+	transforms[0].position({0, 0, 3}).parent_index(1);
+	transforms[2].scale({2, 2, 2}).parent_index(0);
+	transforms[4].position({5, 5, 5});
+	gameplay::TransformHierarchy hierarchy{};
+	hierarchy.build({1, 3, 0, -1, -1});
+	ASSERT_EQ(hierarchy.level_count(), 4);
+	EXPECT_EQ(hierarchy.order()[0], 3);
+	EXPECT_EQ(hierarchy.order()[1], 4);
+	EXPECT_EQ(hierarchy.order()[2], 1);
+	EXPECT_EQ(hierarchy.order()[4], 2);
+	core::ThreadPool pool{2};
+	transforms.update(pool);
+	EXPECT_EQ(transforms.world(2)[3].x, 1.f);
+	EXPECT_EQ(transforms.world(2)[3].y, 2.f);
+	EXPECT_EQ(transforms.world(2)[3].z, 3.f);
+	EXPECT_EQ(transforms.world(2)[0].x, 2.f);
+	for (u32 i = 0; i < transforms.size(); ++i) {
+		EXPECT_FALSE(transforms.dirty(i));
+	}
+	// moving the root reaches the whole chain in one pass
+	transforms[3].position({-1, 0, 0});
+	transforms[4].position({6, 5, 5});
+	transforms.update(pool);
+	EXPECT_EQ(transforms.world(2)[3].x, -1.f);
+	EXPECT_EQ(transforms.world(0)[3].x, -1.f);
+	EXPECT_EQ(transforms.world(4)[3].x, 6.f);
+}
+
+TEST(Guccigedon_Transform_Tests, Store_Matches_Reference) {
+	// 37 transforms so the kernels run full lanes and a scalar tail, and
+	// enough children per level for a full batch of them
+	constexpr u32 count = 37;
+	std::mt19937 rng{9};
+	std::uniform_real_distribution<f32> value{-2.f, 2.f};
+	// parents anywhere before the child, then 4 and 30 trade places so
+	// that one parent is stored after its children
+	const auto swapped = [](s32 i) { return i == 4 ? 30 : i == 30 ? 4 : i; };
+	ArrayList<s32> parents(count, -1);
+	gameplay::TransformStore transforms(count);
+	for (u32 i = 0; i < count; ++i) {
+		gameplay::Transform t = transforms[swapped(i)];
+		t.position({value(rng), value(rng), value(rng)});
+		t.rotation(glm::vec3{value(rng), value(rng), value(rng)});
+		t.scale({value(rng), value(rng), value(rng)});
+		if (i > 0 && i % 3 != 0) {
+			parents[swapped(i)] = swapped(rng() % i);
+			t.parent_index(parents[swapped(i)]);
+		}
+	}
+	core::ThreadPool pool{2};
+	const auto expect_matches = [&]() {
+		transforms.update(pool);
+		for (u32 i = 0; i < count; ++i) {
+			EXPECT_FALSE(transforms[i].dirty());
+			const glm::mat4 expected = reference_world(transforms, i);
+			for (u32 column = 0; column < 4; ++column) {
+				for (u32 row = 0; row < 4; ++row) {
+					EXPECT_NEAR(transforms[i].transform()[column][row],
+								expected[column][row], 1e-4f);
+				}
+			}
+		}
+	};
+	expect_matches();
+	ASSERT_EQ(transforms.changed_ranges().size(), 1);
+	EXPECT_EQ(transforms.changed_ranges()[0].end, count);
+	transforms.update(pool);
+	EXPECT_TRUE(transforms.changed_ranges().empty());
+	// moving one transform updates it and its descendants only
+	transforms[1].position({3, 2, 1});
+	transforms[30].rotation(glm::vec3{0.5f, 0.f, 0.f});
+	expect_matches();
+	// the changed ranges are exactly the moved transforms and their
+	// descendants
+	ArrayList<bool> changed(count, false);
+	for (const gameplay::TransformRange& range : transforms.changed_ranges()) {
+		for (u32 i = range.begin; i < range.end; ++i) {
+			changed[i] = true;
+		}
+	}
+	for (u32 i = 0; i < count; ++i) {
+		bool moved = false;
+		for (s32 t = i; t >= 0; t = parents[t]) {
+			moved |= t == 1 || t == 30;
+		}
+		EXPECT_EQ(changed[i], moved);
+	}
+}
+
+TEST(Guccigedon_Transform_Tests, Store_Interpolates) {
+	// 11 transforms so both the lanes and the scalar tail blend
+	constexpr u32 count = 11;
+	gameplay::TransformStore transforms(count);
+	core::ThreadPool pool{0};
+	// before the first save the current state is drawn as is
+	transforms[0].position({4, 0, 0});
+	transforms.update(pool, 0.5f);
+	EXPECT_EQ(transforms.world(0)[3].x, 4.f);
+	transforms.save_previous();
+	const glm::quat from = glm::angleAxis(0.5f, glm::vec3{0, 1, 0});
+	const glm::quat to = glm::angleAxis(2.5f, glm::vec3{0, 1, 0});
+	for (u32 i = 0; i < count; ++i) {
+		transforms[i].position({0, 0, 0}).rotation(from);
+	}
+	transforms.save_previous();
+	for (u32 i = 0; i < count; ++i) {
+		transforms[i].position({static_cast<f32>(i), 8, 0}).rotation(to);
+	}
+	transforms.update(pool, 0.25f);
+	const glm::mat4 rotation = glm::toMat4(glm::slerp(from, to, 0.5f));
+	for (u32 i = 0; i < count; ++i) {
+		EXPECT_FLOAT_EQ(transforms.world(i)[3].x, i * 0.25f);
+		EXPECT_FLOAT_EQ(transforms.world(i)[3].y, 2.f);
+	}
+	// halfway the normalized lerp agrees with slerp
+	transforms.update(pool, 0.5f);
+	for (u32 i = 0; i < count; ++i) {
+		for (u32 column = 0; column < 3; ++column) {
+			for (u32 row = 0; row < 3; ++row) {
+				EXPECT_NEAR(transforms.world(i)[column][row],
+							rotation[column][row], 1e-5f);
+			}
+		}
+	}
+	// the stored state is left alone
+	EXPECT_EQ(transforms.position(3).x, 3.f);
+	// after the next save the state is reached and nothing moves
+	transforms.save_previous();
+	transforms.update(pool, 0.5f);
+	EXPECT_EQ(transforms.world(3)[3].x, 3.f);
+	EXPECT_EQ(transforms.changed_ranges().size(), 1);
+	transforms.update(pool, 0.75f);
+	EXPECT_TRUE(transforms.changed_ranges().empty());
+}
+
+TEST(Guccigedon_Transform_Tests, Euler_Accessors) {
+	const glm::vec3 euler{0.3f, -1.2f, 0.4f};
+	gameplay::Transform t{};
+	t.rotation(euler);
+	// yaw around -y, roll around -z, pitch around -x
+	const glm::mat4 expected = glm::rotate(
+		glm::rotate(glm::rotate(glm::mat4{1}, euler.y, {0, -1, 0}), euler.z,
+					{0, 0, -1}),
+		euler.x, {-1, 0, 0});
+	for (u32 column = 0; column < 4; ++column) {
+		for (u32 row = 0; row < 4; ++row) {
+			EXPECT_NEAR(t.rotation_matrix()[column][row],
+						expected[column][row], 1e-5f);
+		}
+	}
+	const glm::vec3 forward = expected * glm::vec4{0, 0, 1, 0};
+	const glm::vec3 right = expected * glm::vec4{1, 0, 0, 0};
+	const glm::vec3 up = glm::normalize(glm::cross(right, forward));
+	for (u32 axis = 0; axis < 3; ++axis) {
+		EXPECT_NEAR(t.euler()[axis], euler[axis], 1e-5f);
+		EXPECT_NEAR(t.forward()[axis], forward[axis], 1e-5f);
+		EXPECT_NEAR(t.right()[axis], right[axis], 1e-5f);
+		EXPECT_NEAR(t.up()[axis], up[axis], 1e-5f);
+	}
+}
+
+TEST(Guccigedon_Transform_Tests, Standalone_Calculate_Transform) {
+	gameplay::Transform t1{};
+	t1.position({0, 3, 0});
+	gameplay::Transform t2{};
+	t2.position({2, 0, 0});
+	t2.parent_index(0);
+	ArrayList<gameplay::Transform> transforms{t1, t2};
+	// copies of standalone transforms are independent
+	t1.position({5, 5, 5});
+	EXPECT_EQ(transforms[0].position().y, 3.f);
+	transforms[0].calculate_transform(transforms);
+	const glm::mat4& world = transforms[1].calculate_transform(transforms);
+	EXPECT_FALSE(transforms[1].dirty());
+	EXPECT_EQ(world[3].x, 2.f);
+	EXPECT_EQ(world[3].y, 3.f);
+	EXPECT_EQ(world[3].z, 0.f);
+}
@@ -0,0 +1,48 @@
+#include "render/vulkan/upload_ring.h"
+#include <gtest/gtest.h>
+
+using namespace render::vulkan;
+
+TEST(Guccigedon_UploadRing, frames_release_in_order) {
+	alignas(256) u8 memory[1024]{};
+	UploadRing ring{memory, sizeof(memory), 2};
+	ring.begin_frame(0);
+	const UploadRing::Allocation first = ring.write(u32{7}, 4);
+	EXPECT_EQ(first.offset, 0);
+	EXPECT_EQ(first.data, memory);
+	u32 value = 0;
+	std::memcpy(&value, memory, sizeof(value));
+	EXPECT_EQ(value, 7);
+	// aligned up past the first allocation
+	const UploadRing::Allocation second = ring.allocate(64, 256);
+	EXPECT_EQ(second.offset, 256);
+	EXPECT_EQ(ring.used(), 320);
+	u32 offset = 0;
+	u32 size = 0;
+	ring.frame_range(offset, size);
+	EXPECT_EQ(offset, 0);
+	EXPECT_EQ(size, 320);
+	// frame 1 takes more than half while frame 0 is still in flight
+	ring.begin_frame(1);
+	EXPECT_EQ(ring.allocate(512, 256).offset, 512);
+	EXPECT_EQ(ring.allocate(256, 256).data, nullptr);
+	EXPECT_EQ(ring.used(), 1024);
+	// frame 0 came around, its bytes at the start are free again and the
+	// next allocation wraps
+	ring.begin_frame(0);
+	EXPECT_EQ(ring.used(), 1024 - 320);
+	const UploadRing::Allocation wrapped = ring.allocate(256, 256);
+	EXPECT_EQ(wrapped.data, memory);
+	// frame 1 still holds everything past the 320 bytes frame 0 freed
+	EXPECT_EQ(ring.allocate(256, 256).data, nullptr);
+	EXPECT_EQ(ring.allocate(64, 4).offset, 256);
+	ring.frame_range(offset, size);
+	EXPECT_EQ(offset, 0);
+	EXPECT_EQ(size, 320);
+	// frame 1 released, only frame 0's allocations are left
+	ring.begin_frame(1);
+	EXPECT_EQ(ring.used(), 320);
+	// without a mapping nothing fits
+	UploadRing unmapped{};
+	EXPECT_EQ(unmapped.allocate(4, 4).data, nullptr);
+}
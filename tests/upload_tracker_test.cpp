@@ -0,0 +1,38 @@
+#include "render/vulkan/upload_tracker.h"
+#include <gtest/gtest.h>
+
+using namespace render::vulkan;
+using gameplay::TransformRange;
+
+TEST(Guccigedon_UploadTracker, stale_ranges_per_frame) {
+	UploadTracker tracker{2};
+	// the first push makes everything stale in both frames
+	tracker.push({}, 100);
+	ASSERT_EQ(tracker.take(0).size(), 1);
+	EXPECT_EQ(tracker.take(1)[0].end, 100);
+	EXPECT_TRUE(tracker.take(0).empty());
+	// frame 0 draws right after the change, frame 1 a frame later when
+	// another range changed as well
+	const TransformRange first[]{{10, 12}, {14, 15}, {60, 70}};
+	tracker.push(first, 100);
+	const auto& frame0 = tracker.take(0);
+	ASSERT_EQ(frame0.size(), 2);
+	EXPECT_EQ(frame0[0].begin, 10);
+	EXPECT_EQ(frame0[0].end, 15);
+	EXPECT_EQ(frame0[1].begin, 60);
+	const TransformRange second[]{{30, 31}, {65, 120}};
+	tracker.push(second, 100);
+	const auto& frame1 = tracker.take(1);
+	ASSERT_EQ(frame1.size(), 3);
+	EXPECT_EQ(frame1[0].begin, 10);
+	EXPECT_EQ(frame1[1].begin, 30);
+	EXPECT_EQ(frame1[2].begin, 60);
+	// clipped to the object count
+	EXPECT_EQ(frame1[2].end, 100);
+	const auto& again = tracker.take(0);
+	ASSERT_EQ(again.size(), 2);
+	EXPECT_EQ(again[0].begin, 30);
+	// more objects than last time stales everything again
+	tracker.push({}, 120);
+	EXPECT_EQ(tracker.take(1)[0].end, 120);
+}